@@ -0,0 +1,41 @@
+/*=============================================================================
+
+Standalone benchmarks, built separately from the client (see bench.pro).
+Results are printed to stdout.
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_BENCH_H
+#define BITVOTING_BENCH_H
+
+#include <chrono>
+
+// ----------------------------------------------------------------
+// Measure wall clock time in seconds
+class BenchTimer
+{
+public:
+    BenchTimer() : start(std::chrono::steady_clock::now()) {}
+
+    double elapsed() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// ----------------------------------------------------------------
+
+// Compare the nonce scanner kernels against plain header hashing
+void bench_sha256();
+
+// Throughput and latency of block assembly policies, simulated with the
+// policy alone (no mempool or miner involved)
+void bench_assembly_policy();
+
+// Hash rate of the miner per number of threads
+void bench_mining();
+
+#endif // BITVOTING_BENCH_H
@@ -0,0 +1,59 @@
+TEMPLATE = app
+TARGET = BitvotingBench
+
+# Config
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+CONFIG += c++11
+
+INCLUDEPATH += $$PWD/..
+
+# the miner is benchmarked on the core of the client (without gui)
+include(../paillier/paillier.pri)
+include(../net/network.pri)
+
+# Libraries
+LIBS += -lgmp
+LIBS += -lssl
+LIBS += -lcrypto
+LIBS += -lleveldb
+LIBS += -lmemenv
+LIBS += -lboost_system
+LIBS += -lboost_filesystem
+LIBS += -lboost_thread
+LIBS += -lboost_serialization
+LIBS += -lboost_program_options
+LIBS += -lboost_iostreams
+LIBS += -pthread
+
+SOURCES += \
+    main.cpp \
+    bench_sha256.cpp \
+    bench_assembly_policy.cpp \
+    bench_mining.cpp \
+    ../miner.cpp \
+    ../miningstats.cpp \
+    ../proofpool.cpp \
+    ../mempool.cpp \
+    ../settings.cpp \
+    ../helper.cpp \
+    ../transaction.cpp \
+    ../electionmanager.cpp \
+    ../bitcoin/allocators.cpp \
+    ../bitcoin/key.cpp \
+    ../transactions/trustee_tally.cpp \
+    ../transactions/tally.cpp \
+    ../transactions/vote.cpp \
+    ../transactions/election.cpp \
+    ../database/electiondb.cpp \
+    ../database/blockchaindb.cpp \
+    ../database/leveldbwrapper.cpp \
+    ../utils/canonical.cpp \
+    ../utils/difficulty.cpp \
+    ../utils/hashsink.cpp \
+    ../utils/merkle.cpp \
+    ../utils/sha256.cpp
+
+HEADERS += \
+    bench.h
@@ -0,0 +1,132 @@
+#include "bench.h"
+
+#include "mempool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+
+// simulated time span (msec)
+#define BENCH_ASSEMBLY_DURATION (30 * 60 * 1000)
+
+// arriving votes per second and their size (bytes)
+#define BENCH_ASSEMBLY_RATE 50.0
+#define BENCH_ASSEMBLY_VOTE_BYTES 2500
+
+struct PendingVote
+{
+    double arrival;
+    uint64_t bytes;
+};
+
+// ----------------------------------------------------------------
+// Micro-benchmark of BlockAssemblyPolicy::isDue, i.e. of the decision when
+// to mine, not of MiningManager. Votes arrive at random (poisson process),
+// are all ready to be mined and a proof of work takes an exponentially
+// distributed time with the given mean. Template updates, verification and
+// the miner threads are not modelled, see bench_mining for the hash rate.
+static void simulate(const char* name, const BlockAssemblyPolicy &policy, double meanBlockTime)
+{
+    std::mt19937 generator(42);
+    std::exponential_distribution<double> nextArrival(BENCH_ASSEMBLY_RATE / 1000.0);
+    std::exponential_distribution<double> nextBlock(1.0 / meanBlockTime);
+    std::uniform_int_distribution<int> size(BENCH_ASSEMBLY_VOTE_BYTES / 2, BENCH_ASSEMBLY_VOTE_BYTES * 3 / 2);
+
+    std::deque<PendingVote> pending;
+    uint64_t pendingBytes = 0;
+    std::vector<double> latencies;
+    unsigned int blocks = 0;
+
+    double now = 0;
+    double arrival = nextArrival(generator);
+    double blockFound = -1; // < 0: not mining
+
+    while (now < BENCH_ASSEMBLY_DURATION)
+    {
+        // --- pending transactions & policy ---
+        double due = -1;
+        if (blockFound < 0 && !pending.empty())
+        {
+            if (policy.isDue(pending.size(), pendingBytes, std::llround(now - pending.front().arrival)))
+                blockFound = now + nextBlock(generator);
+            else
+                due = pending.front().arrival + policy.maxWait;
+        }
+
+        // --- next event ---
+        double next = arrival;
+        if (blockFound >= 0)
+            next = std::min(next, blockFound);
+        if (due >= 0)
+            next = std::min(next, due);
+        now = next;
+
+        if (now == arrival)
+        {
+            PendingVote vote = { now, (uint64_t) size(generator) };
+            pending.push_back(vote);
+            pendingBytes += vote.bytes;
+            arrival = now + nextArrival(generator);
+        }
+        else if (now == blockFound)
+        {
+            // block contains the oldest votes within the limits (as
+            // selected by Mempool::select)
+            uint64_t blockBytes = 0;
+            unsigned int included = 0;
+            while (!pending.empty() && included < policy.maxTransactions
+                   && (included == 0 || blockBytes + pending.front().bytes <= policy.maxBytes))
+            {
+                blockBytes += pending.front().bytes;
+                pendingBytes -= pending.front().bytes;
+                latencies.push_back(now - pending.front().arrival);
+                pending.pop_front();
+                included++;
+            }
+
+            blocks++;
+            blockFound = -1;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (unsigned int i = 0; i < latencies.size(); i++)
+        sum += latencies[i];
+
+    double seconds = BENCH_ASSEMBLY_DURATION / 1000.0;
+    double mean = latencies.empty() ? 0 : sum / latencies.size() / 1000.0;
+    double p95 = latencies.empty() ? 0 : latencies[latencies.size() * 95 / 100] / 1000.0;
+    double max = latencies.empty() ? 0 : latencies.back() / 1000.0;
+
+    printf("%-24s %7u %9.1f %9.1f %9.2f %9.2f %9.2f\n", name, blocks,
+           blocks == 0 ? 0.0 : (double) latencies.size() / blocks,
+           latencies.size() / seconds, mean, p95, max);
+}
+
+// ----------------------------------------------------------------
+
+void bench_assembly_policy()
+{
+    double meanBlockTimes[] = { 500, 5000 };
+
+    for (unsigned int i = 0; i < sizeof(meanBlockTimes) / sizeof(meanBlockTimes[0]); i++)
+    {
+        printf("# Benchmark: block assembly policy, simulated (%.0f votes/s, mean proof of work %.1f s)\n",
+               BENCH_ASSEMBLY_RATE, meanBlockTimes[i] / 1000.0);
+        printf("%-24s %7s %9s %9s %9s %9s %9s\n", "Policy", "Blocks", "Tx/Block", "Tx/s",
+               "Lat. (s)", "P95 (s)", "Max (s)");
+
+        simulate("Immediate", BlockAssemblyPolicy(UINT64_MAX, UINT_MAX, 0), meanBlockTimes[i]);
+        simulate("100 tx / 1 s", BlockAssemblyPolicy(UINT64_MAX, 100, 1000), meanBlockTimes[i]);
+        simulate("1000 tx / 10 s", BlockAssemblyPolicy(UINT64_MAX, 1000, 10 * 1000), meanBlockTimes[i]);
+        simulate("Default", BlockAssemblyPolicy(Settings::defaultBlockMaxBytes,
+                                                Settings::defaultBlockMaxTransactions,
+                                                Settings::defaultBlockMaxWait), meanBlockTimes[i]);
+        simulate("256 KB / 30 s", BlockAssemblyPolicy(256 * 1024, UINT_MAX, 30 * 1000), meanBlockTimes[i]);
+    }
+}
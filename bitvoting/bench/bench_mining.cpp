@@ -0,0 +1,160 @@
+#include "bench.h"
+
+#include "helper.h"
+#include "miner.h"
+#include "utils/difficulty.h"
+#include "utils/merkle.h"
+#include "utils/sha256.h"
+
+#include <vector>
+
+#include <stdio.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+// duration of one measurement (sec)
+#define BENCH_MINING_SECONDS 2
+
+// ----------------------------------------------------------------
+// Chain of mined block headers, kept in memory only. Every found block
+// is appended and the miner continues on top of it right away.
+class BenchChain
+{
+public:
+    BenchChain(unsigned int numTransactions, int leadingZeros)
+    {
+        // synthetic transactions, only their hashes go into the header
+        for (unsigned int i = 0; i < numTransactions; i++)
+            transactions.push_back(Helper::GenerateRandom256());
+
+        bits = Difficulty::toCompact(~uint256(0) >> leadingZeros);
+        hashes.push_back(Helper::GenerateRandom256());
+    }
+
+    void setMiner(Miner *miner)
+    {
+        this->miner = miner;
+    }
+
+    // builds the template of the next block
+    boost::shared_ptr<BlockTemplate> nextTemplate()
+    {
+        BenchTimer timer;
+        boost::shared_ptr<BlockTemplate> blockTemplate(new BlockTemplate());
+
+        BlockHeader &header = blockTemplate->header;
+        header.hashPrevBlock = hashes.back();
+        header.hashMerkleRoot = MerkleTree::computeRoot(transactions);
+        header.time = Helper::GetUNIXTimestamp();
+        header.bits = bits;
+
+        unsigned char headerData[BLOCK_HEADER_SIZE];
+        header.toBinary(headerData);
+        NonceScanner::prepare(headerData, blockTemplate->midstate);
+
+        blockTemplate->hashTarget = Difficulty::fromCompact(bits);
+        blockTemplate->startNonce = Helper::GenerateRandomUInt();
+        blockTemplate->nextWork = 0;
+        blockTemplate->miningStart = header.time;
+
+        templateSeconds += timer.elapsed();
+        templates++;
+
+        return blockTemplate;
+    }
+
+    // callback of the miner
+    void onSolution(BlockTemplate &blockTemplate, const BlockHeader &header)
+    {
+        boost::mutex::scoped_lock lock(mutex);
+
+        uint256 hash = header.getHash();
+        if (!(hash <= blockTemplate.hashTarget))
+            invalid++;
+
+        hashes.push_back(hash);
+        miner->setTemplate(nextTemplate());
+    }
+
+    boost::mutex mutex;
+
+    // hashes of the mined blocks (the first one stands for genesis)
+    std::vector<uint256> hashes;
+
+    // found blocks which do not meet the target
+    unsigned int invalid = 0;
+
+    // time spent building templates
+    double templateSeconds = 0;
+    unsigned int templates = 0;
+
+private:
+    std::vector<uint256> transactions;
+    unsigned int bits;
+    Miner *miner = NULL;
+};
+
+// ----------------------------------------------------------------
+// Mine on the in-memory chain for a while and print the results
+static void run(unsigned int numThreads, unsigned int numTransactions, int leadingZeros)
+{
+    BenchChain chain(numTransactions, leadingZeros);
+
+    // the miner has to be stopped before its threads are deleted
+    boost::thread_group threadGroup;
+    Miner miner(boost::bind(&BenchChain::onSolution, &chain, _1, _2), &threadGroup, numThreads);
+    chain.setMiner(&miner);
+
+    {
+        boost::mutex::scoped_lock lock(chain.mutex);
+        miner.getStats().update();
+        miner.setTemplate(chain.nextTemplate());
+    }
+
+    Helper::Sleep(BENCH_MINING_SECONDS * 1000);
+
+    boost::mutex::scoped_lock lock(chain.mutex);
+    miner.setTemplate(boost::shared_ptr<BlockTemplate>());
+    miner.getStats().update();
+    MiningStatsSnapshot stats = miner.getStats().getSnapshot();
+
+    char timeToBlock[32] = "-";
+    if (stats.blocks > 0)
+        snprintf(timeToBlock, sizeof(timeToBlock), "%.1f ms", stats.averageTimeToBlock);
+
+    printf("%7u %8u %6d %10.2f %12.2f %7u %12s %10.1f us%s\n",
+           numThreads, numTransactions, leadingZeros,
+           stats.hashrate / 1e6, stats.hashrate / numThreads / 1e6,
+           stats.blocks, timeToBlock,
+           chain.templateSeconds / chain.templates * 1e6,
+           chain.invalid > 0 ? " (INVALID BLOCKS)" : "");
+}
+
+// ----------------------------------------------------------------
+
+void bench_mining()
+{
+    printf("# Benchmark: mining on an in-memory chain (%d sec per run, kernel: %s)\n",
+           BENCH_MINING_SECONDS, NonceScanner::kernelName());
+    printf("%7s %8s %6s %10s %12s %7s %12s %13s\n",
+           "Threads", "Txs", "Zeros", "MH/s", "MH/s/thread", "Blocks", "Time/block", "Template");
+
+    unsigned int cores = boost::thread::hardware_concurrency();
+    if (cores == 0)
+        cores = 1;
+
+    // powers of two up to the number of cores (and all cores)
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int t = 1; t < cores; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(cores);
+
+    unsigned int transactionCounts[] = { 1, 1000 };
+    int leadingZeros[] = { 16, 24 };
+
+    for (unsigned int t = 0; t < threadCounts.size(); t++)
+        for (unsigned int n = 0; n < sizeof(transactionCounts) / sizeof(transactionCounts[0]); n++)
+            for (unsigned int z = 0; z < sizeof(leadingZeros) / sizeof(leadingZeros[0]); z++)
+                run(threadCounts[t], transactionCounts[n], leadingZeros[z]);
+}
@@ -0,0 +1,68 @@
+#include "bench.h"
+
+#include "bitcoin/hash.h"
+#include "utils/sha256.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// number of nonces hashed per measurement
+#define BENCH_SHA256_NONCES (1 << 22)
+
+void bench_sha256()
+{
+    printf("# Benchmark: proof of work hashing (%d nonces)\n", BENCH_SHA256_NONCES);
+
+    // random binary header (see BLOCK_HEADER_SIZE)
+    unsigned char header[NONCE_SCANNER_HEADER_SIZE];
+    for (unsigned int i = 0; i < sizeof(header); i++)
+        header[i] = rand();
+
+    // --- reference: double SHA-256 over the full header per nonce ---
+
+    BenchTimer timer;
+    uint256 best = ~uint256(0);
+    for (unsigned int nonce = 0; nonce < BENCH_SHA256_NONCES; nonce++)
+    {
+        memcpy(header + NONCE_SCANNER_HEADER_SIZE - 4, &nonce, 4);
+        uint256 hash = Hash(header, header + sizeof(header));
+        if (hash < best)
+            best = hash;
+    }
+    double reference = BENCH_SHA256_NONCES / timer.elapsed();
+    printf("%-24s %10.2f MH/s\n", "Full header", reference / 1e6);
+
+    // --- midstate kernels ---
+
+    HeaderMidstate midstate;
+    NonceScanner::prepare(header, midstate);
+
+    NonceScanner::Kernel kernels[] = { NonceScanner::KERNEL_SCALAR,
+                                       NonceScanner::KERNEL_SSE4,
+                                       NonceScanner::KERNEL_AVX2 };
+
+    for (unsigned int k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        // (kernels not supported by this CPU are skipped)
+        if (!NonceScanner::setKernel(kernels[k]))
+            continue;
+
+        unsigned int lanes = NonceScanner::lanes();
+        uint256 hashes[NONCE_SCANNER_MAX_LANES];
+
+        BenchTimer kernelTimer;
+        for (unsigned int nonce = 0; nonce < BENCH_SHA256_NONCES; nonce += lanes)
+        {
+            NonceScanner::scan(midstate, nonce, hashes);
+            for (unsigned int l = 0; l < lanes; l++)
+                if (hashes[l] < best)
+                    best = hashes[l];
+        }
+        double rate = BENCH_SHA256_NONCES / kernelTimer.elapsed();
+
+        printf("%-24s %10.2f MH/s (x%.2f)\n", NonceScanner::kernelName(), rate / 1e6, rate / reference);
+    }
+
+    NonceScanner::setKernel(NonceScanner::KERNEL_AUTO);
+}
@@ -0,0 +1,16 @@
+/*=============================================================================
+
+Bitvoting Benchmarks
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#include "bench.h"
+
+int main()
+{
+    bench_sha256();
+    bench_assembly_policy();
+    bench_mining();
+
+    return 0;
+}
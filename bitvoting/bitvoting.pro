@@ -41,6 +41,8 @@ SOURCES += \
     controller.cpp \
     main.cpp \
     miner.cpp \
+    miningstats.cpp \
+    proofpool.cpp \
     settings.cpp \
     helper.cpp \
     transaction.cpp \
@@ -53,19 +55,33 @@ SOURCES += \
     transactions/election.cpp \
     database/electiondb.cpp \
     database/blockchaindb.cpp \
-    database/leveldbwrapper.cpp
+    database/leveldbwrapper.cpp \
+    utils/canonical.cpp \
+    utils/difficulty.cpp \
+    utils/hashsink.cpp \
+    utils/merkle.cpp \
+    utils/sha256.cpp \
+    mempool.cpp
 
 HEADERS += \
     block.h \
     controller.h \
     election.h \
     miner.h \
+    miningstats.h \
+    proofpool.h \
     transaction.h \
     store.h \
     settings.h \
     helper.h \
     export.h \
+    utils/canonical.h \
     utils/comparison.h \
+    utils/difficulty.h \
+    utils/hashsink.h \
+    utils/merkle.h \
+    utils/sha256.h \
+    mempool.h \
     electionmanager.h \
     bitcoin/allocators.h \
     bitcoin/hash.h \
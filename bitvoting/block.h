@@ -9,9 +9,11 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 
 #include "settings.h"
 #include "transaction.h"
+#include "bitcoin/hash.h"
 #include "bitcoin/uint256.h"
 #include "utils/comparison.h"
 
+#include <cstring>
 #include <set>
 #include <string>
 
@@ -22,29 +24,76 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #include <boost/serialization/set.hpp>
 
 // ----------------------------------------------------------------
+// Size of the binary header representation used for proof of work:
+// version (4) | hashPrevBlock (32) | hashMerkleRoot (32) | miner (20) | time (8) | bits (4) | nonce (4)
+#define BLOCK_HEADER_SIZE 104
+
 typedef struct BlockHeader_
 {
 
     // Protocol version
-    int version = Settings::CLIENT_VERSION;
+    int version = Settings::BLOCK_VERSION;
 
     // Hash of previous block
     uint256 hashPrevBlock = 0;
 
+    // Root of the merkle tree over all transactions of this block
+    uint256 hashMerkleRoot = 0;
+
+    // Key id of the miner, the block has to be signed with this key
+    uint160 miner = 0;
+
     // Nonce that was used for proof of work
     unsigned int nonce = 0;
 
+    // Hash target of the proof of work in compact form (see Difficulty)
+    unsigned int bits = 0;
+
     // Time, this block was solved
     long long time = 0;
 
+    // ----------------------------------------------------------------
+
+    // Write the fixed-size binary representation (little endian) to out
+    void toBinary(unsigned char* out) const
+    {
+        writeLE(out, (uint64_t) (uint32_t) version, 4);
+        memcpy(out + 4, hashPrevBlock.begin(), 32);
+        memcpy(out + 36, hashMerkleRoot.begin(), 32);
+        memcpy(out + 68, miner.begin(), 20);
+        writeLE(out + 88, (uint64_t) time, 8);
+        writeLE(out + 96, (uint64_t) bits, 4);
+        writeLE(out + 100, (uint64_t) nonce, 4);
+    }
+
+    // Double SHA-256 of the binary header, i.e. the proof of work hash.
+    // Its cost does not depend on the number of transactions.
+    uint256 getHash() const
+    {
+        unsigned char data[BLOCK_HEADER_SIZE];
+        this->toBinary(data);
+        return Hash(data, data + BLOCK_HEADER_SIZE);
+    }
+
     template <typename Archive>
     void serialize(Archive& a, const unsigned int)
     {
         a & version;
         a & hashPrevBlock;
+        a & hashMerkleRoot;
+        a & miner;
         a & nonce;
+        a & bits;
         a & time;
     }
+
+private:
+
+    static void writeLE(unsigned char* out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+            out[i] = (unsigned char) (value >> (8 * i));
+    }
 } BlockHeader;
 
 // ----------------------------------------------------------------
@@ -58,6 +107,12 @@ public:
     // List of transactions, which are part of this block
     std::set<Transaction*, pt_cmp> transactions;
 
+    // The identity of a block is the hash of its header
+    const uint256 getHash()
+    {
+        return this->header.getHash();
+    }
+
     std::string toString() const
     {
         return "Block {}";
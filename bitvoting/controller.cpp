@@ -4,16 +4,18 @@
 #include "store.h"
 #include "database/blockchaindb.h"
 #include "database/electiondb.h"
+#include "utils/difficulty.h"
 #include "transactions/election.h"
 #include "transactions/vote.h"
 #include "transactions/tally.h"
 #include "transactions/trustee_tally.h"
 
-Controller::Controller(MainWindow& gui, MiningManager& mining,
+Controller::Controller(MainWindow& gui, MiningManager& mining, ProofPool& proofPool,
                        TransactionsProtocol& transactionProtocol,
                        BlocksProtocol& blockProtocol):
     gui(gui),
     miningManager(mining),
+    proofPool(proofPool),
     transactionProtocol(transactionProtocol),
     blockProtocol(blockProtocol)
 {
@@ -33,6 +35,13 @@ Controller::Controller(MainWindow& gui, MiningManager& mining,
     this->callbacks[TxType::TX_VOTE] = boost::bind(&Controller::processTxVote, this, _1);
     this->callbacks[TxType::TX_TALLY] = boost::bind(&Controller::processTxTally, this, _1);
     this->callbacks[TxType::TX_TRUSTEE_TALLY] = boost::bind(&Controller::processTxTrusteeTally, this, _1);
+
+    // precompute ballot encryptions for all elections I may still vote in
+    BOOST_FOREACH(ElectionManager* em, ElectionDB::GetAll())
+    {
+        if (!em->ended && em->amIVoter())
+            proofPool.add(em->transaction->getHash(), em->transaction->election->encPubKey);
+    }
 }
 
 bool Controller::onElectionCreated(Election* election, SignKeyPair& signKey, std::string& directory, paillier_partialkey_t** privateKeys)
@@ -84,7 +93,7 @@ bool Controller::onVote(ElectionManager *em, std::set<Ballot> &votes, SignKeyPai
     Log::i("(Controller) onVote called");
 
     TxVote *txVote;
-    VotingResult result = em->createVote(votes, &txVote);
+    VotingResult result = em->createVote(votes, &txVote, &this->proofPool);
     if (result != VotingResult::OK)
     {
         Log::e("(Controller) Unable to create vote (ElectionManager returned %d)", result);
@@ -184,8 +193,17 @@ void Controller::processTxElection(Transaction* in)
     // create new election manager and save to db
     ElectionManager *em = new ElectionManager(txElection);
 
+    // votes are counted from the block of the election on
+    // (which is the latest one, while it is processed)
+    unsigned int height;
+    if (BlockChainDB::getHeight(BlockChainDB::getLatestBlockHash(), height) == BlockChainStatus::BC_OK)
+        em->startRunningTally(height);
+
     if(em->amIInvolved())
         ElectionDB::Save(em);
+
+    if (em->amIVoter())
+        this->proofPool.add(txElection->getHash(), txElection->election->encPubKey);
 }
 
 void Controller::processTxVote(Transaction* in)
@@ -231,6 +249,10 @@ void Controller::processTxTally(Transaction* in)
 
     myElection->ended = txTally->endElection;
 
+    // no more votes to be encrypted
+    if (myElection->ended)
+        this->proofPool.remove(txTally->election);
+
     // create new tally entry in em tallies
     myElection->tallies[txTally->getHash()];
 
@@ -335,6 +357,21 @@ void Controller::receiveBlock(Block* b)
 
     // --- verify header ---
 
+    //  check the header format
+    if (b->header.version != Settings::BLOCK_VERSION)
+    {
+        Log::i("(Controller) Received block has unsupported version %i -> reject block", b->header.version);
+        return;
+    }
+
+    //  check that the block is signed by the miner named in its header
+    //  (the signature covers the header hash and thereby the miner)
+    if (b->header.miner != b->getPublicKey().GetID() || !b->verifySignature())
+    {
+        Log::i("(Controller) Received block is not signed by its miner -> reject block");
+        return;
+    }
+
     //  check last block
     Block *lastBlock;
     bcs = BlockChainDB::getLatestBlock(&lastBlock);
@@ -367,9 +404,17 @@ void Controller::receiveBlock(Block* b)
         return;
     }
 
+    //  check difficulty (depends on the previous blocks)
+    unsigned int bits;
+    if (BlockChainDB::getNextWorkRequired(lastBlockHash, bits) != BC_OK
+            || b->header.bits != bits)
+    {
+        Log::i("(Controller) Received block has wrong hash target -> reject block");
+        return;
+    }
+
     //  check hash (and therefore implicitly the nonce)
-    uint256 hashTarget = 0;
-    hashTarget = (hashTarget - 1) >> Settings::MINING_LEADING_ZEROS;
+    uint256 hashTarget = Difficulty::fromCompact(bits);
     uint256 hash = b->getHash();
     if ( !(hash <= hashTarget) )
     {
@@ -377,6 +422,13 @@ void Controller::receiveBlock(Block* b)
         return;
     }
 
+    //  check that the header commits to the transactions of this block
+    if (b->header.hashMerkleRoot != Miner::hashTransactions(b->transactions))
+    {
+        Log::i("(Controller) Received block`s transactions do not match its header -> reject block");
+        return;
+    }
+
     // check existance of block
     if ( BlockChainDB::containsBlock(hash) )
     {
@@ -386,6 +438,21 @@ void Controller::receiveBlock(Block* b)
 
     // --- verify transactions ---
 
+    //  check the ballots of all votes at once (cheaper than one by one)
+    std::vector<TxVote*> votes;
+    BOOST_FOREACH(Transaction *t, b->transactions)
+    {
+        TxVote *txVote = dynamic_cast<TxVote*>(t);
+        if (txVote)
+            votes.push_back(txVote);
+    }
+
+    if (!TxVote::verifyBallots(votes))
+    {
+        Log::i("(Controller) Received block contains invalid ballots -> reject block");
+        return;
+    }
+
     //  check correctness of each transaction
     BOOST_FOREACH(Transaction *t, b->transactions)
     {
@@ -432,10 +499,38 @@ void Controller::receiveBlock(Block* b)
         this->callbacks[tx->getType()](tx);
     }
 
+    this->countVotes(b);
+
     // update UI
     this->gui.updateElectionList();
 }
 
+void Controller::countVotes(Block* b)
+{
+    unsigned int height;
+    if (BlockChainDB::getHeight(b->getHash(), height) != BlockChainStatus::BC_OK)
+        return;
+
+    // elections with votes in this block
+    std::set<uint256> elections;
+    BOOST_FOREACH(Transaction *tx, b->transactions)
+    {
+        if (tx->getType() == TxType::TX_VOTE)
+            elections.insert(((TxVote*) tx)->election);
+    }
+
+    BOOST_FOREACH(const uint256 &election, elections)
+    {
+        // check if I am involved in the election
+        ElectionManager *myElection = NULL;
+        if (!ElectionDB::Get(election, &myElection))
+            continue;
+
+        if (myElection->countVotes(b, height))
+            ElectionDB::Save(myElection);
+    }
+}
+
 std::vector<Block*> Controller::receiveBlockRequest(BlockRequestMessage* message)
 {
     std::vector<Block*> result;
@@ -10,6 +10,7 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 
 #include "electionmanager.h"
 #include "miner.h"
+#include "proofpool.h"
 #include "database/paillierdb.h"
 #include "gui/mainwindow.h"
 #include "net/protocols/transactions.h"
@@ -24,7 +25,7 @@ class Controller
 {
 public:
 
-    Controller(MainWindow&, MiningManager& mining,
+    Controller(MainWindow&, MiningManager& mining, ProofPool& proofPool,
                TransactionsProtocol&, BlocksProtocol&);
 
     // ----- GUI Events -----
@@ -49,6 +50,7 @@ private:
 
     MainWindow& gui;
     MiningManager& miningManager;
+    ProofPool& proofPool;
     TransactionsProtocol& transactionProtocol;
     BlocksProtocol& blockProtocol;
 
@@ -78,6 +80,10 @@ private:
     // Process a received trustee tally transaction
     void processTxTrusteeTally(Transaction*);
 
+    // Count the votes of a received block into the running
+    // tallies of the elections I am involved in
+    void countVotes(Block*);
+
     // ----------------------------------------------------------------
 
     // Map for callback function for each transaction type
@@ -148,6 +148,16 @@ BlockChainStatus BlockChainDB::addBlock(Block *block)
 
     // initialize block info for new block
     BlockInfo bInfo(db.currentLocation, block->header.hashPrevBlock);
+    bInfo.time = block->header.time;
+    bInfo.bits = block->header.bits;
+    bInfo.hashMerkleRoot = block->header.hashMerkleRoot;
+    bInfo.transactions = block->transactions.size();
+
+    BlockInfo prevInfo;
+    if (db.getBlockInfo(block->header.hashPrevBlock, prevInfo))
+        bInfo.height = prevInfo.height + 1;
+    else
+        bInfo.height = 1;
 
     // store meta information about block
     uint256 hash = block->getHash();
@@ -278,6 +288,56 @@ uint256 BlockChainDB::getLatestBlockHash()
     return BlockChainDB::GetInstance().latestBlock;
 }
 
+BlockChainStatus BlockChainDB::getNextWorkRequired(const uint256 &prevHash, unsigned int &bitsOut)
+{
+    BlockChainDB& db = BlockChainDB::GetInstance();
+
+    bitsOut = Difficulty::getInitialBits();
+
+    // first block
+    if (prevHash == db.genesisBlock)
+        return BC_OK;
+
+    BlockInfo info;
+    if (!db.getBlockInfo(prevHash, info))
+        return BC_NOT_FOUND;
+
+    // not enough blocks for a full window yet
+    if (info.height <= Settings::MINING_RETARGET_WINDOW)
+        return BC_OK;
+
+    // collect the targets of the last blocks (back to front)
+    std::vector<unsigned int> bits;
+    long long lastTime = info.time;
+    while (bits.size() < Settings::MINING_RETARGET_WINDOW)
+    {
+        bits.push_back(info.bits);
+
+        if (!db.getBlockInfo(info.preHash, info))
+            return BC_NOT_FOUND;
+    }
+
+    // time between the block before the window and the last block
+    bitsOut = Difficulty::retarget(bits, lastTime - info.time);
+    return BC_OK;
+}
+
+// ----------------------------------------------------------------
+
+BlockChainStatus BlockChainDB::getHeight(const uint256 &bHash, unsigned int &heightOut)
+{
+    BlockChainDB& db = BlockChainDB::GetInstance();
+
+    BlockInfo info;
+    if (!db.getBlockInfo(bHash, info))
+        return BC_NOT_FOUND;
+
+    heightOut = info.height;
+    return BC_OK;
+}
+
+// ----------------------------------------------------------------
+
 bool BlockChainDB::containsTransaction(const uint256 &tHash)
 {
     BlockChainDB& db = BlockChainDB::GetInstance();
@@ -311,6 +371,64 @@ BlockChainStatus BlockChainDB::getTransaction(const uint256 &tHash, Transaction
 
 // ----------------------------------------------------------------
 
+BlockChainStatus BlockChainDB::getMerkleProof(const uint256 &tHash, MerkleProof &proofOut)
+{
+    // load responsible block for transaction
+    Block* block = NULL;
+    BlockChainStatus result = BlockChainDB::getBlockByTransaction(tHash, &block);
+
+    if (result != BC_OK)
+        return result;
+
+    // collect leaves and find position of transaction
+    std::vector<uint256> leaves;
+    unsigned int index = block->transactions.size();
+    BOOST_FOREACH(Transaction* current, block->transactions)
+    {
+        uint256 hash = current->getHash();
+        if (hash == tHash)
+            index = leaves.size();
+
+        leaves.push_back(hash);
+    }
+
+    proofOut.block = block->getHash();
+    proofOut.transaction = tHash;
+    proofOut.index = index;
+    proofOut.leaves = leaves.size();
+
+    // the loaded block is not needed anymore
+    BOOST_FOREACH(Transaction* current, block->transactions)
+        delete current;
+    delete block;
+
+    if (!MerkleTree::computeBranch(leaves, index, proofOut.branch))
+        return BC_NOT_FOUND;
+
+    return BC_OK;
+}
+
+// ----------------------------------------------------------------
+
+bool BlockChainDB::verifyMerkleProof(const MerkleProof &proof)
+{
+    BlockChainDB& db = BlockChainDB::GetInstance();
+
+    // the merkle root is kept with the block info,
+    // so the block itself does not have to be read
+    BlockInfo info;
+    if (!db.getBlockInfo(proof.block, info))
+        return false;
+
+    // the shape of the tree is not up to the prover
+    if (proof.leaves != info.transactions)
+        return false;
+
+    return MerkleTree::verify(proof, info.hashMerkleRoot);
+}
+
+// ----------------------------------------------------------------
+
 BlockChainStatus BlockChainDB::getAllBlocks(const uint256 &start, std::vector<Block*> &blocksOut)
 {
     BlockChainDB& db = BlockChainDB::GetInstance();
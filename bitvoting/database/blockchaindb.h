@@ -15,6 +15,8 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #include "settings.h"
 #include "bitcoin/uint256.h"
 #include "database/leveldbwrapper.h"
+#include "utils/difficulty.h"
+#include "utils/merkle.h"
 
 #include <utility>
 
@@ -77,7 +79,9 @@ struct Locator
 // ==========================================================================
 
 // Additional to information about the location of a block/transaction,
-// the hash of its predecessor is stored for every block
+// the hash of its predecessor is stored for every block, as well as the
+// header fields needed for difficulty retargeting (so that the block
+// itself does not have to be loaded)
 struct BlockInfo
 {
     // Information to locate block on disk (block file)
@@ -86,6 +90,21 @@ struct BlockInfo
     // Hash of predecessor block
     uint256 preHash;
 
+    // Time of the block (see BlockHeader)
+    long long time = 0;
+
+    // Compact hash target of the block (see BlockHeader)
+    unsigned int bits = 0;
+
+    // Root of the merkle tree over the transactions (see BlockHeader)
+    uint256 hashMerkleRoot = 0;
+
+    // Number of blocks before this one (not counting the genesis block)
+    unsigned int height = 0;
+
+    // Number of transactions (leaves of the merkle tree)
+    unsigned int transactions = 0;
+
     // ----------------------------------------------------------------
 
     BlockInfo() {}
@@ -100,6 +119,11 @@ struct BlockInfo
     {
         a & locator;
         a & preHash;
+        a & time;
+        a & bits;
+        a & height;
+        a & hashMerkleRoot;
+        a & transactions;
     }
 };
 
@@ -210,6 +234,13 @@ public:
     // Get only hash of latest block in chain
     static uint256 getLatestBlockHash();
 
+    // Compute the compact hash target required for a block following
+    // the given one (see Difficulty)
+    static BlockChainStatus getNextWorkRequired(const uint256 &, unsigned int &);
+
+    // Get the height of a given block (the first block has height 1)
+    static BlockChainStatus getHeight(const uint256 &, unsigned int &);
+
     // Get block of a given transaction
     static BlockChainStatus getBlockByTransaction(const uint256 &, Block **);
 
@@ -218,6 +249,12 @@ public:
     // Load a certain transaction from block chain using its hash
     static BlockChainStatus getTransaction(const uint256 &, Transaction **);
 
+    // Build a compact proof that the given transaction is part of its block
+    static BlockChainStatus getMerkleProof(const uint256 &, MerkleProof &);
+
+    // Check a merkle proof against the header of its block in the block chain
+    static bool verifyMerkleProof(const MerkleProof &);
+
     // Load a block and all its successors until the latest block is reached.
     // Note: The given block is part of the returning collection
     static BlockChainStatus getAllBlocks(const uint256 &, std::vector<Block*> &);
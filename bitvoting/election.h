@@ -13,16 +13,21 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #include "paillier/comparison.h"
 #include "paillier/paillier.h"
 #include "paillier/serialization.h"
+#include "utils/canonical.h"
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <stdexcept>
 #include <utility>
 #include <vector>
 
+#include <boost/foreach.hpp>
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/set.hpp>
 #include <boost/serialization/string.hpp>
+#include <boost/serialization/version.hpp>
 #include <boost/serialization/vector.hpp>
 
 // ----------------------------------------------------------------
@@ -41,7 +46,7 @@ public:
     // Question represent as string
     std::string question;
 
-    // Possible answers (only 2 allowed!)
+    // Possible answers (at least 2)
     Answers answers;
 
     // ----------------------------------------------------------------
@@ -52,8 +57,8 @@ public:
     Question(std::string question, Answers answers = DEFAULT_ANSWERS):
         question(question)
     {
-        if (answers.size() != 2)
-            throw std::invalid_argument("Exactly two answers must be provided!");
+        if (answers.size() < 2)
+            throw std::invalid_argument("At least two answers must be provided!");
 
         this->id = Helper::GenerateRandom160();
         this->answers = answers;
@@ -71,6 +76,94 @@ public:
         return this->id == other.id;
     }
 
+    // Plaintexts the answers are encrypted as. Yes/no questions keep 0 and
+    // 1 (their tally is the number of second answers). With more answers,
+    // answer j is base^j, so that digit j of the tally (to the base of the
+    // election, see Election::getBase) counts answer j and all answers fit
+    // into one ciphertext. The plaintexts have to be freed by the caller.
+    std::vector<paillier_plaintext_t*> getPlaintexts(unsigned long base) const
+    {
+        std::vector<paillier_plaintext_t*> plaintexts;
+        for (unsigned int j = 0; j < this->answers.size(); j++)
+        {
+            paillier_plaintext_t* plaintext = paillier_plaintext_from_ui(j);
+            if (this->answers.size() > 2)
+                mpz_ui_pow_ui(plaintext->m, base, j);
+
+            plaintexts.push_back(plaintext);
+        }
+
+        return plaintexts;
+    }
+
+    // Number of digits of the tally (see getPlaintexts)
+    unsigned int getDigits() const
+    {
+        return (this->answers.size() <= 2) ? 1 : this->answers.size();
+    }
+
+    // Number of ballots per answer in the given tally (see getPlaintexts),
+    // for yes/no questions only the number of second answers. The digits
+    // of the question start at the given offset of the tally (see
+    // Election::getSlots).
+    std::vector<unsigned long> getCounts(paillier_plaintext_t* tally, unsigned long base,
+                                         unsigned int offset = 0) const
+    {
+        mpz_t rest;
+        mpz_init(rest);
+        mpz_ui_pow_ui(rest, base, offset);
+        mpz_fdiv_q(rest, tally->m, rest);
+
+        std::vector<unsigned long> counts;
+        for (unsigned int j = 0; j < this->getDigits(); j++)
+            counts.push_back(mpz_fdiv_q_ui(rest, rest, base));
+
+        mpz_clear(rest);
+        return counts;
+    }
+
+    // Check that every tally (see getPlaintexts) fits into a plaintext of
+    // the given key, i.e. base^answers < n^s
+    bool fits(unsigned long base, paillier_pubkey_t* key) const
+    {
+        if (this->answers.size() <= 2)
+            return true;
+
+        mpz_t limit;
+        mpz_init(limit);
+        mpz_ui_pow_ui(limit, base, this->answers.size());
+        bool result = mpz_cmp(limit, key->n_s) < 0;
+        mpz_clear(limit);
+
+        return result;
+    }
+
+    // Number of bits of the largest tally (see getPlaintexts)
+    size_t getTallyBits(unsigned long base) const
+    {
+        if (this->answers.size() <= 2)
+            return 1;
+
+        mpz_t limit;
+        mpz_init(limit);
+        mpz_ui_pow_ui(limit, base, this->answers.size());
+        mpz_sub_ui(limit, limit, 1);
+        size_t result = mpz_sizeinbase(limit, 2);
+        mpz_clear(limit);
+
+        return result;
+    }
+
+    // Canonical encoding (see CanonicalWriter)
+    void encode(CanonicalWriter &writer) const
+    {
+        writer.writeHash(this->id);
+        writer.writeString(this->question);
+        writer.writeUInt32(this->answers.size());
+        BOOST_FOREACH(const std::string &answer, this->answers)
+            writer.writeString(answer);
+    }
+
 private:
 
     friend class boost::serialization::access;
@@ -109,10 +202,23 @@ typedef struct Ballot_t
     }
 } Ballot;
 
+// ----------------------------------------------------------------
+// Position of the tally of a question (see Election::getSlots)
+typedef struct QuestionSlot_t
+{
+    // Questions with the same pack share one tally,
+    // the pack is identified by its first question
+    uint160 pack = 0;
+
+    // First digit of the question in the tally of its pack
+    unsigned int offset = 0;
+} QuestionSlot;
+
 // ----------------------------------------------------------------
 typedef struct TalliedBallots_t
 {
-    // Ballots regarding question ID
+    // Ballots regarding question ID (of the first question of a pack,
+    // see Election::getSlots)
     uint160 questionID = 0;
 
     // Holds the partial decryption of all ballots
@@ -132,6 +238,12 @@ typedef struct TalliedBallots_t
                 std::tie(other.questionID, *(other.answers));
     }
 
+    void encode(CanonicalWriter &writer) const
+    {
+        writer.writeHash(this->questionID);
+        writer.writePartialDecryption(this->answers);
+    }
+
     template <typename Archive>
     void serialize(Archive& a, const unsigned int)
     {
@@ -143,34 +255,74 @@ typedef struct TalliedBallots_t
 // ----------------------------------------------------------------
 typedef struct EncryptedBallot_t
 {
-    // Question ID
+    // Question ID (of the first question of a pack for
+    // packed elections, see Election::getPacks)
     uint160 questionID = 0;
 
-    // Encrypted answers
+    // Encrypted answers (NULL for packed elections)
     paillier_ciphertext_proof_t* answer = NULL;
 
+    // Encrypted answers of the questions of a pack, each with a proof
+    // (only for packed elections). They are packed into one ciphertext
+    // by whoever counts the ballot (see Election::packSlots).
+    std::vector<paillier_ciphertext_proof_t*> slots;
+
     // ----------------------------------------------------------------
 
     inline bool operator==(const EncryptedBallot_t& other) const
     {
-        return (questionID == other.questionID &&
-                *answer == *(other.answer));
+        return !(*this < other) && !(other < *this);
     }
 
     inline bool operator<(const EncryptedBallot_t& other) const
     {
-        return std::tie(questionID, *answer) <
-                std::tie(other.questionID, *(other.answer));
+        if (questionID != other.questionID)
+            return questionID < other.questionID;
+
+        // packed ballots (without answer) first
+        if (!answer || !other.answer)
+        {
+            if (answer || other.answer)
+                return !answer;
+
+            return std::lexicographical_compare(slots.begin(), slots.end(),
+                                                other.slots.begin(), other.slots.end(),
+                                                [](const paillier_ciphertext_proof_t* first,
+                                                   const paillier_ciphertext_proof_t* second)
+                                                { return *first < *second; });
+        }
+
+        return *answer < *(other.answer);
+    }
+
+    void encode(CanonicalWriter &writer) const
+    {
+        writer.writeHash(this->questionID);
+        writer.writeCiphertext(this->answer);
+
+        // only for packed ballots, so the encoding of others stays the same
+        if (this->slots.empty())
+            return;
+
+        writer.writeUInt32(this->slots.size());
+        BOOST_FOREACH(const paillier_ciphertext_proof_t* slot, this->slots)
+            writer.writeCiphertext(slot);
     }
 
     template <typename Archive>
-    void serialize(Archive& a, const unsigned int)
+    void serialize(Archive& a, const unsigned int version)
     {
         a & this->questionID;
         a & this->answer;
+
+        // ballots stored before packing was introduced
+        if (version > 0)
+            a & this->slots;
     }
 } EncryptedBallot;
 
+BOOST_CLASS_VERSION(EncryptedBallot, 1)
+
 // ----------------------------------------------------------------
 class Election
 {
@@ -197,6 +349,9 @@ public:
     // List of trustees (identified by their keys), who are responsible for this election
     std::set<CKeyID> trustees;
 
+    // Count several questions in one tally (see getSlots)
+    bool packed = false;
+
     // ----------------------------------------------------------------
 
     Election() {}
@@ -206,6 +361,124 @@ public:
         voters(voters),
         trustees(trustees) {}
 
+    // Base of the digits of a tally (see Question::getPlaintexts), larger
+    // than the number of ballots any answer can get
+    unsigned long getBase() const
+    {
+        if (!this->packed)
+            return this->voters.size() + 1;
+
+        return 1ul << this->getBaseBits();
+    }
+
+    // Bits of the digits of packed elections (see getBase), which are
+    // the bit ranges of the answers in their tallies
+    unsigned int getBaseBits() const
+    {
+        unsigned int bits = 1;
+        while ((1ul << bits) <= this->voters.size())
+            bits++;
+
+        return bits;
+    }
+
+    // Position of the tally of every question. Questions of packed
+    // elections are counted in the disjoint digits of a shared tally:
+    // consecutive questions form a pack, as long as all their digits fit
+    // into a plaintext of the key. Voters publish one ballot per pack,
+    // whose slots are packed into one ciphertext (see packSlots), so that
+    // the tally decrypts one ciphertext per pack. Otherwise, every
+    // question is a pack of its own.
+    std::map<uint160, QuestionSlot> getSlots() const
+    {
+        // digits of a tally: base^capacity <= 2^(bits of n^s - 1) < n^s
+        unsigned int capacity = 0;
+        if (this->packed && this->encPubKey)
+            capacity = (mpz_sizeinbase(this->encPubKey->n_s, 2) - 1) / this->getBaseBits();
+
+        std::map<uint160, QuestionSlot> slots;
+        QuestionSlot slot;
+        BOOST_FOREACH(const Question &question, this->questions)
+        {
+            // start a new pack, if the question does not fit anymore
+            if (slots.empty() || slot.offset + question.getDigits() > capacity)
+            {
+                slot.pack = question.id;
+                slot.offset = 0;
+            }
+
+            slots[question.id] = slot;
+            slot.offset += question.getDigits();
+        }
+
+        return slots;
+    }
+
+    // Questions of every pack (see getSlots) in the order of their
+    // digits, the pack is identified by its first question
+    std::map<uint160, std::vector<Question>> getPacks() const
+    {
+        std::map<uint160, QuestionSlot> slots = this->getSlots();
+
+        std::map<uint160, std::vector<Question>> packs;
+        BOOST_FOREACH(const Question &question, this->questions)
+            packs[slots[question.id].pack].push_back(question);
+
+        return packs;
+    }
+
+    // Plaintexts the answers of the given question are encrypted as (see
+    // Question::getPlaintexts). Every question has a slot in the ballots
+    // of packed elections, so abstaining is encrypted as 0 (the last
+    // plaintext, if not the encoding of the first answer already).
+    // The plaintexts have to be freed by the caller.
+    std::vector<paillier_plaintext_t*> getPlaintexts(const Question &question) const
+    {
+        std::vector<paillier_plaintext_t*> plaintexts = question.getPlaintexts(this->getBase());
+        if (this->packed && question.answers.size() > 2)
+            plaintexts.push_back(paillier_plaintext_from_ui(0));
+
+        return plaintexts;
+    }
+
+    // Packs the encrypted answers of the questions of the given pack
+    // (see getPacks) into one ciphertext, which holds them in the digits
+    // of their slots (see getSlots). Has to be freed by the caller.
+    paillier_ciphertext_pure_t* packSlots(const std::vector<Question> &pack,
+                                          std::vector<paillier_ciphertext_pure_t*> slots) const
+    {
+        std::vector<unsigned int> digits;
+        BOOST_FOREACH(const Question &question, pack)
+            digits.push_back(question.getDigits());
+
+        return paillier_pack(this->encPubKey, &slots[0], &digits[0], slots.size(), this->getBase());
+    }
+
+    // Ciphertext of the given (valid) ballot in the tally of its pack,
+    // i.e. the packing of its slots for packed elections (see packSlots).
+    // Has to be freed by the caller.
+    paillier_ciphertext_pure_t* getCiphertext(const EncryptedBallot &ballot,
+                                              const std::map<uint160, std::vector<Question>> &packs) const
+    {
+        if (!this->packed)
+            return paillier_copyciphertext(ballot.answer);
+
+        return this->packSlots(packs.at(ballot.questionID),
+                               std::vector<paillier_ciphertext_pure_t*>(ballot.slots.begin(), ballot.slots.end()));
+    }
+
+    // Smallest s, for which the tallies of all questions fit into the
+    // plaintexts of a key with the given number of bits (see
+    // paillier_keygen), since n^s >= 2^((bits-1)*s)
+    int getPlaintextLevel(int bits) const
+    {
+        size_t tallyBits = 1;
+        BOOST_FOREACH(const Question &question, this->questions)
+            tallyBits = std::max(tallyBits, question.getTallyBits(this->getBase()));
+
+        return (tallyBits + bits - 2) / (bits - 1);
+    }
+
     // ----------------------------------------------------------------
 
     bool operator==(const Election& other) const
@@ -216,7 +489,35 @@ public:
                     *(this->encPubKey) == *(other.encPubKey) &&
                     this->probableEndingTime == probableEndingTime &&
                     this->voters == other.voters &&
-                    this->trustees == other.trustees);
+                    this->trustees == other.trustees &&
+                    this->packed == other.packed);
+    }
+
+    // Canonical encoding (see CanonicalWriter)
+    void encode(CanonicalWriter &writer) const
+    {
+        writer.writeString(this->name);
+        writer.writeString(this->description);
+
+        writer.writeUInt32(this->questions.size());
+        BOOST_FOREACH(const Question &question, this->questions)
+            question.encode(writer);
+
+        writer.writeInt64(this->probableEndingTime);
+        writer.writePublicKey(this->encPubKey);
+
+        writer.writeUInt32(this->voters.size());
+        BOOST_FOREACH(const CKeyID &voter, this->voters)
+            writer.writeHash(voter);
+
+        writer.writeUInt32(this->trustees.size());
+        BOOST_FOREACH(const CKeyID &trustee, this->trustees)
+            writer.writeHash(trustee);
+
+        // only for packed elections, so the encoding of others stays
+        // the same (the election ends its transaction, see TxElection)
+        if (this->packed)
+            writer.writeBool(this->packed);
     }
 
 private:
@@ -224,7 +525,7 @@ private:
     friend class boost::serialization::access;
 
     template <typename Archive>
-    void serialize(Archive& a, const unsigned int)
+    void serialize(Archive& a, const unsigned int version)
     {
         a & this->name;
         a & this->description;
@@ -233,7 +534,13 @@ private:
         a & this->encPubKey;
         a & this->voters;
         a & this->trustees;
+
+        // elections stored before packing was introduced
+        if (version > 0)
+            a & this->packed;
     }
 };
 
+BOOST_CLASS_VERSION(Election, 1)
+
 #endif
@@ -3,6 +3,9 @@
 #include "store.h"
 #include "database/blockchaindb.h"
 
+#include <algorithm>
+
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
 // ================================================================
@@ -141,8 +144,44 @@ ElectionManager::getQuestion(uint160 id, Question& questionOut) const
 
 // ----------------------------------------------------------------
 
+paillier_ciphertext_proof_t*
+ElectionManager::encryptAnswer(const Question &question, int answer, ProofPool* pool)
+{
+    Election* election = this->transaction->election;
+    paillier_pubkey_t* key = election->encPubKey;
+
+    // As long as the plaintext equals its index (i.e. plaintexts are 0 and 1 in this order)
+    // we can just take the answer as choice (abstaining in packed elections is 0 as well).
+    if (question.answers.size() == 2)
+    {
+        PLAINTEXT_SELECTION choice = static_cast<PLAINTEXT_SELECTION>(std::max(answer, 0));
+        if (!pool)
+            return paillier_enc_proof(key, choice, paillier_get_rand_devurandom, NULL);
+
+        paillier_enc_precomputation_t* pre = pool->take(this->transaction->getHash(), key);
+        paillier_ciphertext_proof_t* cipher = paillier_enc_proof_precomputed(key, choice, pre);
+        paillier_freeencprecomputation(pre);
+
+        return cipher;
+    }
+
+    // 1-out-of-k proof over the encodings of all answers
+    // (the pool only holds precomputations for yes/no questions),
+    // abstaining is the last plaintext (see Election::getPlaintexts)
+    std::vector<paillier_plaintext_t*> plaintexts = election->getPlaintexts(question);
+    int index = (answer == -1) ? plaintexts.size() - 1 : answer;
+    paillier_ciphertext_proof_t* cipher = paillier_enc_proof(key, &plaintexts[0], plaintexts.size(), index,
+                                                             paillier_get_rand_devurandom, NULL);
+
+    // free temporary variables
+    BOOST_FOREACH(paillier_plaintext_t* plaintext, plaintexts)
+        paillier_freeplaintext(plaintext);
+
+    return cipher;
+}
+
 VotingResult
-ElectionManager::createVote(std::set<Ballot> votes, TxVote** voteOut)
+ElectionManager::createVote(std::set<Ballot> votes, TxVote** voteOut, ProofPool* pool)
 {
     // first simple test to check if all questions are answered
     if (votes.size() != this->transaction->election->questions.size())
@@ -162,6 +201,10 @@ ElectionManager::createVote(std::set<Ballot> votes, TxVote** voteOut)
             if (ballot.questionID != question.id)
                 continue;
 
+            // check that the answer exists (or is abstained)
+            if (ballot.answer < -1 || ballot.answer >= (int) question.answers.size())
+                return VotingResult::INVALID_ANSWER;
+
             checked.insert(question.id);
         }
     }
@@ -170,32 +213,44 @@ ElectionManager::createVote(std::set<Ballot> votes, TxVote** voteOut)
     if (votes.size() != checked.size())
         return VotingResult::UNKNOWN_QUESTION;
 
+    // answers by question
+    std::map<uint160, int> answers;
+    BOOST_FOREACH(Ballot ballot, votes)
+        answers[ballot.questionID] = ballot.answer;
+
     // encrypt ballots
     std::set<EncryptedBallot> result;
-    BOOST_FOREACH(Ballot ballot, votes)
+    Election* election = this->transaction->election;
+    if (election->packed)
     {
-        // do not include vote if abstained
-        if (ballot.answer == -1)
-            continue;
-
-        // encrypt vote
-        paillier_pubkey_t* key = this->transaction->election->encPubKey;
-        paillier_plaintext_t* plain = paillier_plaintext_from_ui(ballot.answer);
-
-        // As long as the plaintext equals its index (i.e. plaintexts are 0 and 1 in this order)
-        // we can just take the answer as choice.
-        PLAINTEXT_SELECTION choice = static_cast<PLAINTEXT_SELECTION>(ballot.answer);
-        paillier_ciphertext_proof_t* cipher = paillier_enc_proof(key, choice, paillier_get_rand_devurandom, NULL);
+        // one ballot per pack, every question of it gets a slot
+        std::map<uint160, std::vector<Question>> packs = election->getPacks();
+        std::map<uint160, std::vector<Question>>::iterator pack;
+        for (pack = packs.begin(); pack != packs.end(); pack++)
+        {
+            EncryptedBallot encrypt;
+            encrypt.questionID = pack->first;
+            BOOST_FOREACH(const Question &question, pack->second)
+                encrypt.slots.push_back(this->encryptAnswer(question, answers[question.id], pool));
 
-        // prepare ballot
-        EncryptedBallot encrypt;
-        encrypt.questionID = ballot.questionID;
-        encrypt.answer = cipher;
+            result.insert(encrypt);
+        }
+    }
+    else
+    {
+        BOOST_FOREACH(const Question &question, election->questions)
+        {
+            // do not include vote if abstained
+            if (answers[question.id] == -1)
+                continue;
 
-        // free temporary variables
-        paillier_freeplaintext(plain);
+            // prepare ballot
+            EncryptedBallot encrypt;
+            encrypt.questionID = question.id;
+            encrypt.answer = this->encryptAnswer(question, answers[question.id], pool);
 
-        result.insert(encrypt);
+            result.insert(encrypt);
+        }
     }
 
     // prepare vote
@@ -210,6 +265,41 @@ ElectionManager::createVote(std::set<Ballot> votes, TxVote** voteOut)
 
 // ----------------------------------------------------------------
 
+// orders partial decryptions by their trustees
+static bool
+compareTrustees(paillier_partialdecryption_proof_t* first, paillier_partialdecryption_proof_t* second)
+{
+    return first->id < second->id;
+}
+
+// combines the partial decryptions of one question
+static void
+combineQuestion(paillier_pubkey_t* key,
+                std::vector<std::pair<uint160, std::vector<paillier_partialdecryption_proof_t*>>> &questions,
+                std::vector<paillier_combiner_t*> &combiners,
+                std::vector<paillier_plaintext_t*> &plains, unsigned int index)
+{
+    plains[index] = paillier_combining(NULL, key, combiners[index], &questions[index].second[0]);
+}
+
+// frees the loaded trustee tallies (including their partial decryptions)
+static void
+freeTrusteeTallies(std::vector<TxTrusteeTally*> &trusteeTallies)
+{
+    BOOST_FOREACH(TxTrusteeTally* trusteeTally, trusteeTallies)
+    {
+        BOOST_FOREACH(const TalliedBallots &ballot, trusteeTally->partialDecryption)
+        {
+            if (ballot.answers)
+                paillier_freepartdecryptionproof(ballot.answers);
+        }
+
+        delete trusteeTally;
+    }
+
+    trusteeTallies.clear();
+}
+
 bool
 ElectionManager::tally(const uint256 &tallyHash)
 {
@@ -219,29 +309,41 @@ ElectionManager::tally(const uint256 &tallyHash)
 
     std::set<uint256> trusteeTallies = this->tallies[tallyHash];
 
-    // collect all ballots
+    paillier_pubkey_t* key = this->transaction->election->encPubKey;
+
+    // collect all ballots with a valid proof
+    // (the proofs of one trustee tally are checked at once).
+    // The loaded trustee tallies own the collected partial decryptions,
+    // so they are freed once the tally is done
     std::set<TalliedBallots> ballots;
+    std::vector<TxTrusteeTally*> loaded;
     BOOST_FOREACH(uint256 ttHash, trusteeTallies)
     {
         // get trustee tally transaction
         Transaction* transaction = NULL;
-        BlockChainDB::getTransaction(ttHash, &transaction);
+        if (BlockChainDB::getTransaction(ttHash, &transaction) != BC_OK)
+            continue;
 
-        TxTrusteeTally* trusteeTally = (TxTrusteeTally*) transaction;
+        TxTrusteeTally* trusteeTally = dynamic_cast<TxTrusteeTally*>(transaction);
+        if (!trusteeTally)
+        {
+            delete transaction;
+            continue;
+        }
+
+        loaded.push_back(trusteeTally);
 
         // gather
-        ballots.insert(trusteeTally->partialDecryption.begin(),
-                       trusteeTally->partialDecryption.end());
+        if (!trusteeTally->verifyDecryptions(key, &ballots))
+            Log::e("(ElectionManager) Trustee tally contains invalid partial decryptions");
     }
 
-    paillier_pubkey_t* key = this->transaction->election->encPubKey;
-
     /*
        reason for use of vector instead of set:
        easy conversion from vector to array (pointer), which doesn't
        apply for sets, since former are memory contiguous.
     */
-    // sort all ballots reg. question IDs
+    // sort all ballots reg. question IDs (of the packs)
     std::map<uint160, std::vector<paillier_partialdecryption_proof_t*>> decryptionSets;
     BOOST_FOREACH(TalliedBallots ballot, ballots)
     {
@@ -253,8 +355,11 @@ ElectionManager::tally(const uint256 &tallyHash)
         if (decryptionSets[ballot.questionID].size() >= key->threshold)
             continue;
 
-        // check if the proof is valid
-        if (!paillier_verify_decryption(key, ballot.answers))
+        // only one partial decryption per trustee
+        bool seen = false;
+        BOOST_FOREACH(paillier_partialdecryption_proof_t* proof, decryptionSets[ballot.questionID])
+            seen |= (proof->id == ballot.answers->id);
+        if (seen)
             continue;
 
         // add proof to question's set
@@ -267,74 +372,504 @@ ElectionManager::tally(const uint256 &tallyHash)
     {
         // check if enough ballots to tally
         if (iter->second.size() < key->threshold)
+        {
+            freeTrusteeTallies(loaded);
             return false;
+        }
     }
 
-    // perform tallying
+    // the Lagrange coefficients only depend on the trustees,
+    // so all questions decrypted by the same trustees share them
+    std::vector<std::pair<uint160, std::vector<paillier_partialdecryption_proof_t*>>> questions;
+    std::vector<paillier_combiner_t*> combiners;
+    std::map<std::vector<int>, paillier_combiner_t*> subsets;
     for (iter = decryptionSets.begin(); iter != decryptionSets.end(); iter++)
     {
-        // decrypt votes
-        paillier_partialdecryption_proof_t** decryptions = &iter->second[0];
-        paillier_plaintext_t* plain = paillier_combining(NULL, key, decryptions);
+        std::sort(iter->second.begin(), iter->second.end(), &compareTrustees);
+
+        std::vector<int> ids;
+        BOOST_FOREACH(paillier_partialdecryption_proof_t* proof, iter->second)
+            ids.push_back(proof->id);
+
+        if (!subsets.count(ids))
+            subsets[ids] = paillier_create_combiner(key, &ids[0]);
+
+        questions.push_back(*iter);
+        combiners.push_back(subsets[ids]);
+    }
+
+    // perform tallying (in parallel)
+    std::vector<paillier_plaintext_t*> plains(questions.size());
+    Helper::ParallelFor(questions.size(), boost::bind(&combineQuestion, key, boost::ref(questions),
+                                                      boost::ref(combiners), boost::ref(plains), _1));
 
-        Ballot b;
-        b.questionID = iter->first;
-        b.answer = mpz_get_ui(plain->m);
+    Election* election = this->transaction->election;
+    unsigned long base = election->getBase();
+    std::map<uint160, QuestionSlot> slots = election->getSlots();
+
+    for (unsigned int i = 0; i < questions.size(); i++)
+    {
+        if (!plains[i])
+        {
+            Log::e("(ElectionManager) Could not combine partial decryptions of a question");
+            continue;
+        }
 
-        paillier_freeplaintext(plain);
+        // unpack the number of ballots per answer of every question of the pack
+        BOOST_FOREACH(const Question &question, election->questions)
+        {
+            QuestionSlot &slot = slots[question.id];
+            if (slot.pack == questions[i].first)
+                this->results[tallyHash][question.id] = question.getCounts(plains[i], base, slot.offset);
+        }
 
-        // update results
-        this->results[tallyHash].insert(b);
+        paillier_freeplaintext(plains[i]);
     }
 
+    std::map<std::vector<int>, paillier_combiner_t*>::iterator subset;
+    for (subset = subsets.begin(); subset != subsets.end(); subset++)
+        paillier_freecombiner(subset->second);
+
+    freeTrusteeTallies(loaded);
     return true;
 }
 
 // ----------------------------------------------------------------
 
-bool
-ElectionManager::createTrusteeTally(TxTally* tally, paillier_partialkey_t* privateKey, TxTrusteeTally** tallyOut)
+// Proofs of one question, which are verified by one thread (see checkBallots)
+struct ProofChunk
+{
+    paillier_ciphertext_proof_t** proofs;
+    unsigned int count;
+
+    // encodings of the answers of the question
+    std::vector<paillier_plaintext_t*>* plaintexts;
+
+    // validity of every proof
+    bool* valid;
+};
+
+static void
+verifyChunk(paillier_pubkey_t* key, std::vector<ProofChunk> &chunks, unsigned int index)
+{
+    // only consider valid votes, i.e. the encrypted plaintext
+    // is element of a specified set of allowed plaintexts
+    // (the proofs of the chunk are verified together)
+    ProofChunk &chunk = chunks[index];
+    paillier_verify_enc_batch(key, chunk.proofs, chunk.count, &(*chunk.plaintexts)[0], chunk.plaintexts->size(),
+                              chunk.valid, paillier_get_rand_devurandom);
+}
+
+std::vector<bool>
+ElectionManager::checkBallots(Election* election, const std::vector<const EncryptedBallot*> &ballots)
+{
+    paillier_pubkey_t* key = election->encPubKey;
+    std::map<uint160, std::vector<Question>> packs = election->getPacks();
+
+    // encodings of the answers of every question
+    std::map<uint160, std::vector<paillier_plaintext_t*>> plaintexts;
+    BOOST_FOREACH(const Question &question, election->questions)
+        plaintexts[question.id] = election->getPlaintexts(question);
+
+    // group the proofs by question, remembering their ballots. Ballots of
+    // packed elections hold a proof per question of their pack, others
+    // a single one (and every question is a pack of its own).
+    std::vector<char> valid(ballots.size(), false);
+    std::map<uint160, std::vector<paillier_ciphertext_proof_t*>> proofs;
+    std::map<uint160, std::vector<unsigned int>> owners;
+    for (unsigned int i = 0; i < ballots.size(); i++)
+    {
+        const EncryptedBallot* ballot = ballots[i];
+        if (!packs.count(ballot->questionID))
+            continue;
+
+        std::vector<Question> &pack = packs[ballot->questionID];
+        if (election->packed ? (ballot->answer || ballot->slots.size() != pack.size())
+                             : (!ballot->answer || !ballot->slots.empty()))
+            continue;
+        if (std::count(ballot->slots.begin(), ballot->slots.end(), (paillier_ciphertext_proof_t*) NULL))
+            continue;
+
+        for (unsigned int j = 0; j < pack.size(); j++)
+        {
+            proofs[pack[j].id].push_back(election->packed ? ballot->slots[j] : ballot->answer);
+            owners[pack[j].id].push_back(i);
+        }
+
+        valid[i] = true;
+    }
+
+    // split them into chunks, which the threads take one after another
+    std::map<uint160, bool*> results;
+    std::vector<ProofChunk> chunks;
+    std::map<uint160, std::vector<paillier_ciphertext_proof_t*>>::iterator question;
+    for (question = proofs.begin(); question != proofs.end(); question++)
+    {
+        std::vector<paillier_ciphertext_proof_t*> &questionProofs = question->second;
+        results[question->first] = new bool[questionProofs.size()];
+
+        for (unsigned int start = 0; start < questionProofs.size(); start += Settings::TALLY_BALLOTS_AT_ONCE)
+        {
+            ProofChunk chunk;
+            chunk.proofs = &questionProofs[start];
+            chunk.count = std::min<unsigned int>(Settings::TALLY_BALLOTS_AT_ONCE, questionProofs.size() - start);
+            chunk.plaintexts = &plaintexts[question->first];
+            chunk.valid = results[question->first] + start;
+            chunks.push_back(chunk);
+        }
+    }
+
+    Helper::ParallelFor(chunks.size(), boost::bind(&verifyChunk, key, boost::ref(chunks), _1));
+
+    // a ballot is only valid with all of its proofs
+    std::map<uint160, bool*>::iterator result;
+    for (result = results.begin(); result != results.end(); result++)
+    {
+        std::vector<unsigned int> &questionOwners = owners[result->first];
+        for (unsigned int i = 0; i < questionOwners.size(); i++)
+        {
+            if (!result->second[i])
+                valid[questionOwners[i]] = false;
+        }
+
+        delete[] result->second;
+    }
+
+    std::map<uint160, std::vector<paillier_plaintext_t*>>::iterator encodings;
+    for (encodings = plaintexts.begin(); encodings != plaintexts.end(); encodings++)
+    {
+        BOOST_FOREACH(paillier_plaintext_t* plaintext, encodings->second)
+            paillier_freeplaintext(plaintext);
+    }
+
+    return std::vector<bool>(valid.begin(), valid.end());
+}
+
+// ----------------------------------------------------------------
+
+// Valid ballots of one pack, which are multiplied
+// by one thread (see combineBallots)
+struct BallotChunk
+{
+    uint160 pack;
+    const EncryptedBallot** ballots;
+    unsigned int count;
+
+    // questions of the pack
+    const std::vector<Question>* questions;
+
+    // product of the ballots
+    paillier_ciphertext_pure_t* product = NULL;
+};
+
+static void
+combineChunk(Election* election, std::vector<BallotChunk> &chunks, unsigned int index)
 {
-    // collect all ballots until last block
-    std::set<EncryptedBallot> ballots = this->getAllVotes(tally->lastBlock);
+    BallotChunk &chunk = chunks[index];
+    paillier_pubkey_t* key = election->encPubKey;
 
-    if (ballots.size() == 0)
+    if (!election->packed)
+    {
+        chunk.product = paillier_create_enc_zero();
+        for (unsigned int i = 0; i < chunk.count; i++)
+            paillier_mul(key, chunk.product, chunk.product, chunk.ballots[i]->answer);
+        return;
+    }
+
+    // multiply the slots of every question, and pack
+    // their products once (instead of every ballot)
+    std::vector<paillier_ciphertext_pure_t*> slots;
+    for (unsigned int j = 0; j < chunk.questions->size(); j++)
+    {
+        slots.push_back(paillier_create_enc_zero());
+        for (unsigned int i = 0; i < chunk.count; i++)
+            paillier_mul(key, slots[j], slots[j], chunk.ballots[i]->slots[j]);
+    }
+
+    chunk.product = election->packSlots(*chunk.questions, slots);
+
+    BOOST_FOREACH(paillier_ciphertext_pure_t* slot, slots)
+        paillier_freeciphertext(slot);
+}
+
+std::map<uint160, paillier_ciphertext_pure_t*>
+ElectionManager::combineBallots(Election* election, const std::multiset<EncryptedBallot> &ballots)
+{
+    paillier_pubkey_t* key = election->encPubKey;
+    std::map<uint160, std::vector<Question>> packs = election->getPacks();
+
+    std::vector<const EncryptedBallot*> candidates;
+    BOOST_FOREACH(const EncryptedBallot &ballot, ballots)
+        candidates.push_back(&ballot);
+
+    // group the valid ballots by pack
+    std::vector<bool> valid = ElectionManager::checkBallots(election, candidates);
+    std::map<uint160, std::vector<const EncryptedBallot*>> packBallots;
+    for (unsigned int i = 0; i < candidates.size(); i++)
+    {
+        if (valid[i])
+            packBallots[candidates[i]->questionID].push_back(candidates[i]);
+    }
+
+    // split them into chunks, which the threads take one after another
+    std::vector<BallotChunk> chunks;
+    std::map<uint160, std::vector<const EncryptedBallot*>>::iterator pack;
+    for (pack = packBallots.begin(); pack != packBallots.end(); pack++)
+    {
+        std::vector<const EncryptedBallot*> &current = pack->second;
+        for (unsigned int start = 0; start < current.size(); start += Settings::TALLY_BALLOTS_AT_ONCE)
+        {
+            BallotChunk chunk;
+            chunk.pack = pack->first;
+            chunk.ballots = &current[start];
+            chunk.count = std::min<unsigned int>(Settings::TALLY_BALLOTS_AT_ONCE, current.size() - start);
+            chunk.questions = &packs[pack->first];
+            chunks.push_back(chunk);
+        }
+    }
+
+    Helper::ParallelFor(chunks.size(), boost::bind(&combineChunk, election, boost::ref(chunks), _1));
+
+    // collect the partial products of every pack
+    std::map<uint160, std::vector<paillier_ciphertext_pure_t*>> partials;
+    BOOST_FOREACH(const BallotChunk &chunk, chunks)
+        partials[chunk.pack].push_back(chunk.product);
+
+    // combine them pairwise (reduction tree)
+    std::map<uint160, paillier_ciphertext_pure_t*> combinations;
+    std::map<uint160, std::vector<paillier_ciphertext_pure_t*>>::iterator iter;
+    for (iter = partials.begin(); iter != partials.end(); iter++)
+    {
+        std::vector<paillier_ciphertext_pure_t*> &level = iter->second;
+        for (unsigned int step = 1; step < level.size(); step *= 2)
+        {
+            for (unsigned int i = 0; i + step < level.size(); i += 2 * step)
+            {
+                paillier_mul(key, level[i], level[i], level[i + step]);
+                paillier_freeciphertext(level[i + step]);
+            }
+        }
+
+        combinations[iter->first] = level[0];
+    }
+
+    return combinations;
+}
+
+// ----------------------------------------------------------------
+
+// frees the sums of the given snapshot
+static void
+freeSnapshot(TallySnapshot &snapshot)
+{
+    TallySnapshot::iterator iter;
+    for (iter = snapshot.begin(); iter != snapshot.end(); iter++)
+        paillier_freeciphertext(iter->second.sum);
+    snapshot.clear();
+}
+
+void
+ElectionManager::startRunningTally(unsigned int height)
+{
+    this->runningTallyStart = height;
+}
+
+bool
+ElectionManager::countVotes(Block* block, unsigned int height)
+{
+    // not tracked or already counted
+    if (this->runningTallyStart == 0 || height < this->runningTallyStart)
+        return false;
+    if (!this->runningTally.empty() && height <= this->runningTally.rbegin()->first)
         return false;
 
+    uint256 hash = this->transaction->getHash();
     paillier_pubkey_t* key = this->transaction->election->encPubKey;
 
-    // compute combinations of respective questions
-    std::map<uint160, paillier_ciphertext_pure_t*> combinations;
-    BOOST_FOREACH(EncryptedBallot ballot, ballots)
+    // votes of this election, only the first of every voter counts
+    // within one block (as in getAllVotes)
+    std::vector<TxVote*> votes;
+    std::set<CKeyID> voters;
+    BOOST_FOREACH(Transaction* txCurrent, block->transactions)
     {
-        // only consider valid votes, i.e. the encrypted plaintext
-        // is element of a specified set of allowed plaintexts
-        if (!paillier_verify_enc(key, ballot.answer))
+        if (txCurrent->getType() != TxType::TX_VOTE)
             continue;
 
-        // initialize if not set yet
-        if (!combinations.count(ballot.questionID))
-            combinations[ballot.questionID] = paillier_create_enc_zero();
+        TxVote *txVote = (TxVote*) txCurrent;
+        if (hash != txVote->election)
+            continue;
 
-        // combine two encrypted answers
-        paillier_mul(key, combinations[ballot.questionID], combinations[ballot.questionID], ballot.answer);
+        if (voters.insert(txVote->getPublicKey().GetID()).second)
+            votes.push_back(txVote);
     }
 
-    // compute proof for each question
-    std::set<TalliedBallots> tallies;
-    std::map<uint160, paillier_ciphertext_pure_t*>::iterator iter;
-    for(iter = combinations.begin(); iter != combinations.end(); iter++)
+    if (votes.empty())
+        return false;
+
+    // only verified ballots may be counted, otherwise the sums would differ
+    // from combineBallots. The ballots of accepted blocks were verified
+    // already (see Controller::receiveBlock), so this is only a lookup.
+    if (!TxVote::verifyBallots(votes))
     {
-        // create proof
-        paillier_partialdecryption_proof_t* proof = paillier_dec_proof(key, privateKey, iter->second, paillier_get_rand_devurandom, NULL);
+        Log::e("(ElectionManager) Block with invalid ballots, stop running tally");
+
+        // tallies fall back to all votes (see getAllVotes)
+        std::map<unsigned int, TallySnapshot>::iterator snapshot;
+        for (snapshot = this->runningTally.begin(); snapshot != this->runningTally.end(); snapshot++)
+            freeSnapshot(snapshot->second);
+        this->runningTally.clear();
+        this->countedVotes.clear();
+        this->runningTallyStart = 0;
+        return true;
+    }
+
+    // ballots of packed elections are counted as the packing of their slots
+    Election* election = this->transaction->election;
+    std::map<uint160, std::vector<Question>> packs = election->getPacks();
 
+    // continue with a copy of the latest snapshot
+    TallySnapshot current;
+    if (!this->runningTally.empty())
+    {
+        TallySnapshot &latest = this->runningTally.rbegin()->second;
+        TallySnapshot::iterator iter;
+        for (iter = latest.begin(); iter != latest.end(); iter++)
+        {
+            current[iter->first].sum = paillier_copyciphertext(iter->second.sum);
+            current[iter->first].count = iter->second.count;
+        }
+    }
+
+    BOOST_FOREACH(TxVote* txVote, votes)
+    {
+        CKeyID voter = txVote->getPublicKey().GetID();
+
+        // remove the former vote of the voter
+        Transaction* former = NULL;
+        if (this->countedVotes.count(voter) &&
+                BlockChainDB::getTransaction(this->countedVotes[voter], &former) == BlockChainStatus::BC_OK)
+        {
+            BOOST_FOREACH(const EncryptedBallot &ballot, ((TxVote*) former)->ballots)
+            {
+                if (!current.count(ballot.questionID))
+                    continue;
+
+                QuestionSum &question = current[ballot.questionID];
+                paillier_ciphertext_pure_t* ciphertext = election->getCiphertext(ballot, packs);
+                paillier_div(key, question.sum, question.sum, ciphertext);
+                paillier_freeciphertext(ciphertext);
+                question.count--;
+            }
+
+            delete former;
+        }
+
+        BOOST_FOREACH(const EncryptedBallot &ballot, txVote->ballots)
+        {
+            QuestionSum &question = current[ballot.questionID];
+            if (!question.sum)
+                question.sum = paillier_create_enc_zero();
+
+            paillier_ciphertext_pure_t* ciphertext = election->getCiphertext(ballot, packs);
+            paillier_mul(key, question.sum, question.sum, ciphertext);
+            paillier_freeciphertext(ciphertext);
+            question.count++;
+        }
+
+        this->countedVotes[voter] = txVote->getHash();
+    }
+
+    // questions without ballots are left out (as in combineBallots)
+    TallySnapshot::iterator iter = current.begin();
+    while (iter != current.end())
+    {
+        if (iter->second.count > 0)
+        {
+            iter++;
+            continue;
+        }
+
+        paillier_freeciphertext(iter->second.sum);
+        current.erase(iter++);
+    }
+
+    this->runningTally[height] = current;
+
+    // forget the oldest snapshots
+    while (this->runningTally.size() > Settings::TALLY_SNAPSHOTS)
+    {
+        freeSnapshot(this->runningTally.begin()->second);
+        this->runningTally.erase(this->runningTally.begin());
+        this->runningTallyStart = this->runningTally.begin()->first;
+    }
+
+    return true;
+}
+
+bool
+ElectionManager::getRunningTally(const uint256 &block, std::map<uint160, paillier_ciphertext_pure_t*> &sumsOut)
+{
+    unsigned int height;
+    if (this->runningTallyStart == 0 ||
+            BlockChainDB::getHeight(block, height) != BlockChainStatus::BC_OK ||
+            height < this->runningTallyStart)
+        return false;
+
+    // latest snapshot not after the given block (none: no votes yet)
+    std::map<unsigned int, TallySnapshot>::iterator snapshot = this->runningTally.upper_bound(height);
+    if (snapshot == this->runningTally.begin())
+        return true;
+    snapshot--;
+
+    TallySnapshot::iterator iter;
+    for (iter = snapshot->second.begin(); iter != snapshot->second.end(); iter++)
+        sumsOut[iter->first] = paillier_copyciphertext(iter->second.sum);
+
+    return true;
+}
+
+// ----------------------------------------------------------------
+
+// creates the partial decryption (with proof) of one question
+static void
+decryptQuestion(paillier_pubkey_t* key, paillier_partialkey_t* privateKey,
+                std::vector<std::pair<uint160, paillier_ciphertext_pure_t*>> &combinations,
+                std::vector<paillier_partialdecryption_proof_t*> &proofs, unsigned int index)
+{
+    proofs[index] = paillier_dec_proof(key, privateKey, combinations[index].second, paillier_get_rand_devurandom, NULL);
+}
+
+bool
+ElectionManager::createTrusteeTally(TxTally* tally, paillier_partialkey_t* privateKey, TxTrusteeTally** tallyOut)
+{
+    paillier_pubkey_t* key = this->transaction->election->encPubKey;
+
+    // read the combinations of respective questions from the running tally,
+    // or collect all ballots until last block and combine them
+    std::map<uint160, paillier_ciphertext_pure_t*> products;
+    if (!this->getRunningTally(tally->lastBlock, products))
+        products = ElectionManager::combineBallots(this->transaction->election, this->getAllVotes(tally->lastBlock));
+
+    if (products.empty())
+        return false;
+
+    std::vector<std::pair<uint160, paillier_ciphertext_pure_t*>> combinations(products.begin(), products.end());
+
+    // compute proof for each question (in parallel)
+    std::vector<paillier_partialdecryption_proof_t*> proofs(combinations.size());
+    Helper::ParallelFor(combinations.size(), boost::bind(&decryptQuestion, key, privateKey,
+                                                         boost::ref(combinations), boost::ref(proofs), _1));
+
+    std::set<TalliedBallots> tallies;
+    for (unsigned int i = 0; i < combinations.size(); i++)
+    {
         // prepare tallied ballot
         TalliedBallots ballot;
-        ballot.questionID = iter->first;
-        ballot.answers = proof;
+        ballot.questionID = combinations[i].first;
+        ballot.answers = proofs[i];
         tallies.insert(ballot);
 
-        paillier_freeciphertext(iter->second);
+        paillier_freeciphertext(combinations[i].second);
     }
 
     // create transaction
@@ -349,10 +884,10 @@ ElectionManager::createTrusteeTally(TxTally* tally, paillier_partialkey_t* priva
 
 // ----------------------------------------------------------------
 
-std::set<EncryptedBallot>
+std::multiset<EncryptedBallot>
 ElectionManager::getAllVotes(uint256 lastBlock)
 {
-    std::set<EncryptedBallot> result;
+    std::multiset<EncryptedBallot> result;
 
     uint256 hash = this->transaction->getHash();
 
@@ -387,7 +922,8 @@ ElectionManager::getAllVotes(uint256 lastBlock)
             if (!voters.insert(txVote->getPublicKey().GetID()).second)
                 continue;
 
-            // insert all all ballots from this vote
+            // insert all all ballots from this vote (as often as they were
+            // cast, like the running tally counts them, see countVotes)
             result.insert(txVote->ballots.begin(), txVote->ballots.end());
         }
     }
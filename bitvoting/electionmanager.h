@@ -10,7 +10,9 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #ifndef BITVOTING_ELECTIONMANAGER_H
 #define BITVOTING_ELECTIONMANAGER_H
 
+#include "block.h"
 #include "election.h"
+#include "proofpool.h"
 #include "transactions/election.h"
 #include "transactions/vote.h"
 #include "transactions/trustee_tally.h"
@@ -22,10 +24,13 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 
 #include <set>
 #include <map>
+#include <vector>
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 // ==========================================================================
 
@@ -34,11 +39,38 @@ enum VotingResult
     OK,                 // ok
     INVALID_COUNT,      // invalid count of answers given
     DUPLICATE_QUESTION, // answered one question more than once
-    UNKNOWN_QUESTION    // question is unknown to this election
+    UNKNOWN_QUESTION,   // question is unknown to this election
+    INVALID_ANSWER      // answer is unknown to its question
 };
 
 // ==========================================================================
 
+// Homomorphic sum of the ballots counted for one question, or one pack of
+// questions (see Election::getSlots, ElectionManager::runningTally)
+typedef struct QuestionSum_t
+{
+    paillier_ciphertext_pure_t* sum = NULL;
+
+    // Number of ballots in the sum
+    unsigned int count = 0;
+
+    // ----------------------------------------------------------------
+
+    template <typename Archive>
+    void serialize(Archive& a, const unsigned int)
+    {
+        a & this->sum;
+        a & this->count;
+    }
+} QuestionSum;
+
+typedef std::map<uint160, QuestionSum> TallySnapshot;
+
+// Number of ballots per answer of every question (see Question::getCounts)
+typedef std::map<uint160, std::vector<unsigned long>> TallyResult;
+
+// ==========================================================================
+
 class TxVote;
 class TxTally;
 class TxElection;
@@ -63,7 +95,18 @@ public:
     std::map<uint256, std::set<uint256>> tallies;
 
     // Register all results (hash of tally transaction + computed results)
-    std::map<uint256, std::set<Ballot>> results;
+    std::map<uint256, TallyResult> results;
+
+    // Running tally: sums of the latest vote of every voter per question
+    // after the block of the given height. Snapshots are only taken for
+    // blocks with votes of this election (the last TALLY_SNAPSHOTS ones).
+    std::map<unsigned int, TallySnapshot> runningTally;
+
+    // Votes in the running tally (voter + hash of vote transaction)
+    std::map<CKeyID, uint256> countedVotes;
+
+    // Height of the first block covered by the running tally (0: none)
+    unsigned int runningTallyStart = 0;
 
     // ----------------------------------------------------------------
 
@@ -99,8 +142,9 @@ public:
     // Obtain the original question to a given question ID
     bool getQuestion(uint160, Question&) const;
 
-    // Create a vote given the given answers
-    VotingResult createVote(std::set<Ballot>, TxVote**);
+    // Create a vote given the given answers (using precomputed
+    // encryptions of the given pool, if any)
+    VotingResult createVote(std::set<Ballot>, TxVote**, ProofPool* = NULL);
 
     // Perform the tallying for the given transaction
     bool tally(const uint256 &tallyHash);
@@ -108,6 +152,32 @@ public:
     // Create a partial tally given the original tally transaction + corresponding key
     bool createTrusteeTally(TxTally*, paillier_partialkey_t*, TxTrusteeTally**);
 
+    // Start the running tally with the block of the given height
+    // (which contains the election)
+    void startRunningTally(unsigned int);
+
+    // Count the votes of the given block (of the given height) into the
+    // running tally, replacing former votes of the same voters. A block
+    // with invalid ballots stops the running tally.
+    // Returns false, if nothing changed.
+    bool countVotes(Block*, unsigned int);
+
+    // Obtain the sums per pack of the running tally after the given
+    // block, fails if it is not covered (anymore). The sums have to be
+    // freed by the caller.
+    bool getRunningTally(const uint256&, std::map<uint160, paillier_ciphertext_pure_t*>&);
+
+    // Verify the proofs of the answers of the given ballots of the given
+    // election (of all slots for packed ballots, using all cores).
+    // Returns the validity of every ballot.
+    static std::vector<bool> checkBallots(Election*, const std::vector<const EncryptedBallot*>&);
+
+    // Verify the given ballots of the given election and multiply the
+    // valid ones per pack (see Election::getSlots, using all cores). Packs
+    // without valid ballots are left out, the products have to be freed
+    // by the caller.
+    static std::map<uint160, paillier_ciphertext_pure_t*> combineBallots(Election*, const std::multiset<EncryptedBallot>&);
+
     // ----------------------------------------------------------------
 
     inline bool operator<(/*const*/ ElectionManager& other) /*const*/
@@ -117,22 +187,54 @@ public:
 
 private:
     // Gather all votes until a given block
-    std::set<EncryptedBallot> getAllVotes(uint256);
+    std::multiset<EncryptedBallot> getAllVotes(uint256);
+
+    // Encrypt the given answer (-1 means abstained) to the given question
+    // with a proof over its plaintexts (see Election::getPlaintexts)
+    paillier_ciphertext_proof_t* encryptAnswer(const Question&, int, ProofPool*);
 
     // ----------------------------------------------------------------
 
     friend class boost::serialization::access;
 
     template <typename Archive>
-    void serialize(Archive& a, const unsigned int)
+    void serialize(Archive& a, const unsigned int version)
     {
         // DO NOT SERIALIZE ELECTION, AS IT WILL BE RECOVERED BY THE DB
         a & this->ended;
         a & this->votesRegistered;
         a & this->myVotes;
         a & this->tallies;
-        a & this->results;
+
+        // results stored before questions had more than two answers
+        // (the count of the second answer per question)
+        if (version < 2)
+        {
+            std::map<uint256, std::set<Ballot>> results;
+            a & results;
+
+            std::map<uint256, std::set<Ballot>>::iterator iter;
+            for (iter = results.begin(); iter != results.end(); iter++)
+            {
+                BOOST_FOREACH(const Ballot &ballot, iter->second)
+                    this->results[iter->first][ballot.questionID].push_back(ballot.answer);
+            }
+        }
+        else
+        {
+            a & this->results;
+        }
+
+        // managers stored before the running tally was introduced
+        if (version == 0)
+            return;
+
+        a & this->runningTally;
+        a & this->countedVotes;
+        a & this->runningTallyStart;
     }
 };
 
+BOOST_CLASS_VERSION(ElectionManager, 2)
+
 #endif // ELECTIONMANAGER_H
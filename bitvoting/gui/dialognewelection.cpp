@@ -50,6 +50,27 @@ void NewElectionDialog::createElection(Election** electionOut, paillier_partialk
     std::string desc = ui->descriptionPlaintextEdit->toPlainText().toStdString();
     boost::algorithm::trim(desc);
 
+    qint64 endingTime = ui->dtEnding->dateTime().toMSecsSinceEpoch();
+
+    // trustee set was already read in (before paillier key creation)
+
+    // --- create election ---
+
+    Election* result = new Election(this->readQuestions(), this->readVoters(), this->trustees);
+    result->name = name;
+    result->description = desc;
+    result->encPubKey = this->publicKey;
+    result->probableEndingTime = endingTime;
+    result->packed = ui->packQuestionsCheckBox->isChecked();
+
+    *electionOut = result;
+    *privateKeysOut = this->privateKeys;
+}
+
+// ----------------------------------------------------------------
+
+std::vector<Question> NewElectionDialog::readQuestions()
+{
     std::vector<Question> questions;
     for (int i = 0; i < this->ui->listQuestions->count(); i++)
     {
@@ -58,8 +79,13 @@ void NewElectionDialog::createElection(Election** electionOut, paillier_partialk
         questions.push_back(Question(current));
     }
 
-    qint64 endingTime = ui->dtEnding->dateTime().toMSecsSinceEpoch();
+    return questions;
+}
+
+// ----------------------------------------------------------------
 
+std::set<CKeyID> NewElectionDialog::readVoters()
+{
     std::set<CKeyID> voters;
     for (int i = 0; i < this->ui->votersList->count(); i++)
     {
@@ -67,18 +93,7 @@ void NewElectionDialog::createElection(Election** electionOut, paillier_partialk
         voters.insert(CKeyID(uint160(current)));
     }
 
-    // trustee set was already read in (before paillier key creation)
-
-    // --- create election ---
-
-    Election* result = new Election(questions, voters, this->trustees);
-    result->name = name;
-    result->description = desc;
-    result->encPubKey = this->publicKey;
-    result->probableEndingTime = endingTime;
-
-    *electionOut = result;
-    *privateKeysOut = this->privateKeys;
+    return voters;
 }
 
 // ----------------------------------------------------------------
@@ -260,10 +275,22 @@ void NewElectionDialog::done(int value)
         this->trustees.insert(CKeyID(uint160(current)));
     }
 
+    // the key has to hold the tallies of all questions
+    Election draft(this->readQuestions(), this->readVoters(), this->trustees);
+    draft.packed = ui->packQuestionsCheckBox->isChecked();
+    int plaintextLevel = draft.getPlaintextLevel(Settings::PAILLIER_BITS);
+    if (plaintextLevel > PAILLIER_MAX_S)
+    {
+        QMessageBox::warning(this, "Attention", "The tallies of the questions are too large, please remove answers or questions");
+        return;
+    }
+
     // generate and export paillier private keys
-    this->progressDialog= new QProgressDialog("Please wait while the keys are generated...", QString(), 0, 0, this);
+    this->progressDialog= new QProgressDialog("Please wait while the keys are generated...", "Cancel", 0, 2, this);
     this->progressDialog->setWindowModality(Qt::WindowModal);
     this->progressDialog->setWindowFlags(this->progressDialog->windowFlags() & ~Qt::WindowCloseButtonHint);
+    this->progressDialog->setAutoReset(false);
+    this->progressDialog->setAutoClose(false);
     this->progressDialog->show();
 
     QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
@@ -271,11 +298,16 @@ void NewElectionDialog::done(int value)
     this->publicKey = NULL;
     this->privateKeys = NULL;
     BackgroundWorker* progressThread = new BackgroundWorker(trustees.size(),
+                                                            plaintextLevel,
                                                             &this->publicKey,
                                                             &this->privateKeys);
 
+    connect(progressThread, &BackgroundWorker::progress,
+            this, &NewElectionDialog::onKeyCreationProgress);
     connect(progressThread, &BackgroundWorker::ready,
             this, &NewElectionDialog::onKeyCreationFinished);
+    connect(this->progressDialog, &QProgressDialog::canceled,
+            progressThread, &QThread::requestInterruption);
     connect(progressThread, &BackgroundWorker::finished,
             progressThread, &QObject::deleteLater);
 
@@ -285,6 +317,19 @@ void NewElectionDialog::done(int value)
 
 // ----------------------------------------------------------------
 
+void NewElectionDialog::onKeyCreationProgress(int primesFound, qulonglong tested)
+{
+    if (!this->progressDialog)
+        return;
+
+    this->progressDialog->setValue(primesFound);
+    this->progressDialog->setLabelText(QString("Please wait while the keys are generated...\n"
+                                               "(%1 of 2 primes found, %2 candidates tested)")
+                                       .arg(primesFound).arg(tested));
+}
+
+// ----------------------------------------------------------------
+
 void NewElectionDialog::onKeyCreationFinished()
 {
     Log::i("(GUI/NE) Finished");
@@ -293,6 +338,10 @@ void NewElectionDialog::onKeyCreationFinished()
     delete this->progressDialog;
     this->progressDialog = NULL;
 
+    // cancelled by the user, stay in the dialog
+    if (!this->publicKey)
+        return;
+
     QDialog::done(QDialog::Accepted);
 }
 
@@ -35,27 +35,46 @@ class BackgroundWorker : public QThread
     {
         Log::i("(GUI/NE) Generating keys...");
 
-        // create homomorphic keys
-        paillier_keygen(Settings::PAILLIER_BITS, this->nTrustees, this->nTrustees,
-                        this->publicKey, this->privateKeys, paillier_get_rand_devurandom);
+        // create homomorphic keys (outputs stay NULL, if interrupted)
+        if (!paillier_keygen(Settings::PAILLIER_BITS, this->nTrustees, this->nTrustees,
+                             this->publicKey, this->privateKeys, paillier_get_rand_devurandom,
+                             &BackgroundWorker::onProgress, this, this->plaintextLevel))
+            Log::i("(GUI/NE) Key generation cancelled");
 
         emit ready();
     }
 
+    // Reports the progress of the key generation,
+    // which is cancelled by requestInterruption
+    static bool onProgress(int primesFound, unsigned long tested, void* data)
+    {
+        BackgroundWorker* worker = (BackgroundWorker*) data;
+        emit worker->progress(primesFound, tested);
+
+        return !worker->isInterruptionRequested();
+    }
+
 public:
-    BackgroundWorker(int nTrustees, paillier_pubkey_t** pubKeyOut, paillier_partialkey_t*** privKeysOut) :
+    BackgroundWorker(int nTrustees, int plaintextLevel, paillier_pubkey_t** pubKeyOut, paillier_partialkey_t*** privKeysOut) :
         QThread(),
         nTrustees(nTrustees),
+        plaintextLevel(plaintextLevel),
         publicKey(pubKeyOut),
         privateKeys(privKeysOut) {}
 
 signals:
     void ready();
 
+    // Number of safe primes found (of two) and candidates tested so far
+    void progress(int primesFound, qulonglong tested);
+
 private:
     // How many trustee keys should be generated
     int nTrustees = 0;
 
+    // Plaintexts of the key are in Z_{n^s} for this s (see paillier_pubkey_t)
+    int plaintextLevel = 1;
+
     // Output variables
     paillier_pubkey_t** publicKey = NULL;
     paillier_partialkey_t*** privateKeys = NULL;
@@ -88,6 +107,7 @@ private slots:
     void on_btnQuestionRemove_clicked();
     void on_votersImportBtn_clicked();
     void on_trusteesImportBtn_clicked();
+    void onKeyCreationProgress(int primesFound, qulonglong tested);
     void onKeyCreationFinished();
     void on_listQuestions_itemChanged(QListWidgetItem *item);
     void on_votersList_itemChanged(QListWidgetItem *item);
@@ -112,6 +132,10 @@ private:
     // Verifies the input of the user
     bool verifyInputs();
 
+    // Reads the questions and voters from the user input
+    std::vector<Question> readQuestions();
+    std::set<CKeyID> readVoters();
+
     // Verifies a specific fingerprint
     bool checkFingerprint(const QString &fingerprint, bool showInfo);
 
@@ -387,7 +387,7 @@ void MainWindow::on_btnResults_clicked()
 
     // get all available tallies
     std::vector<uint256> tallies;
-    std::map<uint256, std::set<Ballot>>::iterator iter;
+    std::map<uint256, TallyResult>::iterator iter;
     for (iter = manager->results.begin(); iter != manager->results.end(); iter++)
     {
         // check if results are available for the given tally (should never fail)
@@ -411,20 +411,31 @@ void MainWindow::on_btnResults_clicked()
            manager->transaction->election->name.c_str(),
            manager->transaction->getHash().ToString().c_str());
 
-    std::set<Ballot> ballots = manager->results[tally];
+    TallyResult counts = manager->results[tally];
 
     // prepare results dialog
     std::string results;
-    BOOST_FOREACH(Ballot ballot, ballots)
+    TallyResult::iterator count;
+    for (count = counts.begin(); count != counts.end(); count++)
     {
         // obtain original question
         Question question;
-        if (!manager->getQuestion(ballot.questionID, question))
+        if (!manager->getQuestion(count->first, question))
             continue;
 
         results += question.question;
-        results += ":\t" + std::to_string(ballot.answer);
+
+        // yes/no questions only count the second answer
+        if (count->second.size() == 1)
+        {
+            results += ":\t" + std::to_string(count->second[0]);
+            results += "\n";
+            continue;
+        }
+
         results += "\n";
+        for (unsigned int i = 0; i < count->second.size() && i < question.answers.size(); i++)
+            results += "  " + question.answers[i] + ":\t" + std::to_string(count->second[i]) + "\n";
     }
 
     // show results
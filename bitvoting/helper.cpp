@@ -4,9 +4,11 @@
 #include <stdio.h>
 #include <ctime>
 #include <stdexcept>
+#include <atomic>
 
 #include <openssl/rand.h>
 
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/algorithm/string.hpp>
@@ -261,6 +263,114 @@ Helper::GenerateRandom256()
 
 // ----------------------------------------------------------------
 
+// takes the next index until all are taken (see ParallelFor)
+static void
+parallelWorker(std::atomic<unsigned int> *next, unsigned int count,
+               boost::function<void (unsigned int)> *work)
+{
+    unsigned int index;
+    while ((index = (*next)++) < count)
+        (*work)(index);
+}
+
+// Threads of ParallelFor, started once and kept waiting for the next loop
+class WorkerPool
+{
+public:
+
+    // one thread less than cores, since the calling thread works as well
+    WorkerPool()
+    {
+        unsigned int cores = std::max(1u, boost::thread::hardware_concurrency());
+        for (unsigned int i = 1; i < cores; i++)
+            boost::thread(boost::bind(&WorkerPool::loop, this)).detach();
+    }
+
+    // Run the given loop on all threads of the pool and the calling one.
+    // Returns false (without running it) if the pool is busy with another
+    // loop, e.g. when called from within a loop.
+    bool run(unsigned int count, boost::function<void (unsigned int)> &work)
+    {
+        boost::unique_lock<boost::mutex> busyLock(busy, boost::try_to_lock);
+        if (!busyLock.owns_lock())
+            return false;
+
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            this->work = &work;
+            this->count = count;
+            this->next = 0;
+        }
+        wake.notify_all();
+
+        parallelWorker(&next, count, &work);
+
+        // all indices are taken, wait for the threads still working on one.
+        // Threads waking up later do not join this loop anymore.
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (active > 0)
+            done.wait(lock);
+        this->work = NULL;
+
+        return true;
+    }
+
+private:
+
+    void loop()
+    {
+        while (true)
+        {
+            boost::function<void (unsigned int)> *job;
+            unsigned int jobCount;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (work == NULL || next >= count)
+                    wake.wait(lock);
+
+                job = work;
+                jobCount = count;
+                active++;
+            }
+
+            parallelWorker(&next, jobCount, job);
+
+            boost::lock_guard<boost::mutex> lock(mutex);
+            if (--active == 0)
+                done.notify_all();
+        }
+    }
+
+    // held while a loop is running
+    boost::mutex busy;
+
+    // protects the current loop and the number of threads working on it
+    boost::mutex mutex;
+    boost::condition_variable wake;
+    boost::condition_variable done;
+
+    boost::function<void (unsigned int)> *work = NULL;
+    unsigned int count = 0;
+    std::atomic<unsigned int> next;
+    unsigned int active = 0;
+};
+
+void
+Helper::ParallelFor(unsigned int count, boost::function<void (unsigned int)> work)
+{
+    // the threads are never stopped, so the pool is never destroyed
+    static WorkerPool *pool = new WorkerPool();
+
+    // a single index (or a busy pool) is run by the calling thread alone
+    if (count > 1 && pool->run(count, work))
+        return;
+
+    for (unsigned int i = 0; i < count; i++)
+        work(i);
+}
+
+// ----------------------------------------------------------------
+
 unsigned int
 Helper::GenerateRandomUInt()
 {
@@ -15,6 +15,7 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #include <fstream>
 
 #include <boost/filesystem.hpp>
+#include <boost/function.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/asio.hpp>
 #include <boost/archive/binary_oarchive.hpp>
@@ -140,6 +141,12 @@ public:
     // Generate a random number in [0,A]
     static int GenerateRandom(int);
 
+    // Call work(0) .. work(count-1) on all cores and wait for them.
+    // Every thread takes the next index as soon as it is done, so that
+    // uneven work is balanced. The threads are kept for later calls, nested
+    // or concurrent calls run in the calling thread while they are busy.
+    static void ParallelFor(unsigned int count, boost::function<void (unsigned int)> work);
+
     // Serialize a given object to file
     template<typename T>
     static void SaveToFile(T&, std::string, bool = false);
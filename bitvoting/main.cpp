@@ -9,6 +9,7 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #include "settings.h"
 #include "controller.h"
 #include "miner.h"
+#include "proofpool.h"
 #include "net/network.h"
 #include "net/protocols/pingpong.h"
 #include "net/protocols/initialize.h"
@@ -143,10 +144,13 @@ int main(int argc, char* argv[])
         // initialize mining
         MiningManager mining(&threadGroup, blocks);
 
+        // initialize precomputation of ballot encryptions
+        ProofPool proofPool(&threadGroup);
+
         // initialize application
         QApplication application(argc, argv);
         MainWindow gui;
-        Controller controller(gui, mining, transactions, blocks);
+        Controller controller(gui, mining, proofPool, transactions, blocks);
 
         // make initial connections
         BOOST_FOREACH(std::string peer, Settings::GetInitialPeers())
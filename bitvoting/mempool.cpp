@@ -0,0 +1,198 @@
+#include "mempool.h"
+
+#include "helper.h"
+#include "transactions/vote.h"
+
+#include <algorithm>
+
+// ================================================================
+
+Mempool::Mempool(unsigned int maxTransactions, uint64_t maxBytes) :
+    maxTransactions(maxTransactions),
+    maxBytes(maxBytes)
+{
+}
+
+Mempool::~Mempool()
+{
+    // the pooled transactions are owned by the pool
+    for (std::unordered_map<uint256, MempoolEntry, Uint256Hasher>::iterator it = entries.begin();
+         it != entries.end(); ++it)
+        delete it->second.transaction;
+}
+
+// ----------------------------------------------------------------
+
+bool
+Mempool::add(Transaction *transaction)
+{
+    uint256 hash = transaction->getHash();
+    if (this->contains(hash))
+        return false;
+
+    MempoolEntry &entry = entries[hash];
+    entry.transaction = transaction;
+    entry.hash = hash;
+    entry.bytes = transaction->getSize();
+    entry.sequence = nextSequence++;
+    entry.time = Helper::GetUNIXTimestamp();
+    totalBytes += entry.bytes;
+
+    // only the first pending vote of a voter may be mined
+    TxVote *vote = dynamic_cast<TxVote*>(transaction);
+    if (vote != NULL)
+    {
+        entry.isVote = true;
+        entry.voteKey = VoteKey(vote->election, vote->getPublicKey().GetID());
+
+        std::deque<MempoolEntry*> &pending = votes[entry.voteKey];
+        pending.push_back(&entry);
+
+        if (pending.size() > 1)
+            waiting[entry.sequence] = &entry;
+        else
+            this->setReady(&entry);
+    }
+    else
+    {
+        this->setReady(&entry);
+    }
+
+    this->evict(hash);
+
+    return this->contains(hash);
+}
+
+// ----------------------------------------------------------------
+
+Transaction*
+Mempool::remove(const uint256 &hash)
+{
+    if (!this->contains(hash))
+        return NULL;
+
+    return this->erase(hash);
+}
+
+// ----------------------------------------------------------------
+
+bool
+Mempool::contains(const uint256 &hash) const
+{
+    return entries.count(hash) > 0;
+}
+
+// ----------------------------------------------------------------
+
+void
+Mempool::select(unsigned int maxCount, uint64_t maxBytes, std::vector<Transaction*> &out) const
+{
+    out.clear();
+
+    // ready entries never contain two votes of the same voter
+    uint64_t bytes = 0;
+    for (std::map<uint64_t, MempoolEntry*>::const_iterator it = ready.begin();
+         it != ready.end() && out.size() < maxCount; ++it)
+    {
+        // keep the order of arrival, a transaction that is too large
+        // for an empty block is still mined (alone)
+        if (!out.empty() && bytes + it->second->bytes > maxBytes)
+            break;
+
+        bytes += it->second->bytes;
+        out.push_back(it->second->transaction);
+    }
+}
+
+// ----------------------------------------------------------------
+
+bool
+Mempool::isBlockDue(const BlockAssemblyPolicy &policy, long long now) const
+{
+    long long oldest;
+    if (!this->getOldestReadyTime(oldest))
+        return false;
+
+    return policy.isDue(ready.size(), readyBytes, now - oldest);
+}
+
+// ----------------------------------------------------------------
+
+bool
+Mempool::getOldestReadyTime(long long &timeOut) const
+{
+    if (ready.empty())
+        return false;
+
+    // oldest ready entry (smallest sequence) arrived first
+    timeOut = ready.begin()->second->time;
+    return true;
+}
+
+// ----------------------------------------------------------------
+
+void
+Mempool::setReady(MempoolEntry *entry)
+{
+    ready[entry->sequence] = entry;
+    readyBytes += entry->bytes;
+}
+
+// ----------------------------------------------------------------
+
+Transaction*
+Mempool::erase(const uint256 &hash)
+{
+    // copy, the given hash may belong to the erased entry
+    uint256 key = hash;
+    MempoolEntry &entry = entries[key];
+    Transaction *transaction = entry.transaction;
+
+    if (entry.isVote)
+    {
+        std::deque<MempoolEntry*> &pending = votes[entry.voteKey];
+        bool wasFirst = (pending.front() == &entry);
+        pending.erase(std::find(pending.begin(), pending.end(), &entry));
+
+        // the next vote of this voter may be mined now
+        if (wasFirst && !pending.empty())
+        {
+            MempoolEntry *next = pending.front();
+            waiting.erase(next->sequence);
+            this->setReady(next);
+        }
+
+        if (pending.empty())
+            votes.erase(entry.voteKey);
+    }
+
+    if (ready.erase(entry.sequence) > 0)
+        readyBytes -= entry.bytes;
+    waiting.erase(entry.sequence);
+    totalBytes -= entry.bytes;
+
+    entries.erase(key);
+    return transaction;
+}
+
+// ----------------------------------------------------------------
+
+void
+Mempool::evict(const uint256 &added)
+{
+    while (!entries.empty() && (entries.size() > maxTransactions || totalBytes > maxBytes))
+    {
+        // newest waiting vote first, then the newest transaction
+        MempoolEntry *victim;
+        if (!waiting.empty())
+            victim = waiting.rbegin()->second;
+        else
+            victim = ready.rbegin()->second;
+
+        Log::i("(Mempool) Pool is full, evicting transaction (Hash: %s)", victim->hash.ToString().c_str());
+        bool own = (victim->hash != added);
+        Transaction *transaction = this->erase(victim->hash);
+        if (own)
+            delete transaction;
+    }
+}
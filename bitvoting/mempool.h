@@ -0,0 +1,212 @@
+/*=============================================================================
+
+Pool of verified transactions waiting to be mined into a block.
+
+Transactions are kept in order of arrival (FIFO). A voter may only have one
+vote per election in a block, so later votes of the same voter (same
+election and verification key) wait until the earlier one left the pool.
+Transactions that may be mined right away are kept in a separate ordered
+index, so that selecting the next k transactions for a block takes O(k).
+
+The pool is bounded by number of transactions and bytes. If a bound is
+exceeded, waiting votes are evicted first (newest first), then the newest
+transactions, so the transactions waiting longest are kept.
+
+The pool owns the transactions it holds and deletes them once they are
+evicted. Removed (e.g. mined) transactions are handed back to the caller.
+Eviction never hits a block being mined: waiting votes are never selected,
+and the pool only overflows by the transaction just added.
+
+When to assemble a block and how large it may get is decided by a
+BlockAssemblyPolicy: a block is mined as soon as it would be full, or once
+the oldest transaction waited long enough. Batching transactions this way
+trades a bounded latency for fewer, fuller blocks.
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_MEMPOOL_H
+#define BITVOTING_MEMPOOL_H
+
+#include "settings.h"
+#include "transaction.h"
+#include "bitcoin/key.h"
+#include "bitcoin/uint256.h"
+#include "utils/comparison.h"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ----------------------------------------------------------------
+// Identifies the voter of a vote within an election
+typedef std::pair<uint256, CKeyID> VoteKey;
+
+struct Uint256Hasher
+{
+    size_t operator()(const uint256 &hash) const
+    {
+        // hashes are uniformly distributed already
+        return (size_t) hash.GetLow64();
+    }
+};
+
+struct VoteKeyHasher
+{
+    size_t operator()(const VoteKey &key) const
+    {
+        return (size_t) (key.first.GetLow64() ^ key.second.GetLow64());
+    }
+};
+
+// ----------------------------------------------------------------
+// Limits for assembling transactions into a block
+struct BlockAssemblyPolicy
+{
+    // maximum size of all transactions of a block (bytes)
+    uint64_t maxBytes;
+
+    // maximum number of transactions of a block
+    unsigned int maxTransactions;
+
+    // maximum time a transaction waits for the block to fill up (msec)
+    long maxWait;
+
+    BlockAssemblyPolicy(uint64_t maxBytes, unsigned int maxTransactions, long maxWait) :
+        maxBytes(maxBytes), maxTransactions(maxTransactions), maxWait(maxWait) {}
+
+    // Policy as configured (see Settings)
+    static BlockAssemblyPolicy fromSettings()
+    {
+        return BlockAssemblyPolicy(Settings::GetBlockMaxBytes(),
+                                   Settings::GetBlockMaxTransactions(),
+                                   Settings::GetBlockMaxWait());
+    }
+
+    // Check if the given pending transactions fill a block
+    bool isFull(unsigned int count, uint64_t bytes) const
+    {
+        return count >= maxTransactions || bytes >= maxBytes;
+    }
+
+    // Check if a block should be mined for the given pending transactions,
+    // i.e. if the block is full or the oldest transaction waited long enough
+    bool isDue(unsigned int count, uint64_t bytes, long long waited) const
+    {
+        if (count == 0)
+            return false;
+
+        return this->isFull(count, bytes) || waited >= maxWait;
+    }
+};
+
+// ----------------------------------------------------------------
+struct MempoolEntry
+{
+    Transaction *transaction = NULL;
+
+    // hash of the transaction (computed once)
+    uint256 hash = 0;
+
+    // size of the transaction (see Signable::getSize)
+    size_t bytes = 0;
+
+    // position in order of arrival
+    uint64_t sequence = 0;
+
+    // time of arrival (msec)
+    long long time = 0;
+
+    // set for votes (only valid if isVote)
+    bool isVote = false;
+    VoteKey voteKey;
+};
+
+// ----------------------------------------------------------------
+class Mempool
+{
+public:
+    Mempool(unsigned int maxTransactions = Settings::MEMPOOL_MAX_TRANSACTIONS,
+            uint64_t maxBytes = Settings::MEMPOOL_MAX_BYTES);
+    ~Mempool();
+
+    Mempool(Mempool const&)         = delete;
+    void operator=(Mempool const&)  = delete;
+
+    // Add a (verified) transaction, the pool takes ownership of it.
+    // Returns false if it is already known or had to be evicted right away
+    // because the pool is full, the caller keeps it in that case.
+    bool add(Transaction *transaction);
+
+    // Remove the transaction with the given hash (e.g. because it was mined)
+    // and hand it back to the caller. Returns NULL if it is not pooled.
+    Transaction* remove(const uint256 &hash);
+
+    // Check if a transaction with the given hash is pooled
+    bool contains(const uint256 &hash) const;
+
+    // Get the oldest transactions, that may be mined into one block together
+    // (at most one vote per voter and election), limited to maxCount
+    // transactions of at most maxBytes in total
+    void select(unsigned int maxCount, uint64_t maxBytes, std::vector<Transaction*> &out) const;
+
+    // Check if a block should be mined according to the given policy
+    bool isBlockDue(const BlockAssemblyPolicy &policy, long long now) const;
+
+    // Check if the transactions that may be mined fill a block
+    bool isBlockFull(const BlockAssemblyPolicy &policy) const
+    {
+        return policy.isFull(ready.size(), readyBytes);
+    }
+
+    // Arrival time of the oldest transaction that may be mined
+    // (returns false if there is none)
+    bool getOldestReadyTime(long long &timeOut) const;
+
+    // Number of pooled transactions
+    unsigned int size() const
+    {
+        return entries.size();
+    }
+
+    // Size of all pooled transactions
+    uint64_t bytes() const
+    {
+        return totalBytes;
+    }
+
+private:
+
+    // Remove the given entry from all indices, returns its transaction
+    Transaction* erase(const uint256 &hash);
+
+    // Mark the given entry as ready to be mined
+    void setReady(MempoolEntry *entry);
+
+    // Evict (and delete) transactions until the bounds hold again,
+    // except for the just added one, which is left to the caller
+    void evict(const uint256 &added);
+
+    // all entries by hash
+    std::unordered_map<uint256, MempoolEntry, Uint256Hasher> entries;
+
+    // entries that may be mined right away, by arrival
+    std::map<uint64_t, MempoolEntry*> ready;
+
+    // later votes waiting for an earlier vote of the same voter, by arrival
+    std::map<uint64_t, MempoolEntry*> waiting;
+
+    // pending votes of each voter, by arrival (the first one is ready)
+    std::unordered_map<VoteKey, std::deque<MempoolEntry*>, VoteKeyHasher> votes;
+
+    unsigned int maxTransactions;
+    uint64_t maxBytes;
+
+    uint64_t totalBytes = 0;
+    uint64_t readyBytes = 0;
+    uint64_t nextSequence = 0;
+};
+
+#endif // BITVOTING_MEMPOOL_H
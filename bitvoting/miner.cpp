@@ -5,7 +5,9 @@
 #include "database/blockchaindb.h"
 #include "store.h"
 #include "utils/comparison.h"
-#include "transactions/vote.h"
+#include "utils/difficulty.h"
+#include "utils/merkle.h"
+#include "utils/sha256.h"
 
 #include <algorithm>
 #include <chrono>
@@ -14,247 +16,228 @@
 
 #include <boost/foreach.hpp>
 
+// the nonce scanner has to know the header layout
+static_assert(BLOCK_HEADER_SIZE == NONCE_SCANNER_HEADER_SIZE, "unsupported block header size");
 
 // ---------------------  Miner  --------------------------------
 
-Miner::Miner(MiningManager *mm, std::set<Transaction*, pt_cmp> &transactions) :
-    miningManager(mm),
-    transactions(transactions)
+Miner::Miner(SolutionCallback onSolution, boost::thread_group *threadGroup, unsigned int numThreads) :
+    onSolution(onSolution),
+    stats(numThreads)
 {
-    numThreads = miningManager->numThreads;
-    hashTarget = miningManager->hashTarget;
+    generation = 0;
 
-    // number of hardware threads available on this system
-    if (numThreads == 0)
-        numThreads = boost::thread::hardware_concurrency();
-
-    if (numThreads == 0)
-        return;
-
-    // init nonces
-    startNonce = Helper::GenerateRandomUInt();
-    currentNonce = startNonce + 1;
+    unsigned int cores = boost::thread::hardware_concurrency();
 
-    // init flags
-    threadsDone = 0;
-    running = true;
-    newBlockFoundFlag = false;
-
-    // start mining process on numThreads threads
+    // start the mining threads once, they live as long as the miner
     for (unsigned int i = 0; i < numThreads; i++)
-        minerThreads.emplace(
-                    mm->threadGroup->create_thread(boost::bind(&Miner::mineTransactions, this)));
+    {
+        boost::thread *t = threadGroup->create_thread(boost::bind(&Miner::mineTransactions, this, i));
+        minerThreads.push_back(t);
+
+#ifdef __linux__
+        // pin each thread to its own core (if there are enough)
+        if (cores > 0)
+        {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(i % cores, &cpuset);
+            pthread_setaffinity_np(t->native_handle(), sizeof(cpu_set_t), &cpuset);
+        }
+#endif
+    }
 }
 
 Miner::~Miner()
 {
-    tearDown();
+    // threads are owned by the thread group, only stop them
+    BOOST_FOREACH(boost::thread *t, minerThreads)
+    {
+        t->interrupt();
+        if (t->joinable())
+            t->join();
+    }
 }
 
-void Miner::onNewBlockFromNetwork(Block *b)
+void Miner::setTemplate(boost::shared_ptr<BlockTemplate> blockTemplate)
 {
-    // ignore this event if the miner itself created it
-    if (newBlockFoundFlag)
-        return;
-
-    Log::i("(Miner) Received new block from network, block hash: %s", b->getHash().ToString().c_str());
-
-    // someone published a new block => there is a new lastBlock
-    // and therefore we have to use a new prevHash in mining process
-    // -> remove all transactions from current transactions set,
-    // which are contained in transactions set of the new block
-    // temp = transactions - b->transactions
-    std::set<Transaction*, pt_cmp> temp;
-    std::set_difference(transactions.begin(), transactions.end(),
-                        b->transactions.begin(), b->transactions.end(),
-                        std::inserter(temp, temp.end()),
-                        pt_cmp());
-
-    Log::i("Difference is %d", temp.size());
+    boost::mutex::scoped_lock lock(mutex);
+    currentTemplate = blockTemplate;
+    generation++;
 
-    // these are the transactions the miner can be restarted with
-    BOOST_FOREACH(Transaction *trans, temp)
-    {
-        miningManager->addTransaction(trans, false);
-    }
-    // restart
-    mutex.lock();
-    tearDown();
-    mutex.unlock();
-    miningManager->onMinerFinished();
+    // wake up waiting threads
+    templateChanged.notify_all();
 }
 
-void Miner::consumeNextNonces(unsigned int numNext,
-                                  unsigned int &lowerBound, unsigned int &upperBound)
+bool Miner::isRunning()
 {
     boost::mutex::scoped_lock lock(mutex);
-    lowerBound = currentNonce;
-    // if currentNonce reached startNonce again
-    // -> set lowerBound == upperBound to inform about end of nonces
-    if (startNonce >= currentNonce && startNonce < currentNonce + numNext)
-    {
-        currentNonce = startNonce;
-    } else {
-        currentNonce += numNext;
-    }
-    upperBound = currentNonce;
+    return currentTemplate != NULL;
 }
 
-void Miner::mineTransactions()
+void Miner::consumeNextNonces(BlockTemplate &blockTemplate, uint64_t numNext,
+                              uint64_t &lowerBound, uint64_t &upperBound)
 {
-    Block *newBlock = new Block();
+    // every thread gets a disjoint interval, so no lock is needed
+    lowerBound = blockTemplate.nextWork.fetch_add(numNext, std::memory_order_relaxed);
+    upperBound = lowerBound + numNext;
+}
 
-    // set time fixed
-    newBlock->header.time = Helper::GetUNIXTimestamp();
+void Miner::mineTransactions(unsigned int thread)
+{
+    uint64_t chunkSize = Settings::MINING_NONCES_AT_ONCE;
 
     try
     {
-        boost::this_thread::interruption_point();
+        while (true)
+        {
+            // --- wait for a template ---
+            boost::shared_ptr<BlockTemplate> blockTemplate;
+            unsigned int templateGeneration;
+            {
+                boost::mutex::scoped_lock lock(mutex);
+                while (currentTemplate == NULL)
+                    templateChanged.wait(lock);
 
+                blockTemplate = currentTemplate;
+                templateGeneration = generation;
+            }
 
-        // --- precompute last block-hash ---
-        Block *lastBlock;
-        uint256 prevBlockHash;
-        BlockChainStatus bcs = BlockChainDB::getLatestBlock(&lastBlock);
-        switch( bcs )
-        {
-        case BC_OK:
-            prevBlockHash = lastBlock->getHash();
-            break;
-        case BC_IS_EMPTY:
-            prevBlockHash = BlockChainDB::getGenesisBlock();
-            break;
-        default:
-            abort();
-            return;
+            mineTemplate(*blockTemplate, templateGeneration, thread, chunkSize);
         }
+    }
+    catch (boost::thread_interrupted)
+    {
+        // shut down
+        return;
+    }
+}
 
+void Miner::mineTemplate(BlockTemplate &blockTemplate, unsigned int templateGeneration,
+                         unsigned int thread, uint64_t &chunkSize)
+{
+    // local copies, the time is rolled per epoch
+    BlockHeader header = blockTemplate.header;
+    HeaderMidstate midstate = blockTemplate.midstate;
+    unsigned char headerData[BLOCK_HEADER_SIZE];
 
-        // --- create new block ---
-        newBlock->header.hashPrevBlock = prevBlockHash;
-        // copy transactions to newBlock.transactions
-        std::copy(transactions.begin(), transactions.end(),
-                  std::inserter( newBlock->transactions, newBlock->transactions.begin() ) );
-        newBlock->setPublicKey(miningManager->skp.second);
+    uint256 hashes[NONCE_SCANNER_MAX_LANES];
 
+    // the midstate of the template belongs to epoch 0
+    uint64_t epoch = 0;
+    while (true)
+    {
+        // claim some work indices to process
+        uint64_t lowerBound, upperBound;
+        consumeNextNonces(blockTemplate, chunkSize, lowerBound, upperBound);
+        std::chrono::steady_clock::time_point chunkStart = std::chrono::steady_clock::now();
 
-        // --- search for proof of work ---
-        Log::i("(Miner) Searching for proof of work...");
-        unsigned int nonce;
-        uint256 hashBuf;
-        while (true)
+        uint64_t work = lowerBound;
+        while (work < upperBound)
         {
-            // consume some nonces to process from the pool
-            unsigned int lowerBound, upperBound;
-            consumeNextNonces(Settings::MINING_NONCES_AT_ONCE, lowerBound, upperBound);
-            // if lower == upper == startNonce it means that
-            // no 'free' nonces are left, so abort!
-            if (lowerBound == upperBound)
+            // all 32 bit nonces of the last epoch are used up -> roll the time
+            if ((work >> 32) != epoch)
             {
-                abort();
-                return;
+                epoch = work >> 32;
+                header.time = blockTemplate.header.time + epoch;
+
+                // blocks from the future are rejected
+                while (header.time > Helper::GetUNIXTimestamp())
+                    Helper::Sleep(1);
+
+                header.toBinary(headerData);
+                NonceScanner::prepare(headerData, midstate);
             }
 
-            // process every nonce that was consumed
-            for (nonce = lowerBound; nonce < upperBound; ++nonce)
+            // process the claimed nonces of this epoch, several at once
+            uint64_t end = std::min(upperBound, (epoch + 1) << 32);
+            unsigned int first = blockTemplate.startNonce + (unsigned int) work;
+            unsigned int count = (unsigned int) (end - work);
+            for (unsigned int i = 0, lanes; i < count; i += lanes)
             {
-                // nonce is the only values which changes
-                newBlock->header.nonce = nonce;
+                // compute hashes (of the header only)
+                lanes = NonceScanner::scan(midstate, first + i, hashes);
 
-                // compute hash
-                hashBuf = newBlock->getHash();
                 // and check against the hashTarget (difficulty)
-                if (hashBuf <= hashTarget)
+                for (unsigned int l = 0; l < lanes && i + l < count; l++)
                 {
+                    if (!(hashes[l] <= blockTemplate.hashTarget))
+                        continue;
+
+                    // nonce is the only values which changes
+                    header.nonce = first + i + l;
+                    stats.addHashes(thread, i + lanes);
+
                     boost::this_thread::interruption_point();
                     // if found, inform mining manager and publish
-                    if (onNewBlockFound(newBlock, miningManager->skp))
-                        return;
+                    onNewBlockFound(blockTemplate, header);
+                    return;
                 }
                 boost::this_thread::interruption_point();
+
+                // switch over as soon as the template was replaced
+                if (generation.load(std::memory_order_relaxed) != templateGeneration)
+                {
+                    stats.addHashes(thread, i + lanes);
+                    return;
+                }
             }
+
+            stats.addHashes(thread, count);
+            work = end;
         }
-    }
-    catch (boost::thread_interrupted)
-    {
-        // clear work and shut down
-        delete newBlock;
-        return;
+
+        // adapt the chunk size, so that claiming stays rare
+        long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - chunkStart).count();
+        if (elapsed < Settings::MINING_CHUNK_MILLISECONDS / 2
+                && chunkSize < (uint64_t) Settings::MINING_NONCES_MAX_AT_ONCE)
+            chunkSize *= 2;
+        else if (elapsed > Settings::MINING_CHUNK_MILLISECONDS * 2 && chunkSize > NonceScanner::lanes())
+            chunkSize /= 2;
     }
 }
 
-bool Miner::onNewBlockFound(Block *newBlock, SignKeyPair &skp)
+uint256 Miner::hashTransactions(std::set<Transaction *, pt_cmp> &transactions)
 {
-    Log::i("(Miner) Sucessfully mined a new block, block hash: %s", newBlock->getHash().ToString().c_str());
-    mutex.lock();
-    if (newBlockFoundFlag)
+    // leaves are the transaction hashes (in order of the set)
+    std::vector<uint256> leaves;
+    leaves.reserve(transactions.size());
+    BOOST_FOREACH(Transaction *t, transactions)
     {
-        // don't let the mutex stay in locked status when returning
-        mutex.unlock();
-        return false;
+        leaves.push_back(t->getHash());
     }
 
-    // prevent extern interruption
-    newBlockFoundFlag = true;
-
-    // save to database
-    /*
-       save to database is done via 'publishBlock'
-       and its loopback into handling of receiving blocks
-    */
-
-    // send to network
-    miningManager->publishBlock(newBlock, skp);
-
-    tearDown();
-    mutex.unlock();
-
-    Log::i("(Miner) miner found a new block and finishes...");
-    miningManager->onMinerFinished();
-
-    return true;
+    return MerkleTree::computeRoot(leaves);
 }
 
-void Miner::abort()
+bool Miner::onNewBlockFound(BlockTemplate &blockTemplate, const BlockHeader &header)
 {
-    mutex.lock();
-    threadsDone++;
-    Log::i("(Miner) thread aborted. Total number of threads aborted: %d", threadsDone);
-    if (threadsDone >= minerThreads.size())
     {
-        Log::i("(Miner) All threads aborted -> terminate mining process to be ready for next session");
-        // transactions weren't mined, so add them to queue again
-        BOOST_FOREACH(Transaction *t, transactions)
-        {
-            miningManager->addTransaction(t, false);
-        }
-        tearDown();
-        mutex.unlock();
-        miningManager->onMinerFinished();
-        return;
-    }
-    mutex.unlock();
-}
+        boost::mutex::scoped_lock lock(mutex);
 
-void Miner::tearDown()
-{
-    // interrupt parallel threads
-    BOOST_FOREACH(boost::thread *t, minerThreads)
-    {
-        t->interrupt();
-        delete t;
+        // another thread was faster or the template is outdated
+        if (blockTemplate.solved || currentTemplate.get() != &blockTemplate)
+            return false;
+        blockTemplate.solved = true;
+
+        // pause until the manager provides the next template
+        currentTemplate.reset();
+        generation++;
     }
-    minerThreads.clear();
 
-    running = false;
-}
+    stats.addBlock(Helper::GetUNIXTimestamp() - blockTemplate.miningStart);
 
+    onSolution(blockTemplate, header);
+    return true;
+}
 
 // ---------------------  MiningManager  --------------------------------
 
 MiningManager::MiningManager(boost::thread_group* threadGroup, BlocksProtocol& blocks) :
     threadGroup(threadGroup),
-    blockProtocol(blocks)
+    blockProtocol(blocks),
+    policy(BlockAssemblyPolicy::fromSettings())
 {
     // get available mining keys
     std::vector<SignKeyPair> skpsMining;
@@ -271,19 +254,73 @@ MiningManager::MiningManager(boost::thread_group* threadGroup, BlocksProtocol& b
     if (this->numThreads <= 0 || this->numThreads > 4)
         this->numThreads = boost::thread::hardware_concurrency();
 
-    // set hashTarget
-    hashTarget = 0;
-    hashTarget = (hashTarget - 1) >> Settings::MINING_LEADING_ZEROS;
-
-    Log::i("(Miner) Current hash target for mining: %s", hashTarget.GetHex().c_str());
     Log::i("(Miner) Number of threads for mining: %i", numThreads);
+    Log::i("(Miner) Block assembly: max. %i transactions, max. %lu bytes, max. wait %lu msec",
+           policy.maxTransactions, policy.maxBytes, policy.maxWait);
+
+    // start the mining threads (waiting for the first template)
+    if (this->numThreads > 0)
+    {
+        m = new Miner(boost::bind(&MiningManager::onBlockMined, this, _1, _2),
+                      threadGroup, this->numThreads);
+        managerThreads.push_back(threadGroup->create_thread(boost::bind(&MiningManager::assembleBlocks, this)));
+        managerThreads.push_back(threadGroup->create_thread(boost::bind(&MiningManager::logStatistics, this)));
+    }
 }
 MiningManager::~MiningManager()
 {
+    // the helper threads use the miner, stop them first
+    BOOST_FOREACH(boost::thread *t, managerThreads)
+    {
+        t->interrupt();
+        if (t->joinable())
+            t->join();
+    }
+
+    // mining threads finishing a block see that the miner is gone
+    // (see onMinerFinished), so it is deleted without holding the mutex
+    Miner *miner;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        miner = m;
+        m = NULL;
+        blockTemplate.reset();
+    }
+
+    if (miner != NULL)
+        delete miner;
+}
+
+void MiningManager::onBlockMined(BlockTemplate &blockTemplate, const BlockHeader &header)
+{
+    Block *newBlock = new Block();
+    newBlock->header = header;
+    newBlock->transactions = blockTemplate.transactions;
+    newBlock->setPublicKey(this->skp.second);
+
+    Log::i("(Miner) Sucessfully mined a new block, block hash: %s", newBlock->getHash().ToString().c_str());
+
+    // save to database
+    /*
+       save to database is done via 'publishBlock'
+       and its loopback into handling of receiving blocks
+    */
+
+    // send to network
+    this->publishBlock(newBlock, this->skp);
+
+    this->onMinerFinished();
 }
 
-MINING_ERROR MiningManager::addTransaction(Transaction *t, bool run)
+MINING_ERROR MiningManager::addTransaction(Transaction *t)
 {
+    // transactions in the mempool were verified already
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        if (mempool.contains(t->getHash()))
+            return MINING_OK;
+    }
+
     VerifyResult error = t->verify();
     if (error)
     {
@@ -294,123 +331,259 @@ MINING_ERROR MiningManager::addTransaction(Transaction *t, bool run)
 
     Log::i("(Miner) Accept received transaction (Type: %i | Hash: %s)", t->getType(), t->getHash().ToString().c_str());
 
-    // if called from failed attempts to mine, insert at front
-    if (!run)
-        transQueue.insert(transQueue.begin(), t);
-    else
-        transQueue.push_back(t);
+    boost::mutex::scoped_lock lock(mutex);
+    if (!mempool.add(t))
+        return MINING_OK;
 
-    // try to run
-    if (run)
-        return runIfPossible();
+    assemblyChanged.notify_all();
 
-    return MINING_OK;
+    // while idle, a block is started as soon as the policy says so
+    if (m == NULL || !m->isRunning())
+        return updateTemplate();
+
+    // while mining, the scanners are only restarted if the block changes
+    // materially, otherwise the transaction waits (see assembleBlocks)
+    long long now = Helper::GetUNIXTimestamp();
+    if (pendingSince == 0)
+        pendingSince = now;
+
+    if (!this->isTemplateOutdated(now))
+        return MINING_IN_PROGRESS;
+
+    return updateTemplate();
 }
 
-void MiningManager::onMinerFinished()
+bool MiningManager::isTemplateOutdated(long long now)
 {
-    // try to run in case there were new transaction in the queue, ready to be mined
-    runIfPossible();
+    // nothing new or no room for it
+    if (blockTemplate == NULL || blockTemplate->full || pendingSince == 0)
+        return false;
+
+    return mempool.isBlockFull(policy) || now - pendingSince >= policy.maxWait;
 }
 
-MINING_ERROR MiningManager::runIfPossible()
+void MiningManager::onMinerFinished()
 {
     boost::mutex::scoped_lock lock(mutex);
 
-    if (numThreads == 0)
-        return MINING_FAIL;
-
-    // check if mining process is currently running
-    if (m != NULL && m->isRunning())
-        return MINING_IN_PROGRESS;
-
-    // check if there are enough transactions to be mined simultaneously
-    // i.e. if there are enough after filtering out the transactions
-    // which can't be mined into 1 block
-    std::set<Transaction*, pt_cmp> toBeProcessed;
-    if(!getTransactionsForBlock(toBeProcessed))
-        return MINING_NOT_ENOUGH_TX;
+    // the new block may have been accepted already (see onNewBlockFromNetwork)
+    if (m == NULL || m->isRunning())
+        return;
 
-    Log::i("(Miner) Starting new mining process with %i transactions", toBeProcessed.size());
+    // otherwise continue on the current mempool
+    updateTemplate();
+    assemblyChanged.notify_all();
+}
 
-    // clear the old mining process
-    if (m != NULL)
+void MiningManager::assembleBlocks()
+{
+    try
     {
-        delete m;
-        m = NULL;
-    }
+        boost::mutex::scoped_lock lock(mutex);
+        while (true)
+        {
+            // while mining, add new transactions once they waited long enough
+            if (m->isRunning())
+            {
+                if (blockTemplate == NULL || blockTemplate->full || pendingSince == 0)
+                {
+                    assemblyChanged.wait(lock);
+                    continue;
+                }
 
-    // create a new mining process (which starts automatically)
-    m = new Miner(this, toBeProcessed);
+                long long remaining = pendingSince + policy.maxWait - Helper::GetUNIXTimestamp();
+                if (remaining > 0)
+                {
+                    assemblyChanged.timed_wait(lock, boost::posix_time::milliseconds(remaining));
+                    continue;
+                }
 
-    return MINING_OK;
-}
+                updateTemplate();
+                continue;
+            }
 
-bool MiningManager::getTransactionsForBlock(std::set<Transaction*,pt_cmp> &outTransactions)
-{
-    // If duplicate vote appears:
-    // Take the FIRST vote of all votes, which were signed with the same key
-    // and add it to the transactions for the new block.
-    // All others wait in queue in the same order they were, so that the last
-    // incoming vote will be the last to be put into a block.
+            // nothing to wait for without transactions
+            long long oldest;
+            if (!mempool.getOldestReadyTime(oldest))
+            {
+                assemblyChanged.wait(lock);
+                continue;
+            }
 
-    // for each transaction...
-    BOOST_FOREACH(Transaction *t1, transQueue)
-    {
-        // ...check for each already seen transaction...
-        bool foundDuplicate = false;
-        BOOST_FOREACH(Transaction *t2, outTransactions)
-        {
-            // ...if we already saw this vote on this (other) transaction...
-            if (checkForDuplicateVoteTransaction(t1, t2))
+            // wait until the oldest transaction waited long enough
+            long long remaining = oldest + policy.maxWait - Helper::GetUNIXTimestamp();
+            if (remaining > 0)
             {
-                // ...if "yes": skip
-                foundDuplicate = true;
-                break;
+                assemblyChanged.timed_wait(lock, boost::posix_time::milliseconds(remaining));
+                continue;
             }
-        }
 
-        // ...if "no" for each: add to already seen transactions
-        if (!foundDuplicate)
-            outTransactions.emplace(t1);
+            // mine what is there (if possible at all)
+            MINING_ERROR result = updateTemplate();
+            if (result != MINING_OK && result != MINING_IN_PROGRESS)
+                assemblyChanged.wait(lock);
+        }
+    }
+    catch (boost::thread_interrupted)
+    {
+        // shut down
+        return;
     }
+}
 
-    // check if enough transactions could be retrieved from queue
-    if(outTransactions.size() < Settings::MINING_MIN_TRANSACTIONS)
-        return false;
+void MiningManager::logStatistics()
+{
+    try
+    {
+        while (true)
+        {
+            Helper::Sleep(Settings::MINING_STATS_INTERVAL);
+
+            m->getStats().update();
+            MiningStatsSnapshot stats = m->getStats().getSnapshot();
 
-    // remove the outTransactions from transQueue
-    // (transQueue := transQueue - outTransactions)
-    BOOST_FOREACH(Transaction *t, outTransactions)
+            Log::i("(Miner) Hash rate: %.2f kH/s (%i threads), %lu hashes in total",
+                   stats.hashrate / 1000, stats.threadHashrates.size(), stats.totalHashes);
+            if (stats.blocks > 0)
+                Log::i("(Miner) Found %i blocks, time to block: %.1f sec (min. %.1f sec, max. %.1f sec)",
+                       stats.blocks, stats.averageTimeToBlock / 1000,
+                       stats.minTimeToBlock / 1000.0, stats.maxTimeToBlock / 1000.0);
+        }
+    }
+    catch (boost::thread_interrupted)
     {
-        transQueue.erase(std::remove(transQueue.begin(), transQueue.end(), t), transQueue.end());
+        // shut down
+        return;
     }
+}
 
-    return true;
+MiningStatsSnapshot MiningManager::getStatistics()
+{
+    // the miner is deleted under the mutex (see ~MiningManager)
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if (m == NULL)
+        return MiningStatsSnapshot();
+
+    return m->getStats().getSnapshot();
 }
 
-bool MiningManager::checkForDuplicateVoteTransaction(Transaction *t1, Transaction *t2)
+MINING_ERROR MiningManager::updateTemplate()
 {
-    if(t1->getType() != TxType::TX_VOTE)
-        return false;
+    if (m == NULL)
+        return MINING_FAIL;
 
-    if(t1->getType() != t2->getType())
-        return false;
+    // while idle, wait for the block to fill up
+    bool running = m->isRunning();
+    if (!running && !mempool.isBlockDue(policy, Helper::GetUNIXTimestamp()))
+        return MINING_NOT_ENOUGH_TX;
 
-    TxVote *txVote1 = dynamic_cast<TxVote*>(t1);
-    TxVote *txVote2 = dynamic_cast<TxVote*>(t2);
+    // check if there are enough transactions to be mined simultaneously
+    // i.e. if there are enough after filtering out the transactions
+    // which can't be mined into 1 block
+    // the transactions accepted so far are considered from here on
+    pendingSince = 0;
 
-    if(txVote1->election != txVote2->election)
-        return false;
+    boost::shared_ptr<BlockTemplate> newTemplate(new BlockTemplate());
+    if(!getTransactionsForBlock(newTemplate->transactions))
+    {
+        m->setTemplate(boost::shared_ptr<BlockTemplate>());
+        blockTemplate.reset();
+        return MINING_NOT_ENOUGH_TX;
+    }
+
+    // --- create new header ---
+    BlockHeader &header = newTemplate->header;
+    header.hashPrevBlock = BlockChainDB::getLatestBlockHash();
+    header.miner = this->skp.second.GetID();
+    header.time = Helper::GetUNIXTimestamp();
+
+    // keep mining if nothing changed (e.g. the block is full already)
+    if (running && blockTemplate != NULL
+            && blockTemplate->header.hashPrevBlock == header.hashPrevBlock
+            && blockTemplate->transactions == newTemplate->transactions)
+        return MINING_IN_PROGRESS;
+
+    // the difficulty depends on the previous blocks
+    if (BlockChainDB::getNextWorkRequired(header.hashPrevBlock, header.bits) != BC_OK)
+    {
+        Log::e("(Miner) Could not compute the hash target for the next block");
+        m->setTemplate(boost::shared_ptr<BlockTemplate>());
+        blockTemplate.reset();
+        return MINING_FAIL;
+    }
+
+    // commit to the transactions once, so that the proof of work
+    // only has to hash the fixed-size header
+    header.hashMerkleRoot = Miner::hashTransactions(newTemplate->transactions);
+
+    // everything but the nonce is fixed from now on,
+    // so the first part of the header hash is computed only once
+    unsigned char headerData[BLOCK_HEADER_SIZE];
+    header.toBinary(headerData);
+    NonceScanner::prepare(headerData, newTemplate->midstate);
+
+    newTemplate->hashTarget = Difficulty::fromCompact(header.bits);
+    newTemplate->startNonce = Helper::GenerateRandomUInt();
+    newTemplate->nextWork = 0;
+    newTemplate->full = mempool.isBlockFull(policy);
+
+    // the time to find a block counts from the first template on top
+    // of the previous block
+    if (running && blockTemplate != NULL
+            && blockTemplate->header.hashPrevBlock == header.hashPrevBlock)
+        newTemplate->miningStart = blockTemplate->miningStart;
+    else
+        newTemplate->miningStart = header.time;
+
+    Log::i("(Miner) Mining on new template with %i transactions (hash target: %s)",
+           newTemplate->transactions.size(), newTemplate->hashTarget.GetHex().c_str());
+
+    // the mining threads switch over immediately
+    blockTemplate = newTemplate;
+    m->setTemplate(newTemplate);
+
+    return MINING_OK;
+}
 
-    if(txVote1->getPublicKey() != txVote2->getPublicKey())
+bool MiningManager::getTransactionsForBlock(std::set<Transaction*,pt_cmp> &outTransactions)
+{
+    // If duplicate vote appears:
+    // Take the FIRST vote of all votes, which were signed with the same key
+    // and add it to the transactions for the new block.
+    // All others wait in the mempool in the same order they were, so that
+    // the last incoming vote will be the last to be put into a block.
+    std::vector<Transaction*> selected;
+    mempool.select(policy.maxTransactions, policy.maxBytes, selected);
+
+    // check if enough transactions could be retrieved from the mempool
+    // (they stay there until they are part of the block chain)
+    if(selected.size() < Settings::MINING_MIN_TRANSACTIONS)
         return false;
 
+    outTransactions.insert(selected.begin(), selected.end());
     return true;
 }
 
 void MiningManager::onNewBlockFromNetwork(Block *b)
 {
+    Log::i("(Miner) New block in chain, block hash: %s", b->getHash().ToString().c_str());
+
+    boost::mutex::scoped_lock lock(mutex);
+
+    // remove the transactions of the block from the mempool, the pooled
+    // copies of transactions received within a foreign block are not needed
+    BOOST_FOREACH(Transaction *t, b->transactions)
+    {
+        Transaction *pooled = mempool.remove(t->getHash());
+        if (pooled != t)
+            delete pooled;
+    }
+
+    // the current template is outdated, continue with the remaining
+    // (already verified) transactions on top of the new block
+    // as soon as the policy allows
     if (m != NULL)
-        m->onNewBlockFromNetwork(b);
+        m->setTemplate(boost::shared_ptr<BlockTemplate>());
+    updateTemplate();
+    assemblyChanged.notify_all();
 }
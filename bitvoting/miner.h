@@ -16,12 +16,18 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #define BITVOTING_MINER_H
 
 #include "block.h"
+#include "mempool.h"
+#include "miningstats.h"
 #include "transaction.h"
 #include "bitcoin/uint256.h"
 #include "net/protocols/blocks.h"
+#include "utils/sha256.h"
 
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/signals2.hpp>
+#include <atomic>
 #include <set>
 #include <utility>
 #include <set>
@@ -29,12 +35,13 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 
 /*
 Note:
-    1) All incoming transactions are stored in set transQueue
-    2) If set reaches a certain size (not only check with function!)
-        2.1) Another mining process is already started, wait
-        2.2) If no mining process is already started, start mining
-    3) Run proof of work for subset of transQueue
-    4) Create new block based on proof of work
+    1) All incoming transactions are verified once and stored in the mempool
+    2) The transactions of the mempool that fit into one block form a
+       block template, which the (persistent) mining threads work on
+    3) New transactions or a new block in the chain replace the template,
+       the mining threads switch over without being restarted
+    4) Transactions leave the mempool as soon as a block containing them
+       is accepted (mined by us or someone else)
 */
 
 // Status code for mining results
@@ -51,82 +58,116 @@ enum MINING_ERROR
     MINING_FAIL
 };
 
-class MiningManager;
+// ----------------------------------------------------------------
+// Everything the mining threads need to search for a proof of work.
+// A template is not changed after being handed to the miner (except for
+// the shared work counter), it is replaced as a whole.
+struct BlockTemplate
+{
+    // header of the new block (without nonce)
+    BlockHeader header;
+
+    // transactions of the new block
+    std::set<Transaction*, pt_cmp> transactions;
+
+    // precomputed first part of the header hash (see NonceScanner)
+    HeaderMidstate midstate;
+
+    // a proof of work is found, if hash <= hashTarget
+    uint256 hashTarget;
+
+    // nonce of work index 0 (see mining strategy)
+    unsigned int startNonce;
+
+    // time mining on top of the previous block started (msec),
+    // to measure the time it takes to find a block
+    long long miningStart = 0;
+
+    // next unclaimed work index (see mining strategy)
+    std::atomic<uint64_t> nextWork;
+
+    // set by the thread which found a proof of work
+    bool solved = false;
+
+    // the transactions that may be mined did not fit into this block
+    bool full = false;
+};
 
 /*
  * Mining strategy:
- * Starting at a random starting nonce, we count up until we reach the
- * starting nonce again, using maximum(unsigned int) == -1.
- * Every thread consumes several nonces at once for processing to
- * minimize mutex-protected accesses.
+ * All threads share a 64 bit work counter, from which every thread claims
+ * a chunk of work indices at once (atomic fetch-add, no lock). The size of
+ * the chunks is adapted per thread depending on its speed.
+ * Work index w stands for the nonce (startNonce + w) mod 2^32 in epoch
+ * w / 2^32. Once all 2^32 nonces of an epoch are used up, the block time
+ * is rolled forward (header time + epoch), so the search never runs out
+ * of nonces and never has to restart.
+ *
+ * The mining threads are started once and pinned to a core each. They pick
+ * up a new template as soon as it is set and wait while there is none.
+ * Every thread counts the hashes it computed (see MiningStats).
  */
 class Miner
 {
 public:
-    Miner(MiningManager *mm, std::set<Transaction*, pt_cmp> &transactions);
+    // called (by a mining thread) with the template and the header,
+    // if a proof of work was found. The miner is paused then.
+    typedef boost::function<void (BlockTemplate&, const BlockHeader&)> SolutionCallback;
+
+    Miner(SolutionCallback onSolution, boost::thread_group *threadGroup, unsigned int numThreads);
     ~Miner();
 
-    // handles new blocks from the network (others), i.e. searchs
-    // for transactions the miner is currently mining but were already
-    // included in a block.
-    // Stops the mining process due to the need of prevHash (which changed)
-    void onNewBlockFromNetwork(Block *b);
+    // replaces the template all threads are working on.
+    // NULL pauses the mining threads.
+    void setTemplate(boost::shared_ptr<BlockTemplate> blockTemplate);
 
-    // returns if the mining process is currently running
-    bool isRunning()
+    // returns if the miner currently works on a template
+    bool isRunning();
+
+    // hash counters and rates of the mining threads
+    MiningStats& getStats()
     {
-        return running;
+        return stats;
     }
 
-    // concatenates the transactions and builds the hash
+    // builds the merkle root over the hashes of the transactions
     static uint256 hashTransactions(std::set<Transaction *, pt_cmp> &transactions);
 
 private:
 
-    // reserves next 'numNext' nonces and therefore increments
-    // the 'processedNonces' by 'numNonces'.
-    // Sets lowerBound to the lowest unprocessed nonce and
-    // upperBound to the maximum of the reserved interval.
-    void consumeNextNonces(unsigned int numNext,
-                           unsigned int &lowerBound, unsigned int &upperBound);
-
-    // handles successful mining, i.e. finding a proof of work for given transactions
-    bool onNewBlockFound(Block *newBlock, SignKeyPair &skp);
+    // reserves the next 'numNext' work indices of the template (lock-free).
+    // Sets lowerBound to the first reserved index and
+    // upperBound to the first index after the reserved interval.
+    void consumeNextNonces(BlockTemplate &blockTemplate, uint64_t numNext,
+                           uint64_t &lowerBound, uint64_t &upperBound);
 
-    // Run mining of given transaction
-    void mineTransactions();
+    // handles successful mining, i.e. finding a proof of work for given template
+    bool onNewBlockFound(BlockTemplate &blockTemplate, const BlockHeader &header);
 
-    // Called if a thread wants to abort because of failures
-    void abort();
+    // Main loop of a mining thread (with the given index)
+    void mineTransactions(unsigned int thread);
 
-    // Interrupts mining threads
-    void tearDown();
-
-    // new transactions, which can be used for new proof of work
-    std::set<Transaction*, pt_cmp> transactions;
+    // Search a proof of work on the given template
+    // until it is solved or replaced
+    void mineTemplate(BlockTemplate &blockTemplate, unsigned int generation,
+                      unsigned int thread, uint64_t &chunkSize);
 
+    // protects currentTemplate
     boost::mutex mutex;
-    bool newBlockFoundFlag;
-
-    // nonces from 'startNonce' to 'currentNonce' were already processed
-    unsigned int currentNonce;
-    unsigned int startNonce;
-
-    bool running = false;
+    boost::condition_variable templateChanged;
 
-    // the number of threads that finished (e.g. by aborting)
-    unsigned int threadsDone;
+    // template the threads are currently working on (may be NULL)
+    boost::shared_ptr<BlockTemplate> currentTemplate;
 
-    std::set<boost::thread*> minerThreads;
+    // incremented on every change of currentTemplate, so that the threads
+    // can check for a new template without locking
+    std::atomic<unsigned int> generation;
 
-    MiningManager *miningManager = NULL;
+    std::vector<boost::thread*> minerThreads;
 
-    // the target/difficulty for mining process
-    // a proof of work is found, if hash < hashTarget
-    uint256 hashTarget;
+    SolutionCallback onSolution;
 
-    // the number of threads to be used in the mining process
-    unsigned int numThreads;
+    MiningStats stats;
 };
 
 
@@ -134,8 +175,6 @@ private:
 // different mining-strategies and mining multiple blocks at once
 class MiningManager
 {
-friend class Miner;
-
 public:
     MiningManager(boost::thread_group*, BlocksProtocol&);
     ~MiningManager();
@@ -146,22 +185,20 @@ public:
         this->blockProtocol.Publish(b, skp);
     }
 
-    uint256 getHashTarget()
-    {
-        return hashTarget;
-    }
+    // verifies the transaction and adds it to the queue. While mining,
+    // the template is only updated if the block changed materially
+    // (see isTemplateOutdated)
+    MINING_ERROR addTransaction(Transaction *t);
 
-    // verifies the transaction and adds it to the queue if verify=true
-    // also tries to run the mining process on the current queue
-    // (see runIfPossible)
-    // if parameter run is set to false, there will be no attempt to
-    // run the mining process after inserting the transaction to the front of queue
-    MINING_ERROR addTransaction(Transaction *t, bool run = true);
-
-    // handles new blocks from the network (others), i.e. informs
-    // the currently running mining process
+    // handles new blocks in the chain (mined by others or ourselves),
+    // i.e. removes its transactions from the queue and lets the miner
+    // continue on top of it
     void onNewBlockFromNetwork(Block *b);
 
+    // current hash rate and time to find a block (a copy, may be called
+    // from any thread)
+    MiningStatsSnapshot getStatistics();
+
 private:
     BlocksProtocol& blockProtocol;
 
@@ -171,31 +208,60 @@ private:
     // the sign-key-pair to be used to sign the new block
     SignKeyPair skp;
 
-    // the target/difficulty for mining process
-    // a proof of work is found, if hash < hashTarget
-    uint256 hashTarget;
+    // (verified) transactions to be mined
+    Mempool mempool;
 
-    // queue of transactions to be mined
-    std::vector<Transaction*> transQueue;
+    // when and how large blocks are assembled
+    BlockAssemblyPolicy policy;
 
+    // protects mempool, blockTemplate and the miner
     boost::mutex mutex;
     boost::thread_group *threadGroup = NULL;
     Miner *m = NULL;
 
-    // callback signaling that the current mining process finished
-    // e.g. by aborting or finding a new block
+    // threads of assembleBlocks and logStatistics (owned by threadGroup)
+    std::vector<boost::thread*> managerThreads;
+
+    // last template handed to the miner
+    boost::shared_ptr<BlockTemplate> blockTemplate;
+
+    // arrival of the first transaction accepted after blockTemplate
+    // was built (msec, 0 if there is none)
+    long long pendingSince = 0;
+
+    // signals changes of the mempool or the miner to assembleBlocks
+    boost::condition_variable assemblyChanged;
+
+    // callback of the miner: publishes the found block
+    void onBlockMined(BlockTemplate &blockTemplate, const BlockHeader &header);
+
+    // continues mining after the miner found a block and paused
     void onMinerFinished();
 
-    // runs mining process if threads are free
-    // and there are enough transactions
-    MINING_ERROR runIfPossible();
+    // measures and logs the hash rate periodically,
+    // runs in its own thread
+    void logStatistics();
+
+    // starts mining a block once the oldest transaction waited
+    // long enough (see BlockAssemblyPolicy) and adds transactions
+    // to the template being mined once they waited long enough,
+    // runs in its own thread
+    void assembleBlocks();
+
+    // checks if the template being mined should be rebuilt for the
+    // transactions accepted after it, i.e. if they fill the block or
+    // the first of them waited long enough (mutex must be held)
+    bool isTemplateOutdated(long long now);
 
-    // gets and removes all transactions from transQueue,
+    // builds a new template from the latest block and the mempool
+    // and hands it to the miner (mutex must be held).
+    // While the miner is idle, a new block is only started if the
+    // policy says so.
+    MINING_ERROR updateTemplate();
+
+    // gets all transactions from the mempool,
     // which should be included in the next block
     bool getTransactionsForBlock(std::set<Transaction *, pt_cmp> &outTransactions);
-
-    // check if two transactions are duplicate votes
-    bool checkForDuplicateVoteTransaction(Transaction *t1, Transaction *t2);
 };
 
 #endif
@@ -0,0 +1,77 @@
+#include "miningstats.h"
+
+#include "helper.h"
+
+// ================================================================
+
+MiningStats::MiningStats(unsigned int numThreads) :
+    counters(numThreads),
+    lastHashes(numThreads, 0),
+    threadHashrates(numThreads, 0)
+{
+    lastUpdate = Helper::GetUNIXTimestamp();
+}
+
+// ----------------------------------------------------------------
+
+void
+MiningStats::addBlock(long long timeToBlock)
+{
+    boost::mutex::scoped_lock lock(mutex);
+
+    if (blocks == 0 || timeToBlock < minTimeToBlock)
+        minTimeToBlock = timeToBlock;
+    if (blocks == 0 || timeToBlock > maxTimeToBlock)
+        maxTimeToBlock = timeToBlock;
+
+    blocks++;
+    lastTimeToBlock = timeToBlock;
+    sumTimeToBlock += timeToBlock;
+}
+
+// ----------------------------------------------------------------
+
+void
+MiningStats::update()
+{
+    boost::mutex::scoped_lock lock(mutex);
+
+    long long now = Helper::GetUNIXTimestamp();
+    long long elapsed = now - lastUpdate;
+    if (elapsed <= 0)
+        return;
+
+    for (unsigned int i = 0; i < counters.size(); i++)
+    {
+        uint64_t hashes = counters[i].hashes.load(std::memory_order_relaxed);
+        threadHashrates[i] = (hashes - lastHashes[i]) * 1000.0 / elapsed;
+        lastHashes[i] = hashes;
+    }
+
+    lastUpdate = now;
+}
+
+// ----------------------------------------------------------------
+
+MiningStatsSnapshot
+MiningStats::getSnapshot()
+{
+    boost::mutex::scoped_lock lock(mutex);
+
+    MiningStatsSnapshot snapshot;
+    snapshot.threadHashrates = threadHashrates;
+    for (unsigned int i = 0; i < counters.size(); i++)
+    {
+        snapshot.hashrate += threadHashrates[i];
+        snapshot.totalHashes += counters[i].hashes.load(std::memory_order_relaxed);
+    }
+
+    snapshot.blocks = blocks;
+    snapshot.lastTimeToBlock = lastTimeToBlock;
+    snapshot.minTimeToBlock = minTimeToBlock;
+    snapshot.maxTimeToBlock = maxTimeToBlock;
+    if (blocks > 0)
+        snapshot.averageTimeToBlock = (double) sumTimeToBlock / blocks;
+
+    return snapshot;
+}
@@ -0,0 +1,99 @@
+/*=============================================================================
+
+Statistics of the mining process: how many hashes each mining thread computed,
+the resulting hash rate and how long it took to find a block.
+
+The hash counters are updated by the mining threads without locking (every
+thread has its own counter on its own cache line). The hash rate is a gauge,
+it is measured over the interval between two calls of update().
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_MININGSTATS_H
+#define BITVOTING_MININGSTATS_H
+
+#include <atomic>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+// ----------------------------------------------------------------
+// Values of the statistics at one point in time
+struct MiningStatsSnapshot
+{
+    // hashes per second of each thread (during the last interval)
+    std::vector<double> threadHashrates;
+
+    // hashes per second of all threads (during the last interval)
+    double hashrate = 0;
+
+    // hashes computed since the start
+    uint64_t totalHashes = 0;
+
+    // blocks found since the start
+    unsigned int blocks = 0;
+
+    // time it took to find a block, from the start of mining on its
+    // predecessor (msec)
+    long long lastTimeToBlock = 0;
+    long long minTimeToBlock = 0;
+    long long maxTimeToBlock = 0;
+    double averageTimeToBlock = 0;
+};
+
+// ----------------------------------------------------------------
+class MiningStats
+{
+public:
+    MiningStats(unsigned int numThreads);
+
+    // Count hashes computed by the given thread (lock-free)
+    void addHashes(unsigned int thread, uint64_t count)
+    {
+        counters[thread].hashes.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // Count a found block and the time it took (msec)
+    void addBlock(long long timeToBlock);
+
+    // Measure the hash rates since the last update
+    void update();
+
+    // Get the current values (hash rates as of the last update)
+    MiningStatsSnapshot getSnapshot();
+
+    unsigned int getNumThreads() const
+    {
+        return counters.size();
+    }
+
+private:
+
+    // hash counter of one thread, padded to a cache line of its own
+    struct ThreadCounter
+    {
+        std::atomic<uint64_t> hashes;
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+
+        ThreadCounter() : hashes(0) {}
+    };
+
+    std::vector<ThreadCounter> counters;
+
+    // protects everything below
+    boost::mutex mutex;
+
+    // counters and time (msec) of the last update
+    std::vector<uint64_t> lastHashes;
+    long long lastUpdate;
+
+    std::vector<double> threadHashrates;
+
+    unsigned int blocks = 0;
+    long long lastTimeToBlock = 0;
+    long long minTimeToBlock = 0;
+    long long maxTimeToBlock = 0;
+    long long sumTimeToBlock = 0;
+};
+
+#endif // BITVOTING_MININGSTATS_H
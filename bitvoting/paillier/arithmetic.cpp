@@ -0,0 +1,458 @@
+#include "arithmetic.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+// upper limit for the memory of all cached fixed-base tables
+#define PAILLIER_FIXED_TABLES_BYTES (64 << 20)
+
+// ================================================================
+
+void
+paillier_pow_g(mpz_t res, const mpz_t x, paillier_pubkey_t* pub)
+{
+    // (1+n)^x = 1 + x*n + (x choose 2)*n^2 + ... = 1 + x*n mod n^2
+    if (pub->s == 1)
+    {
+        mpz_mod(res, x, pub->n);
+        mpz_mul(res, res, pub->n);
+        mpz_add_ui(res, res, 1);
+        return;
+    }
+
+    // otherwise the terms up to (x choose s)*n^s remain,
+    // where g has order n^s
+    mpz_t exp, term, nk;
+    mpz_inits(exp, term, nk, NULL);
+    mpz_mod(exp, x, pub->n_s);
+
+    mpz_set_ui(res, 1);
+    mpz_set_ui(nk, 1);
+    for (int k = 1; k <= pub->s; k++)
+    {
+        mpz_mul(nk, nk, pub->n);
+        mpz_bin_ui(term, exp, k);
+        mpz_mul(term, term, nk);
+        mpz_add(res, res, term);
+    }
+    mpz_mod(res, res, pub->n_s1);
+
+    mpz_clears(exp, term, nk, NULL);
+}
+
+// ----------------------------------------------------------------
+
+void
+paillier_log_g(mpz_t res, const mpz_t c, paillier_pubkey_t* pub)
+{
+    mpz_t x, t1, t2, nj, nj1, nk, temp;
+    mpz_inits(x, t1, t2, nj, nj1, nk, temp, NULL);
+
+    // x mod n^j from L(c mod n^(j+1)) = (c mod n^(j+1) - 1) / n, which is
+    // x + (x choose 2)*n + ... + (x choose j)*n^(j-1) mod n^j, where the
+    // binomials are known from x mod n^(j-1) of the previous step
+    mpz_set_ui(x, 0);
+    mpz_set_ui(nj, 1);
+    for (int j = 1; j <= pub->s; j++)
+    {
+        mpz_mul(nj, nj, pub->n);
+        mpz_mul(nj1, nj, pub->n);
+
+        mpz_mod(t1, c, nj1);
+        mpz_sub_ui(t1, t1, 1);
+        mpz_fdiv_q(t1, t1, pub->n);
+
+        // t1 -= (x choose k) * n^(k-1) mod n^j,
+        // with t2 = x * (x-1) * ... * (x-k+1) mod n^j
+        mpz_set(t2, x);
+        mpz_set_ui(nk, 1);
+        for (int k = 2; k <= j; k++)
+        {
+            mpz_sub_ui(x, x, 1);
+            mpz_mul(t2, t2, x);
+            mpz_mod(t2, t2, nj);
+            mpz_mul(nk, nk, pub->n);
+
+            // k! is invertible, as k <= s is smaller than p and q
+            mpz_fac_ui(temp, k);
+            mpz_invert(temp, temp, nj);
+            mpz_mul(temp, temp, t2);
+            mpz_mul(temp, temp, nk);
+            mpz_sub(t1, t1, temp);
+            mpz_mod(t1, t1, nj);
+        }
+
+        mpz_set(x, t1);
+    }
+
+    mpz_set(res, x);
+    mpz_clears(x, t1, t2, nj, nj1, nk, temp, NULL);
+}
+
+// ----------------------------------------------------------------
+
+// width of the windows of the exponents (in bits), chosen so that
+// building the tables (2^w entries per base) pays off: minimizes
+// the multiplications per base, i.e. the table plus one per window
+static int
+windowSize(size_t bits)
+{
+    int best = 1;
+    for (int w = 2; w <= 8; w++)
+    {
+        if (((size_t) 1 << w) + bits / w < ((size_t) 1 << best) + bits / best)
+            best = w;
+    }
+    return best;
+}
+
+// value of the bits [pos, pos+w) of e
+static unsigned int
+window(const mpz_t e, size_t pos, int w)
+{
+    unsigned int digit = 0;
+    for (int i = w - 1; i >= 0; i--)
+        digit = (digit << 1) | mpz_tstbit(e, pos + i);
+    return digit;
+}
+
+// ----------------------------------------------------------------
+
+void
+paillier_powm_multi(mpz_t res, mpz_srcptr *bases, mpz_srcptr *exps, int count, const mpz_t m)
+{
+    size_t bits = 1;
+    for (int i = 0; i < count; i++)
+    {
+        assert(mpz_sgn(exps[i]) >= 0);
+        bits = std::max(bits, mpz_sizeinbase(exps[i], 2));
+    }
+
+    int w = windowSize(bits);
+    unsigned int size = 1 << w;
+
+    // tables of the powers 0 .. 2^w-1 of every base (one after another)
+    std::vector<mpz_wrapper> tables(count * size);
+    for (int i = 0; i < count; i++)
+    {
+        mpz_wrapper* table = &tables[i * size];
+        for (unsigned int j = 0; j < size; j++)
+            mpz_init(table[j].value);
+
+        mpz_set_ui(table[0].value, 1);
+        mpz_mod(table[1].value, bases[i], m);
+        for (unsigned int j = 2; j < size; j++)
+        {
+            mpz_mul(table[j].value, table[j - 1].value, table[1].value);
+            mpz_mod(table[j].value, table[j].value, m);
+        }
+    }
+
+    // left to right over the windows of all exponents at once
+    mpz_t acc;
+    mpz_init_set_ui(acc, 1);
+    size_t windows = (bits + w - 1) / w;
+    for (size_t i = windows; i-- > 0;)
+    {
+        if (i + 1 < windows)
+        {
+            for (int j = 0; j < w; j++)
+            {
+                mpz_mul(acc, acc, acc);
+                mpz_mod(acc, acc, m);
+            }
+        }
+
+        for (int j = 0; j < count; j++)
+        {
+            unsigned int digit = window(exps[j], i * w, w);
+            if (!digit)
+                continue;
+
+            mpz_mul(acc, acc, tables[j * size + digit].value);
+            mpz_mod(acc, acc, m);
+        }
+    }
+
+    mpz_mod(res, acc, m);
+
+    for (unsigned int i = 0; i < tables.size(); i++)
+        mpz_clear(tables[i].value);
+    mpz_clear(acc);
+}
+
+// ----------------------------------------------------------------
+
+bool
+paillier_powm2(mpz_t res,
+               const mpz_t b1, const mpz_t e1,
+               const mpz_t b2, const mpz_t e2,
+               const mpz_t m)
+{
+    mpz_t base1, base2, exp1, exp2, acc;
+    mpz_inits(base1, base2, exp1, exp2, acc, NULL);
+
+    // b^(-e) = (b^-1)^e
+    bool invertible = true;
+    mpz_abs(exp1, e1);
+    mpz_abs(exp2, e2);
+    if (mpz_sgn(e1) < 0)
+        invertible &= mpz_invert(base1, b1, m) != 0;
+    else
+        mpz_mod(base1, b1, m);
+    if (mpz_sgn(e2) < 0)
+        invertible &= mpz_invert(base2, b2, m) != 0;
+    else
+        mpz_mod(base2, b2, m);
+
+    if (!invertible)
+    {
+        mpz_clears(base1, base2, exp1, exp2, acc, NULL);
+        return false;
+    }
+
+    size_t bits1 = mpz_sizeinbase(exp1, 2);
+    size_t bits2 = mpz_sizeinbase(exp2, 2);
+    size_t bits = std::max(bits1, bits2);
+
+    // only the squarings of the shorter exponent are saved, which does not
+    // pay off against mpz_powm (Montgomery reduction) if it is much shorter
+    if (2 * std::min(bits1, bits2) < bits)
+    {
+        mpz_powm(acc, base2, exp2, m);
+        mpz_powm(res, base1, exp1, m);
+        mpz_mul(res, res, acc);
+        mpz_mod(res, res, m);
+    }
+    else
+    {
+        mpz_srcptr bases[] = { base1, base2 };
+        mpz_srcptr exps[] = { exp1, exp2 };
+        paillier_powm_multi(res, bases, exps, 2, m);
+    }
+
+    mpz_clears(base1, base2, exp1, exp2, acc, NULL);
+    return true;
+}
+
+// ================================================================
+
+// powers b^(2^(w*i)) mod m of a fixed base for all windows i
+struct FixedBaseTable
+{
+    int w;
+
+    // exponents up to this size are covered
+    size_t bits;
+
+    std::vector<mpz_wrapper> powers;
+
+    // for dropping the least recently used tables
+    unsigned long lastUse = 0;
+
+    FixedBaseTable(const mpz_t b, size_t bits, const mpz_t m);
+    ~FixedBaseTable();
+
+    FixedBaseTable(FixedBaseTable const&)  = delete;
+    void operator=(FixedBaseTable const&)  = delete;
+
+    // memory of the powers for exponents of the given size (in bytes)
+    static size_t memory(size_t bits, const mpz_t m)
+    {
+        return (bits + windowSize(bits) - 1) / windowSize(bits) * mpz_size(m) * sizeof(mp_limb_t);
+    }
+
+    size_t bytes;
+
+    // res = b^e mod m (0 <= e < 2^bits)
+    void powm(mpz_t res, const mpz_t e, const mpz_t m) const;
+};
+
+// ----------------------------------------------------------------
+
+FixedBaseTable::FixedBaseTable(const mpz_t b, size_t bits, const mpz_t m) :
+    w(windowSize(bits)),
+    bytes(FixedBaseTable::memory(bits, m))
+{
+    size_t windows = (bits + this->w - 1) / this->w;
+    this->bits = windows * this->w;
+
+    this->powers.resize(windows);
+    mpz_init(this->powers[0].value);
+    mpz_mod(this->powers[0].value, b, m);
+    for (size_t i = 1; i < windows; i++)
+    {
+        mpz_init_set(this->powers[i].value, this->powers[i - 1].value);
+        for (int j = 0; j < this->w; j++)
+        {
+            mpz_mul(this->powers[i].value, this->powers[i].value, this->powers[i].value);
+            mpz_mod(this->powers[i].value, this->powers[i].value, m);
+        }
+    }
+}
+
+FixedBaseTable::~FixedBaseTable()
+{
+    for (unsigned int i = 0; i < this->powers.size(); i++)
+        mpz_clear(this->powers[i].value);
+}
+
+// ----------------------------------------------------------------
+
+void
+FixedBaseTable::powm(mpz_t res, const mpz_t e, const mpz_t m) const
+{
+    // windows ordered by their digits (highest first)
+    std::vector<std::pair<unsigned int, size_t>> digits;
+    for (size_t i = 0; i < this->powers.size(); i++)
+    {
+        unsigned int digit = window(e, i * this->w, this->w);
+        if (digit)
+            digits.push_back(std::make_pair(digit, i));
+    }
+    std::sort(digits.rbegin(), digits.rend());
+
+    // b^e = prod_j (prod_{i: digit i = j} b^(2^(w*i)))^j, the inner
+    // products are accumulated from the highest j down, so that multiplying
+    // them into the result for every j raises them to the power of j
+    mpz_t acc, result;
+    mpz_init_set_ui(acc, 1);
+    mpz_init_set_ui(result, 1);
+
+    size_t next = 0;
+    for (unsigned int j = digits.empty() ? 0 : digits[0].first; j > 0; j--)
+    {
+        for (; next < digits.size() && digits[next].first == j; next++)
+        {
+            mpz_mul(acc, acc, this->powers[digits[next].second].value);
+            mpz_mod(acc, acc, m);
+        }
+
+        mpz_mul(result, result, acc);
+        mpz_mod(result, result, m);
+    }
+
+    mpz_mod(res, result, m);
+    mpz_clears(acc, result, NULL);
+}
+
+// ----------------------------------------------------------------
+
+// the tables are shared by all keys with the same modulus and base,
+// e.g. all copies of the key of an election
+typedef std::pair<std::string, std::string> FixedBaseKey;
+
+static boost::mutex fixedTablesMutex;
+static std::map<FixedBaseKey, boost::shared_ptr<FixedBaseTable>> fixedTables;
+static size_t fixedTablesSize = 0;
+static unsigned long fixedTablesClock = 0;
+
+static std::string
+limbs(const mpz_t x)
+{
+    return std::string((const char*) mpz_limbs_read(x), mpz_size(x) * sizeof(mp_limb_t));
+}
+
+// gets the table of the base (covering exponents of the given size),
+// builds it if there is none yet. Returns NULL, if it is too large to keep.
+static boost::shared_ptr<FixedBaseTable>
+fixedTable(const mpz_t b, size_t bits, const mpz_t m)
+{
+    FixedBaseKey key(limbs(m), limbs(b));
+    {
+        boost::mutex::scoped_lock lock(fixedTablesMutex);
+
+        std::map<FixedBaseKey, boost::shared_ptr<FixedBaseTable>>::iterator iter = fixedTables.find(key);
+        if (iter != fixedTables.end() && iter->second->bits >= bits)
+        {
+            iter->second->lastUse = ++fixedTablesClock;
+            return iter->second;
+        }
+    }
+
+    // some room for larger exponents, so the table is not rebuilt for every bit
+    bits = (bits + 127) / 64 * 64;
+
+    if (FixedBaseTable::memory(bits, m) > PAILLIER_FIXED_TABLES_BYTES)
+        return boost::shared_ptr<FixedBaseTable>();
+
+    // built without holding the lock
+    boost::shared_ptr<FixedBaseTable> table(new FixedBaseTable(b, bits, m));
+
+    boost::mutex::scoped_lock lock(fixedTablesMutex);
+
+    boost::shared_ptr<FixedBaseTable> &entry = fixedTables[key];
+    if (entry && entry->bits >= table->bits)
+        table = entry;
+    else
+    {
+        if (entry)
+            fixedTablesSize -= entry->bytes;
+
+        entry = table;
+        fixedTablesSize += table->bytes;
+    }
+    table->lastUse = ++fixedTablesClock;
+
+    // drop the least recently used tables (in use ones are freed afterwards)
+    while (fixedTablesSize > PAILLIER_FIXED_TABLES_BYTES)
+    {
+        std::map<FixedBaseKey, boost::shared_ptr<FixedBaseTable>>::iterator oldest = fixedTables.begin(), iter;
+        for (iter = fixedTables.begin(); iter != fixedTables.end(); iter++)
+        {
+            if (iter->second->lastUse < oldest->second->lastUse)
+                oldest = iter;
+        }
+
+        fixedTablesSize -= oldest->second->bytes;
+        fixedTables.erase(oldest);
+    }
+
+    return table;
+}
+
+// ----------------------------------------------------------------
+
+bool
+paillier_powm_fixed(mpz_t res, const mpz_t b, const mpz_t e, const mpz_t m)
+{
+    mpz_t base, exp;
+    mpz_inits(base, exp, NULL);
+
+    // b^(-e) = (b^-1)^e
+    mpz_abs(exp, e);
+    if (mpz_sgn(e) < 0)
+    {
+        if (!mpz_invert(base, b, m))
+        {
+            mpz_clears(base, exp, NULL);
+            return false;
+        }
+    }
+    else
+        mpz_mod(base, b, m);
+
+    boost::shared_ptr<FixedBaseTable> table = fixedTable(base, mpz_sizeinbase(exp, 2), m);
+    if (table)
+        table->powm(res, exp, m);
+    else
+        mpz_powm(res, base, exp, m);
+
+    mpz_clears(base, exp, NULL);
+    return true;
+}
+
+// ----------------------------------------------------------------
+
+size_t
+paillier_fixed_tables_size()
+{
+    boost::mutex::scoped_lock lock(fixedTablesMutex);
+    return fixedTablesSize;
+}
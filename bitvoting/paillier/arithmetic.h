@@ -0,0 +1,58 @@
+/*=============================================================================
+
+Arithmetic shared by encryption, proofs and verification.
+
+Keys use g = n+1 as generator (see paillier_keygen), so every power of g has
+the closed form g^x = 1 + x*n mod n^2 (binomial theorem) and needs no modular
+exponentiation. For keys with s > 1 (see paillier_pubkey_t), the expansion
+has s+1 terms mod n^(s+1), and the inverse (the discrete logarithm to the
+base g, needed for decryption) is computed digit by digit (Damgard-Jurik). Products of two powers, like v^n * c^(-e) in the proofs, are
+computed in one pass over the exponents (Straus/Shamir's trick), which shares
+the squarings of both exponentiations. The same works for any number of
+bases, e.g. to check many proofs at once (see paillier_verify_enc_batch).
+
+Some bases are fixed for the lifetime of a key: v and the verification keys
+of the trustees. For them, the powers b^(2^(w*i)) are computed once and kept
+in a cache (bounded by PAILLIER_FIXED_TABLES_BYTES, least recently used
+tables are dropped). An exponentiation then needs no squarings at all, but
+only one multiplication per window of the exponent plus 2^w (Yao).
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef PAILLIER_ARITHMETIC_H
+#define PAILLIER_ARITHMETIC_H
+
+#include "paillier.h"
+
+// ==========================================================================
+
+// res = g^x mod n^(s+1) for g = n+1 (x may be negative)
+void paillier_pow_g(mpz_t res, const mpz_t x, paillier_pubkey_t* pub);
+
+// res = x in [0, n^s), where g^x = c mod n^(s+1) for g = n+1
+// (c has to be a power of g)
+void paillier_log_g(mpz_t res, const mpz_t c, paillier_pubkey_t* pub);
+
+// res = b1^e1 * b2^e2 mod m. Negative exponents invert their base,
+// returns false (and leaves res unchanged) if that inverse does not exist.
+bool paillier_powm2(mpz_t res,
+                    const mpz_t b1, const mpz_t e1,
+                    const mpz_t b2, const mpz_t e2,
+                    const mpz_t m);
+
+// res = product of bases[i]^exps[i] mod m for i < count
+// (the exponents must not be negative)
+void paillier_powm_multi(mpz_t res,
+                         mpz_srcptr *bases, mpz_srcptr *exps, int count,
+                         const mpz_t m);
+
+// res = b^e mod m for a base, which is used over and over (see above).
+// The table of the base is built on first use. Negative exponents invert
+// the base, returns false (and leaves res unchanged) if that inverse does
+// not exist.
+bool paillier_powm_fixed(mpz_t res, const mpz_t b, const mpz_t e, const mpz_t m);
+
+// memory used by the cached fixed-base tables (in bytes)
+size_t paillier_fixed_tables_size();
+
+#endif // PAILLIER_ARITHMETIC_H
@@ -33,7 +33,10 @@ bool operator==(const paillier_partialdecryption_proof_t& first,
             mpz_equal(first.c4, second.c4) &&
             mpz_equal(first.ci2, second.ci2) &&
             mpz_equal(first.e, second.e) &&
-            mpz_equal(first.z, second.z));
+            mpz_equal(first.z, second.z) &&
+            mpz_equal(first.a, second.a) &&
+            mpz_equal(first.b, second.b) &&
+            first.version == second.version);
 }
 
 // ----------------------------------------------------------------
@@ -52,6 +55,10 @@ bool operator<(const paillier_partialdecryption_proof_t& first,
     if (mpz_less(first.e, second.e)) return true;
     if (mpz_less(second.e, first.e)) return false;
     if (mpz_less(first.z, second.z)) return true;
+    if (mpz_less(second.z, first.z)) return false;
+    if (mpz_less(first.a, second.a)) return true;
+    if (mpz_less(second.a, first.a)) return false;
+    if (mpz_less(first.b, second.b)) return true;
     return false;
 }
 
@@ -60,12 +67,24 @@ bool operator<(const paillier_partialdecryption_proof_t& first,
 bool operator==(const paillier_ciphertext_proof_t& first,
                 const paillier_ciphertext_proof_t& second)
 {
+    for (int i = 0; i < first.count - 2 && first.count == second.count; i++)
+    {
+        if (!mpz_equal(first.ek[i], second.ek[i]) ||
+                !mpz_equal(first.vk[i], second.vk[i]) ||
+                !mpz_equal(first.uk[i], second.uk[i]))
+            return false;
+    }
+
     return mpz_equal(first.c, second.c) &&
             mpz_equal(first.e, second.e) &&
             mpz_equal(first.e1, second.e1) &&
             mpz_equal(first.e2, second.e2) &&
             mpz_equal(first.v1, second.v1) &&
-            mpz_equal(first.v2, second.v2);
+            mpz_equal(first.v2, second.v2) &&
+            mpz_equal(first.u1, second.u1) &&
+            mpz_equal(first.u2, second.u2) &&
+            first.version == second.version &&
+            first.count == second.count;
 }
 
 // ----------------------------------------------------------------
@@ -84,6 +103,22 @@ bool operator<(const paillier_ciphertext_proof_t& first,
     if (mpz_less(first.v1, second.v1)) return true;
     if (mpz_less(second.v1, first.v1)) return false;
     if (mpz_less(first.v2, second.v2)) return true;
+    if (mpz_less(second.v2, first.v2)) return false;
+    if (mpz_less(first.u1, second.u1)) return true;
+    if (mpz_less(second.u1, first.u1)) return false;
+    if (mpz_less(first.u2, second.u2)) return true;
+    if (mpz_less(second.u2, first.u2)) return false;
+    if (first.count < second.count) return true;
+    if (second.count < first.count) return false;
+    for (int i = 0; i < first.count - 2; i++)
+    {
+        if (mpz_less(first.ek[i], second.ek[i])) return true;
+        if (mpz_less(second.ek[i], first.ek[i])) return false;
+        if (mpz_less(first.vk[i], second.vk[i])) return true;
+        if (mpz_less(second.vk[i], first.vk[i])) return false;
+        if (mpz_less(first.uk[i], second.uk[i])) return true;
+        if (mpz_less(second.uk[i], first.uk[i])) return false;
+    }
     return false;
 }
 
@@ -102,12 +137,14 @@ bool operator==(const paillier_pubkey_t& first,
                 const paillier_pubkey_t& second)
 {
     bool result = (first.bits == second.bits &&
+            first.s == second.s &&
             mpz_equal(first.combineSharesConstant, second.combineSharesConstant) &&
             first.decryptServers == second.decryptServers &&
             mpz_equal(first.delta, second.delta) &&
             mpz_equal(first.n, second.n) &&
             mpz_equal(first.n_plusone, second.n_plusone) &&
-            mpz_equal(first.n_squared, second.n_squared) &&
+            mpz_equal(first.n_s, second.n_s) &&
+            mpz_equal(first.n_s1, second.n_s1) &&
             first.threshold == second.threshold &&
             mpz_equal(first.v, second.v));
 
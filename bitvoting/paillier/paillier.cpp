@@ -20,8 +20,14 @@
 #include <string.h>
 #include <sstream>
 #include "paillier.h"
+#include "arithmetic.h"
+#include "primes.h"
 #include "bitcoin/allocators.h"
 #include "bitcoin/hash.h"
+#include "utils/hashsink.h"
+
+#include <algorithm>
+#include <map>
 
 #include <boost/foreach.hpp>
 
@@ -43,24 +49,6 @@ init_rand( gmp_randstate_t rand, paillier_get_rand_t get_rand, int bytes )
     free(buf);
 }
 
-void
-genSafePrimes( mpz_t* p1, mpz_t* p, int modulusbits, gmp_randstate_t rand )
-{
-    mpz_init(*p1);
-    mpz_init(*p);
-    do
-    {
-        do
-            mpz_urandomb(*p1, rand, (modulusbits / 2) - 1);
-        while( !mpz_probab_prime_p(*p1, 10) );
-        mpz_mul_ui(*p,*p1,2);
-        mpz_add_ui(*p,*p,1);
-    }
-    while( !mpz_probab_prime_p(*p, 10) );
-}
-
-
-
 paillier_polynomial_point_t*
 evaluatePolynomial(mpz_t* a, int aLength, int X, mpz_t nm)
 {
@@ -86,15 +74,24 @@ void
 paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
                                  paillier_pubkey_t** pub,
                                  paillier_partialkey_t*** partKeys,
-                                 paillier_get_rand_t get_rand )
+                                 paillier_get_rand_t get_rand,
+                                 int s )
 {
-    mpz_t p1;
-    mpz_t q1;
-    mpz_t p;
-    mpz_t q;
+    paillier_keygen(modulusbits, decryptServers, thresholdServers, pub, partKeys, get_rand, NULL, NULL, s);
+}
+
+bool
+paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
+                                 paillier_pubkey_t** pub,
+                                 paillier_partialkey_t*** partKeys,
+                                 paillier_get_rand_t get_rand,
+                                 paillier_keygen_progress_t progress, void* data,
+                                 int s )
+{
+    mpz_t p1[2];
+    mpz_t p[2];
     mpz_t m;
     mpz_t nm;
-    mpz_t nSquare;
     mpz_t mInversToN;
     mpz_t d;
     mpz_t r;
@@ -105,6 +102,18 @@ paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
     mpz_t * viarray;
     gmp_randstate_t rand;
 
+    assert(s >= 1 && s <= PAILLIER_MAX_S);
+
+    /* pick random (modulusbits/2)-bit safe primes p and q (on all cores).
+       Their upper two bits are set, so n = p q has exactly modulusbits. */
+
+    mpz_inits(p1[0], p1[1], p[0], p[1], NULL);
+    if (!paillier_gen_safe_primes(p1, p, 2, modulusbits / 2 - 1, get_rand, progress, data))
+    {
+        mpz_clears(p1[0], p1[1], p[0], p[1], NULL);
+        return false;
+    }
+
     /* allocate the new key structures */
 
     *pub = (paillier_pubkey_t*) malloc(sizeof(paillier_pubkey_t));
@@ -113,14 +122,14 @@ paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
     /* initialize our integers */
 
     mpz_init((*pub)->n);
-    mpz_init((*pub)->n_squared);
+    mpz_init((*pub)->n_s);
+    mpz_init((*pub)->n_s1);
     mpz_init((*pub)->n_plusone);
     mpz_init((*pub)->delta);
     mpz_init((*pub)->combineSharesConstant);
     mpz_init((*pub)->v);
     mpz_init(m);
     mpz_init(nm);
-    mpz_init(nSquare);
     mpz_init(mInversToN);
     mpz_init(d);
     mpz_init(r);
@@ -128,41 +137,30 @@ paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
     mpz_init(vExp);
 
 
-    /* pick random (modulusbits/2)-bit primes p and q */
+    /* compute the public modulus n = p q */
 
     init_rand(rand, get_rand, modulusbits / 8 + 1);
-    do
-    {
-        genSafePrimes(&p1,&p,modulusbits,rand);
-
-        do
-            genSafePrimes(&q1,&q,modulusbits,rand);
-        while( mpz_cmp(p,q)==0 || mpz_cmp(p,q1)==0 || mpz_cmp(q,p1)==0 || mpz_cmp(q1,p1)==0 );
-
-        /* compute the public modulus n = p q */
-
-        mpz_mul((*pub)->n, p, q);
-        mpz_mul(m, p1, q1);
-    } while( !mpz_tstbit((*pub)->n, modulusbits - 1) );
+    mpz_mul((*pub)->n, p[0], p[1]);
+    mpz_mul(m, p1[0], p1[1]);
     (*pub)->bits = modulusbits;
+    (*pub)->s = s;
     (*pub)->decryptServers = decryptServers;
     (*pub)->threshold = thresholdServers;
     (*pub)->complete();
 
 
     // We decide on some s>0, thus the plaintext space will be Zn^s
-    // for now we set s=1
-    mpz_mul(nm, (*pub)->n, m);
-    mpz_mul(nSquare, (*pub)->n, (*pub)->n);
+    // (given by the caller, 1 for Paillier)
+    mpz_mul(nm, (*pub)->n_s, m);
 
     // next d need to be chosen such that
-    // d=0 mod m and d=1 mod n, using Chinese remainder thm
+    // d=0 mod m and d=1 mod n^s, using Chinese remainder thm
     // we can find d using Chinese remainder thm
-    // note that $d=(m. (m^-1 mod n))$
-    int errorCode = mpz_invert(mInversToN,m,(*pub)->n);
+    // note that $d=(m. (m^-1 mod n^s))$
+    int errorCode = mpz_invert(mInversToN,m,(*pub)->n_s);
     if (errorCode == 0)
     {
-        throw std::runtime_error("Inverse of m mod n not found!");
+        throw std::runtime_error("Inverse of m mod n^s not found!");
     }
     mpz_mul(d,m,mInversToN);
 
@@ -180,18 +178,18 @@ paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
 
 
     //We need to generate v
-    //Although v needs to be the generator of the squares in Z^*_{n^2}
+    //Although v needs to be the generator of the squares in Z^*_{n^(s+1)}
     //I will use a heuristic which gives a generator with high prob.
-    //get a random element r such that gcd(r,nSquare) is one
-    //set v=r*r mod nSquare. This heuristic is used in the Victor Shoup
+    //get a random element r such that gcd(r,n^(s+1)) is one
+    //set v=r*r mod n^(s+1). This heuristic is used in the Victor Shoup
     //threshold signature paper.
     do
     {
-        mpz_urandomb(r, rand, 4*modulusbits);
+        mpz_urandomb(r, rand, 2*(s+1)*modulusbits);
         mpz_gcd(gcdRN, r, (*pub)->n);
     } while( !mpz_cmp_ui(gcdRN, 1)==0 );
-    // we can now set v to r*r mod nSquare
-    mpz_powm_ui((*pub)->v, r, 2, nSquare);
+    // we can now set v to r*r mod n^(s+1)
+    mpz_powm_ui((*pub)->v, r, 2, (*pub)->n_s1);
 
     //This array holds the resulting keys
     shares = (mpz_t*) malloc(sizeof(mpz_t) * decryptServers);
@@ -208,7 +206,7 @@ paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
         paillier_freepolynomialpoint(polynPoint);
         //for each decryption server a verication key v_i=v^(delta*s_i) mod n^(s+1)
         mpz_mul(vExp, (*pub)->delta, shares[i]);
-        mpz_powm(viarray[i], (*pub)->v, vExp, nSquare);
+        paillier_powm_fixed(viarray[i], (*pub)->v, vExp, (*pub)->n_s1);
     }
 
 
@@ -234,13 +232,9 @@ paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
 
     /* clear temporary integers and randstate */
 
-    mpz_clear(p);
-    mpz_clear(q);
-    mpz_clear(p1);
-    mpz_clear(q1);
+    mpz_clears(p1[0], p1[1], p[0], p[1], NULL);
     mpz_clear(m);
     mpz_clear(nm);
-    mpz_clear(nSquare);
     mpz_clear(mInversToN);
     mpz_clear(d);
     mpz_clear(r);
@@ -257,61 +251,102 @@ paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
     }
     free(shares);
     free(viarray);
+
+    return true;
 }
 
 // hashMultiple hashes multiple mpz_t values by
-// concatenating their hex representation
+// concatenating their hex representation (and a null-terminator)
 // remember: mpz_t[0] == __mpz_struct
 uint256
 hashMultiple(std::vector<__mpz_struct> &in)
 {
-    uint256 out;
+    HashWriter hasher;
 
-    /* get strings */
-    std::vector<char*> chars;
-    int newSize = 0;
+    /* hash the strings one after another, reusing the buffer */
+    std::vector<char> buffer;
     BOOST_FOREACH(__mpz_struct val, in)
     {
         mpz_t value = { val };
-        char *str = mpz_get_str(NULL, 16, value);
-        chars.push_back(str);
-        newSize += strlen(str);
+
+        // see GMP docs for the +2
+        buffer.resize(std::max(buffer.size(), mpz_sizeinbase(value, 16) + 2));
+        mpz_get_str(&buffer[0], 16, value);
+        hasher.write(&buffer[0], strlen(&buffer[0]));
     }
 
-    /* concat */
-    // Determine new size (+1 because of null-terminator)
-    newSize += 1;
-    // Allocate new buffer
-    char* concat = (char *)malloc(newSize);
-    // do the copy and concat
-    strcpy(concat, "");
-    BOOST_FOREACH(char* c, chars)
+    static const char terminator = '\0';
+    hasher.write(&terminator, 1);
+
+    return hasher.getHash();
+}
+
+// hashTranscript hashes multiple (non-negative) mpz_t values by
+// writing the proof version and then every value as its length (uint32,
+// little-endian) followed by its big-endian bytes
+uint256
+hashTranscript(std::vector<__mpz_struct> &in, int version)
+{
+    HashWriter hasher;
+
+    const unsigned char versionByte = version;
+    hasher.write(&versionByte, 1);
+
+    /* export the values one after another, reusing the buffer */
+    std::vector<unsigned char> buffer;
+    BOOST_FOREACH(__mpz_struct val, in)
     {
-        strncat(concat, c, strlen(c));
+        mpz_t value = { val };
+
+        size_t count = 0;
+        buffer.resize(std::max(buffer.size(), (mpz_sizeinbase(value, 2) + 7) / 8));
+        if (mpz_sgn(value) != 0)
+            mpz_export(&buffer[0], &count, 1, 1, 1, 0, value);
+
+        unsigned char length[4];
+        for (int i = 0; i < 4; i++)
+            length[i] = (unsigned char) (count >> (8 * i));
+        hasher.write(length, sizeof(length));
+        hasher.write(&buffer[0], count);
     }
 
-    /* build hash */
-    out = Hash(concat, concat + newSize);
+    return hasher.getHash();
+}
 
-    /* free temporary variables */
-    BOOST_FOREACH(char* c, chars)
+bool
+paillier_challenge(mpz_t e, std::vector<__mpz_struct> &in, int version)
+{
+    uint256 hash;
+    switch (version)
     {
-        free(c);
+    case PAILLIER_PROOF_V1:
+        hash = hashMultiple(in);
+        break;
+    case PAILLIER_PROOF_V2:
+    case PAILLIER_PROOF_V3:
+    case PAILLIER_PROOF_V4:
+    case PAILLIER_PROOF_V5:
+        hash = hashTranscript(in, version);
+        break;
+    default:
+        return false;
     }
 
-    return out;
+    // the hash is a little-endian number (same value as its hex string)
+    mpz_import(e, hash.size(), -1, 1, 0, 0, hash.begin());
+    return true;
 }
 
-// hash4 calculates the hash of 4 given mpz_t values
-uint256
-hash4(mpz_t a, mpz_t b, mpz_t c, mpz_t d)
+// challenge4 calculates the challenge over 4 given mpz_t values
+bool
+challenge4(mpz_t e, mpz_t a, mpz_t b, mpz_t c, mpz_t d, int version)
 {
     std::vector<__mpz_struct> vec;
     vec.push_back(a[0]);
     vec.push_back(b[0]);
     vec.push_back(c[0]);
     vec.push_back(d[0]);
-    return hashMultiple(vec);
+    return paillier_challenge(e, vec, version);
 }
 
 paillier_ciphertext_pure_t*
@@ -343,21 +378,62 @@ paillier_enc( paillier_ciphertext_pure_t* res,
         mpz_init(res->c);
     }
     mpz_init(x);
-    mpz_powm(res->c, pub->n_plusone, pt->m, pub->n_squared);
-    mpz_powm(x, r, pub->n, pub->n_squared);
+    paillier_pow_g(res->c, pt->m, pub);
+    mpz_powm(x, r, pub->n_s, pub->n_s1);
 
     mpz_mul(res->c, res->c, x);
-    mpz_mod(res->c, res->c, pub->n_squared);
+    mpz_mod(res->c, res->c, pub->n_s1);
 
     mpz_clear(x);
 
     return res;
 }
 
+// challenge, response and commitment of branch i of an encryption proof
+// (the branches after the second are kept in ek, vk, uk)
+static mpz_ptr
+branchE(paillier_ciphertext_proof_t *proof, int i)
+{
+    return (i == 0) ? proof->e1 : (i == 1) ? proof->e2 : proof->ek[i - 2];
+}
+
+static mpz_ptr
+branchV(paillier_ciphertext_proof_t *proof, int i)
+{
+    return (i == 0) ? proof->v1 : (i == 1) ? proof->v2 : proof->vk[i - 2];
+}
+
+static mpz_ptr
+branchU(paillier_ciphertext_proof_t *proof, int i)
+{
+    return (i == 0) ? proof->u1 : (i == 1) ? proof->u2 : proof->uk[i - 2];
+}
+
+// challenge, response and commitment of the simulated proof j of a
+// precomputation (the ones after the first are kept in ek, vk, uk)
+static mpz_ptr
+simulatedE(paillier_enc_precomputation_t *pre, int j)
+{
+    return (j == 0) ? pre->e2 : pre->ek[j - 1];
+}
+
+static mpz_ptr
+simulatedV(paillier_enc_precomputation_t *pre, int j)
+{
+    return (j == 0) ? pre->v2 : pre->vk[j - 1];
+}
+
+static mpz_ptr
+simulatedU(paillier_enc_precomputation_t *pre, int j)
+{
+    return (j == 0) ? pre->u2 : pre->uk[j - 1];
+}
+
 paillier_ciphertext_proof_t *paillier_enc_proof(paillier_pubkey_t *pub,
                                           PLAINTEXT_SELECTION choice,
                                           paillier_get_rand_t get_rand,
-                                          const char *r_hex)
+                                          const char *r_hex,
+                                          int version)
 {
     paillier_plaintext_t *pt1 = paillier_plaintext_from_ui(0);
     paillier_plaintext_t *pt2 = paillier_plaintext_from_ui(1);
@@ -366,7 +442,8 @@ paillier_ciphertext_proof_t *paillier_enc_proof(paillier_pubkey_t *pub,
                                                          pt2,
                                                          choice,
                                                          get_rand,
-                                                         r_hex);
+                                                         r_hex,
+                                                         version);
     paillier_freeplaintext(pt1);
     paillier_freeplaintext(pt2);
     return out;
@@ -377,44 +454,171 @@ paillier_ciphertext_proof_t *paillier_enc_proof(paillier_pubkey_t *pub,
                                           paillier_plaintext_t *pt2,
                                           PLAINTEXT_SELECTION index,
                                           paillier_get_rand_t get_rand,
-                                          const char *r_hex)
+                                          const char *r_hex,
+                                          int version)
+{
+    paillier_plaintext_t *plaintexts[] = { pt, pt2 };
+    return paillier_enc_proof(pub, plaintexts, 2, index, get_rand, r_hex, version);
+}
+
+paillier_ciphertext_proof_t *paillier_enc_proof(paillier_pubkey_t *pub,
+                                          paillier_plaintext_t **plaintexts,
+                                          int count,
+                                          int index,
+                                          paillier_get_rand_t get_rand,
+                                          const char *r_hex,
+                                          int version)
+{
+    paillier_enc_precomputation_t *pre = paillier_enc_precompute(pub, get_rand, r_hex, count);
+    paillier_ciphertext_proof_t *out = paillier_enc_proof_precomputed(pub,
+                                                                     plaintexts,
+                                                                     count,
+                                                                     index,
+                                                                     pre,
+                                                                     version);
+    paillier_freeencprecomputation(pre);
+    return out;
+}
+
+paillier_enc_precomputation_t *paillier_enc_precompute(paillier_pubkey_t *pub,
+                                                       paillier_get_rand_t get_rand,
+                                                       const char *r_hex,
+                                                       int count)
 {
     // --- Init ---
-    mpz_t m1;
-    mpz_t m2;
-    mpz_t r;
-    mpz_t rho;
-    mpz_t u1;
-    mpz_t u2;
-    mpz_t gPower;
-    mpz_t cPower;
-    mpz_t e1NoMod;
-    mpz_t rPower;
+    assert(count >= 2);
+
+    mpz_t minusE;
     gmp_randstate_t rand;
 
-    mpz_init_set(m1, pt->m);
-    mpz_init_set(m2, pt2->m);
-    mpz_init(r);
-    mpz_init(rho);
-    mpz_init(u1);
-    mpz_init(u2);
-    mpz_init(gPower);
-    mpz_init(cPower);
-    mpz_init(e1NoMod);
-    mpz_init(rPower);
+    mpz_init(minusE);
     init_rand(rand, get_rand, pub->bits / 8 + 1);
 
-    paillier_plaintext_t *chosenPlaintext = pt;
-    // This method assumes that everything with index 1 corresponds to the plaintext
-    // to be encrpyted.
-    // If index==second the pt2 is the chosen plaintext and pt the "other" plaintext,
-    // so we have to swap the indices!
-    if (index == PLAINTEXT_SELECTION::SECOND)
+    paillier_enc_precomputation_t *pre;
+    pre = (paillier_enc_precomputation_t*) malloc(sizeof(paillier_enc_precomputation_t));
+
+    mpz_init(pre->r);
+    mpz_init(pre->rho);
+    mpz_init(pre->e2);
+    mpz_init(pre->v2);
+    mpz_init(pre->rn);
+    mpz_init(pre->u1);
+    mpz_init(pre->u2);
+
+    pre->count = count;
+    pre->ek = pre->vk = pre->uk = NULL;
+    if (count > 2)
+    {
+        pre->ek = (mpz_t*) malloc(sizeof(mpz_t) * (count - 2));
+        pre->vk = (mpz_t*) malloc(sizeof(mpz_t) * (count - 2));
+        pre->uk = (mpz_t*) malloc(sizeof(mpz_t) * (count - 2));
+        for (int j = 0; j < count - 2; j++)
+        {
+            mpz_init(pre->ek[j]);
+            mpz_init(pre->vk[j]);
+            mpz_init(pre->uk[j]);
+        }
+    }
+
+    // pick random blinding factor r (or take the given one)
+    if( r_hex )
+    {
+        mpz_set_str(pre->r, r_hex, 16);
+        assert(mpz_cmp(pre->r, pub->n) < 0);
+    } else {
+        do
+            mpz_urandomb(pre->r, rand, pub->bits);
+        while( mpz_cmp(pre->r, pub->n) >= 0 );
+    }
+
+    // pick random rho in Z*_n
+    do
+        mpz_urandomb(pre->rho, rand, pub->bits);
+    while( mpz_cmp(pre->rho, pub->n) >= 0 );
+
+    // rn = r^(n^s) mod n^(s+1) (the ciphertext without the plaintext)
+    mpz_powm(pre->rn, pre->r, pub->n_s, pub->n_s1);
+
+    // u1 = rho^(n^s) mod n^(s+1)
+    mpz_powm(pre->u1, pre->rho, pub->n_s, pub->n_s1);
+
+    // one simulated proof for every other plaintext
+    for (int j = 0; j < count - 1; j++)
     {
-        chosenPlaintext = pt2;
-        mpz_swap(m1, m2);
+        mpz_ptr e = simulatedE(pre, j);
+        mpz_ptr v = simulatedV(pre, j);
+
+        // pick random e in Z_n
+        do
+            mpz_urandomb(e, rand, pub->bits);
+        while( mpz_cmp(e, pub->n) >= 0 );
+
+        // pick random v in Z*_n
+        do
+            mpz_urandomb(v, rand, pub->bits);
+        while( mpz_cmp(v, pub->n) >= 0 );
+
+        // u = v^(n^s) * rn^(-e) mod n^(s+1) (u of the proof without g^((mi-m)*e))
+        mpz_neg(minusE, e);
+        paillier_powm2(simulatedU(pre, j), v, pub->n_s, pre->rn, minusE, pub->n_s1);
     }
 
+    // --- Finish ---
+    mpz_clear(minusE);
+    gmp_randclear(rand);
+
+    return pre;
+}
+
+paillier_ciphertext_proof_t *paillier_enc_proof_precomputed(paillier_pubkey_t *pub,
+                                                           PLAINTEXT_SELECTION choice,
+                                                           paillier_enc_precomputation_t *pre,
+                                                           int version)
+{
+    paillier_plaintext_t *pt1 = paillier_plaintext_from_ui(0);
+    paillier_plaintext_t *pt2 = paillier_plaintext_from_ui(1);
+    paillier_ciphertext_proof_t *out = paillier_enc_proof_precomputed(pub,
+                                                                     pt1,
+                                                                     pt2,
+                                                                     choice,
+                                                                     pre,
+                                                                     version);
+    paillier_freeplaintext(pt1);
+    paillier_freeplaintext(pt2);
+    return out;
+}
+
+paillier_ciphertext_proof_t *paillier_enc_proof_precomputed(paillier_pubkey_t *pub,
+                                                           paillier_plaintext_t *pt,
+                                                           paillier_plaintext_t *pt2,
+                                                           PLAINTEXT_SELECTION index,
+                                                           paillier_enc_precomputation_t *pre,
+                                                           int version)
+{
+    paillier_plaintext_t *plaintexts[] = { pt, pt2 };
+    return paillier_enc_proof_precomputed(pub, plaintexts, 2, index, pre, version);
+}
+
+paillier_ciphertext_proof_t *paillier_enc_proof_precomputed(paillier_pubkey_t *pub,
+                                                           paillier_plaintext_t **plaintexts,
+                                                           int count,
+                                                           int index,
+                                                           paillier_enc_precomputation_t *pre,
+                                                           int version)
+{
+    // --- Init ---
+    assert(version >= PAILLIER_PROOF_V1 && version <= PAILLIER_PROOF_V5);
+    assert(count == 2 || (count > 2 && version >= PAILLIER_PROOF_V5));
+    assert(index >= 0 && index < count && pre->count == count);
+
+    mpz_t gPower;
+    mpz_t eNoMod;
+    mpz_t rPower;
+
+    mpz_init(gPower);
+    mpz_init(eNoMod);
+    mpz_init(rPower);
+
     // Create result
     paillier_ciphertext_proof_t *encrProof;
     encrProof = (paillier_ciphertext_proof_t*) malloc(sizeof(paillier_ciphertext_proof_t));
@@ -425,89 +629,128 @@ paillier_ciphertext_proof_t *paillier_enc_proof(paillier_pubkey_t *pub,
     mpz_init(encrProof->v1);
     mpz_init(encrProof->e2);
     mpz_init(encrProof->v2);
+    mpz_init(encrProof->u1);
+    mpz_init(encrProof->u2);
+    encrProof->version = version;
 
-    // Get encryption
-    paillier_enc(encrProof, r, pub, chosenPlaintext, rand, r_hex);
+    encrProof->count = count;
+    encrProof->ek = encrProof->vk = encrProof->uk = NULL;
+    if (count > 2)
+    {
+        encrProof->ek = (mpz_t*) malloc(sizeof(mpz_t) * (count - 2));
+        encrProof->vk = (mpz_t*) malloc(sizeof(mpz_t) * (count - 2));
+        encrProof->uk = (mpz_t*) malloc(sizeof(mpz_t) * (count - 2));
+        for (int i = 0; i < count - 2; i++)
+        {
+            mpz_init(encrProof->ek[i]);
+            mpz_init(encrProof->vk[i]);
+            mpz_init(encrProof->uk[i]);
+        }
+    }
 
-    // pick random rho in Z*_n
-    do
-        mpz_urandomb(rho, rand, pub->bits);
-    while( mpz_cmp(rho, pub->n) >= 0 );
+    // Get encryption c = g^m * r^(n^s) mod n^(s+1) of the chosen plaintext m
+    mpz_ptr m = plaintexts[index]->m;
+    paillier_pow_g(encrProof->c, m, pub);
+    mpz_mul(encrProof->c, encrProof->c, pre->rn);
+    mpz_mod(encrProof->c, encrProof->c, pub->n_s1);
 
-    // pick random e2 in Z_n
-    do
-        mpz_urandomb(encrProof->e2, rand, pub->bits);
-    while( mpz_cmp(encrProof->e2, pub->n) >= 0 );
+    // The branch of the chosen plaintext is the real proof (u = rho^(n^s)),
+    // the other branches take the simulated proofs in order
+    int simulated = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (i == index)
+        {
+            mpz_set(branchU(encrProof, i), pre->u1);
+            continue;
+        }
 
-    // pick random v2 in Z*_n
-    do
-        mpz_urandomb(encrProof->v2, rand, pub->bits);
-    while( mpz_cmp(encrProof->v2, pub->n) >= 0 );
-
-    // compute u2 = v2^n * (g^m2 / c)^e2 mod n^2 = v2^n * g^(m2*e2) * c^(-e2) mod n^2
-    mpz_powm(u2, encrProof->v2, pub->n, pub->n_squared);
-    mpz_mul(gPower, m2, encrProof->e2);
-    mpz_powm(gPower, pub->n_plusone, gPower, pub->n_squared);
-    mpz_ui_sub(cPower, 0, encrProof->e2);
-    mpz_powm(cPower, encrProof->c, cPower, pub->n_squared);
-    mpz_mul(u2, u2, gPower);
-    mpz_mul(u2, u2, cPower);
-    mpz_mod(u2, u2, pub->n_squared);
-
-    // compute u1 = rho^n mod n^2
-    mpz_powm(u1, rho, pub->n, pub->n_squared);
-
-    // Commit to u1,u2 by hash: s = H(u1,u2,c,m1,m2)
+        mpz_set(branchE(encrProof, i), simulatedE(pre, simulated));
+        mpz_set(branchV(encrProof, i), simulatedV(pre, simulated));
+
+        // compute u = v^(n^s) * (g^mi / c)^e = v^(n^s) * rn^(-e) * g^((mi-m)*e) mod n^(s+1)
+        mpz_sub(gPower, plaintexts[i]->m, m);
+        mpz_mul(gPower, gPower, branchE(encrProof, i));
+        paillier_pow_g(gPower, gPower, pub);
+        mpz_mul(branchU(encrProof, i), simulatedU(pre, simulated), gPower);
+        mpz_mod(branchU(encrProof, i), branchU(encrProof, i), pub->n_s1);
+
+        simulated++;
+    }
+
+    // Commit to all u by hash: s = H(u1,...,uk,c,m1,...,mk)
     std::vector<__mpz_struct> vec;
-    if (index == PLAINTEXT_SELECTION::SECOND)
+    for (int i = 0; i < count; i++)
+        vec.push_back(branchU(encrProof, i)[0]);
+    vec.push_back(encrProof->c[0]);
+    for (int i = 0; i < count; i++)
+        vec.push_back(plaintexts[i]->m[0]);
+    paillier_challenge(encrProof->e, vec, version);
+
+    // only V3 and later publish the commitments
+    if (version < PAILLIER_PROOF_V3)
     {
-        vec.push_back(u2[0]);
-        vec.push_back(u1[0]);
-    } else {
-        vec.push_back(u1[0]);
-        vec.push_back(u2[0]);
+        for (int i = 0; i < count; i++)
+            mpz_set_ui(branchU(encrProof, i), 0);
+    }
+
+    // eNoMod = e - (sum of the simulated challenges)
+    mpz_set(eNoMod, encrProof->e);
+    for (int i = 0; i < count; i++)
+    {
+        if (i != index)
+            mpz_sub(eNoMod, eNoMod, branchE(encrProof, i));
     }
-    vec.push_back(encrProof->c[0]);
-    vec.push_back(pt->m[0]);
-    vec.push_back(pt2->m[0]);
-    uint256 hash = hashMultiple(vec);
-    mpz_set_str(encrProof->e, hash.GetHex().c_str(), 16);
 
-    // e1NoMod = e - e2
-    mpz_sub(e1NoMod, encrProof->e, encrProof->e2);
-    // e1 = e1NoMod mod n
-    mpz_mod(encrProof->e1, e1NoMod, pub->n);
+    // e of the real proof = eNoMod mod n
+    mpz_ptr eReal = branchE(encrProof, index);
+    mpz_mod(eReal, eNoMod, pub->n);
 
-    // v1 = rho * r^e1 * g^(e1NoMod / n) mod n
-    mpz_tdiv_q(encrProof->v1, e1NoMod, pub->n);
-    mpz_powm(encrProof->v1, pub->n_plusone, encrProof->v1, pub->n);
-    mpz_powm(rPower, r, encrProof->e1, pub->n);
-    mpz_mul(encrProof->v1, encrProof->v1, rPower);
-    mpz_mul(encrProof->v1, encrProof->v1, rho);
-    mpz_mod(encrProof->v1, encrProof->v1, pub->n);
+    // v = rho * r^e * g^(eNoMod / n) mod n = rho * r^e mod n
+    // (as g = n+1 = 1 mod n, and v^(n^s) mod n^(s+1) only depends on v mod n)
+    mpz_powm(rPower, pre->r, eReal, pub->n);
+    mpz_mul(branchV(encrProof, index), rPower, pre->rho);
+    mpz_mod(branchV(encrProof, index), branchV(encrProof, index), pub->n);
 
 
     // --- Finish ---
 
     // Clear temporaray variables
-    mpz_clear(r);
-    mpz_clear(rho);
-    mpz_clear(u1);
-    mpz_clear(u2);
     mpz_clear(gPower);
-    mpz_clear(cPower);
-    mpz_clear(e1NoMod);
+    mpz_clear(eNoMod);
     mpz_clear(rPower);
 
-    // Publish (c, s, e1, v1, e2, v2)
-    if (index == PLAINTEXT_SELECTION::SECOND)
-    {
-        mpz_swap(encrProof->e1, encrProof->e2);
-        mpz_swap(encrProof->v1, encrProof->v2);
-    }
+    // Publish (c, s, e1, v1, ..., ek, vk)
     return encrProof;
 }
 
+// sameCommitment checks a published commitment (PAILLIER_PROOF_V3) against
+// the recomputed one. They may differ by a factor of order 2, which is an
+// n^s-th residue (as p and q are safe primes), so the proven statement stays
+// the same. Tolerating it makes the result equal to the batch verification,
+// which cannot detect such factors.
+static bool
+sameCommitment(const mpz_t computed, const mpz_t published, paillier_pubkey_t *pub)
+{
+    if (mpz_sgn(published) <= 0 || mpz_cmp(published, pub->n_s1) >= 0)
+        return false;
+
+    mpz_t a, b;
+    mpz_init(a);
+    mpz_init(b);
+
+    mpz_mul(a, computed, computed);
+    mpz_mod(a, a, pub->n_s1);
+    mpz_mul(b, published, published);
+    mpz_mod(b, b, pub->n_s1);
+    bool result = mpz_cmp(a, b) == 0;
+
+    mpz_clear(a);
+    mpz_clear(b);
+
+    return result;
+}
+
 bool paillier_verify_enc(paillier_pubkey_t *pub,
                          paillier_ciphertext_proof_t *encrProof)
 {
@@ -527,68 +770,83 @@ bool paillier_verify_enc(paillier_pubkey_t *pub,
                          paillier_plaintext_t* pt1,
                          paillier_plaintext_t* pt2)
 {
+    paillier_plaintext_t *plaintexts[] = { pt1, pt2 };
+    return paillier_verify_enc(pub, encrProof, plaintexts, 2);
+}
+
+bool paillier_verify_enc(paillier_pubkey_t *pub,
+                         paillier_ciphertext_proof_t *encrProof,
+                         paillier_plaintext_t **plaintexts,
+                         int count)
+{
+    // the proof has to cover exactly the given plaintexts
+    // (more than two only exist since PAILLIER_PROOF_V5)
+    if (encrProof->count != count || (count > 2 && encrProof->version < PAILLIER_PROOF_V5))
+        return false;
+
     // --- Init ---
 
-    mpz_t u1;
-    mpz_t gPower1;
-    mpz_t cPower1;
-    mpz_t u2;
-    mpz_t gPower2;
-    mpz_t cPower2;
+    std::vector<mpz_wrapper> u(count);
+    mpz_t gPower;
+    mpz_t cInverse;
     mpz_t e;
     mpz_t temp;
 
-    mpz_init(u1);
-    mpz_init(gPower1);
-    mpz_init(cPower1);
-    mpz_init(u2);
-    mpz_init(gPower2);
-    mpz_init(cPower2);
+    for (int i = 0; i < count; i++)
+        mpz_init(u[i].value);
+    mpz_init(gPower);
+    mpz_init(cInverse);
     mpz_init(e);
     mpz_init(temp);
 
     // --- Pre-compute ---
 
-    // compute u1 = v1^n * (g^pt1 / c)^e1 mod n^2 = v1^n * g^(pt1*e1) * c^(-e1) mod n^2
-    mpz_powm(u1, encrProof->v1, pub->n, pub->n_squared);
-    mpz_mul(gPower1, pt1->m, encrProof->e1);
-    mpz_powm(gPower1, pub->n_plusone, gPower1, pub->n_squared);
-    mpz_ui_sub(cPower1, 0, encrProof->e1);
-    mpz_powm(cPower1, encrProof->c, cPower1, pub->n_squared);
-    mpz_mul(u1, u1, gPower1);
-    mpz_mul(u1, u1, cPower1);
-    mpz_mod(u1, u1, pub->n_squared);
-
-    // compute u2 = v2^n * (g^pt2 / c)^e2 mod n^2 = v2^n * g^(pt2*e2) * c^(-e2) mod n^2
-    mpz_powm(u2, encrProof->v2, pub->n, pub->n_squared);
-    mpz_mul(gPower2, pt2->m, encrProof->e2);
-    mpz_powm(gPower2, pub->n_plusone, gPower2, pub->n_squared);
-    mpz_ui_sub(cPower2, 0, encrProof->e2);
-    mpz_powm(cPower2, encrProof->c, cPower2, pub->n_squared);
-    mpz_mul(u2, u2, gPower2);
-    mpz_mul(u2, u2, cPower2);
-    mpz_mod(u2, u2, pub->n_squared);
-
-    // Rebuild hash: s = H(u1,u2,c,pt,pt2)
+    // c^(-1) mod n^(s+1) is shared by all u (does not exist for invalid c)
+    bool valid = mpz_invert(cInverse, encrProof->c, pub->n_s1) != 0;
+
+    mpz_set_ui(temp, 0);
+    for (int i = 0; i < count; i++)
+    {
+        mpz_ptr ei = branchE(encrProof, i);
+
+        // compute ui = vi^(n^s) * (g^mi / c)^ei = vi^(n^s) * g^(mi*ei) * c^(-ei) mod n^(s+1)
+        valid &= paillier_powm2(u[i].value, branchV(encrProof, i), pub->n_s, cInverse, ei, pub->n_s1);
+        mpz_mul(gPower, plaintexts[i]->m, ei);
+        paillier_pow_g(gPower, gPower, pub);
+        mpz_mul(u[i].value, u[i].value, gPower);
+        mpz_mod(u[i].value, u[i].value, pub->n_s1);
+
+        // the published commitments are hashed, they have to match
+        // the recomputed ones (see sameCommitment)
+        if (encrProof->version >= PAILLIER_PROOF_V3)
+            valid &= sameCommitment(u[i].value, branchU(encrProof, i), pub);
+
+        mpz_add(temp, temp, ei);
+    }
+
+    // Rebuild hash: s = H(u1,...,uk,c,m1,...,mk)
     std::vector<__mpz_struct> vec;
-    vec.push_back(u1[0]);
-    vec.push_back(u2[0]);
+    for (int i = 0; i < count; i++)
+    {
+        if (encrProof->version >= PAILLIER_PROOF_V3)
+            vec.push_back(branchU(encrProof, i)[0]);
+        else
+            vec.push_back(u[i].value[0]);
+    }
     vec.push_back(encrProof->c[0]);
-    vec.push_back(pt1->m[0]);
-    vec.push_back(pt2->m[0]);
-    uint256 hash = hashMultiple(vec);
-    mpz_set_str(e, hash.GetHex().c_str(), 16);
+    for (int i = 0; i < count; i++)
+        vec.push_back(plaintexts[i]->m[0]);
 
 
     // --- Verify ---
 
-    bool result = true;
+    // Unknown proof format
+    bool result = valid && paillier_challenge(e, vec, encrProof->version);
 
     // Verify hash
     result &= mpz_cmp(e, encrProof->e) == 0;
 
-    // Verify s
-    mpz_add(temp, encrProof->e1, encrProof->e2);
+    // Verify s = e1 + ... + ek mod n
     mpz_mod(temp, temp, pub->n);
     mpz_mod(e, e, pub->n);
     result &= mpz_cmp(e, temp) == 0;
@@ -596,18 +854,251 @@ bool paillier_verify_enc(paillier_pubkey_t *pub,
 
     // --- Clear temporary variables ---
 
-    mpz_clear(u1);
-    mpz_clear(gPower1);
-    mpz_clear(cPower1);
-    mpz_clear(u2);
-    mpz_clear(gPower2);
-    mpz_clear(cPower2);
+    for (int i = 0; i < count; i++)
+        mpz_clear(u[i].value);
+    mpz_clear(gPower);
+    mpz_clear(cInverse);
     mpz_clear(e);
     mpz_clear(temp);
 
     return result;
 }
 
+// number of proofs combined into one check of paillier_verify_enc_batch
+// (bounds the memory of the tables and the work lost if a check fails)
+#define PAILLIER_BATCH_SIZE 128
+
+// bits of the random exponents of paillier_verify_enc_batch, a batch
+// containing an invalid proof passes with probability 2^-BITS at most
+#define PAILLIER_BATCH_EXPONENT_BITS 64
+
+// checks the proofs[0..count) of PAILLIER_PROOF_V3 with one branch per
+// plaintext together (see header), returns false if one of them might be
+// invalid
+static bool
+verifyEncCombined(paillier_pubkey_t *pub,
+                  paillier_ciphertext_proof_t **proofs,
+                  int count,
+                  paillier_plaintext_t **plaintexts,
+                  int branches,
+                  gmp_randstate_t rand)
+{
+    std::vector<mpz_wrapper> deltas(branches * count);
+    std::vector<mpz_wrapper> cExps(count);
+    std::vector<mpz_srcptr> vBases(branches * count);
+    std::vector<mpz_srcptr> uBases(branches * count);
+    std::vector<mpz_srcptr> cBases(count);
+    std::vector<mpz_srcptr> smallExps(branches * count);
+    std::vector<mpz_srcptr> bigExps(count);
+
+    mpz_t e, temp, units, gExp, left, right;
+    mpz_inits(e, temp, units, gExp, left, right, NULL);
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < branches; j++)
+            mpz_init(deltas[branches * i + j].value);
+        mpz_init(cExps[i].value);
+    }
+
+    // --- Check each proof (without exponentiations) ---
+
+    bool valid = true;
+    mpz_set_ui(units, 1);
+    for (int i = 0; i < count && valid; i++)
+    {
+        paillier_ciphertext_proof_t *proof = proofs[i];
+
+        // all values are in Z_{n^(s+1)} (their product has to be a unit)
+        std::vector<mpz_srcptr> values(1, proof->c);
+        for (int j = 0; j < branches; j++)
+        {
+            values.push_back(branchU(proof, j));
+            values.push_back(branchV(proof, j));
+        }
+        BOOST_FOREACH(mpz_srcptr value, values)
+        {
+            valid &= mpz_sgn(value) > 0 && mpz_cmp(value, pub->n_s1) < 0;
+            mpz_mul(units, units, value);
+            mpz_mod(units, units, pub->n);
+        }
+
+        // e = H(u1,...,uk,c,m1,...,mk) and e = e1 + ... + ek mod n
+        // (challenges are not negative, negative ones are verified one by one)
+        std::vector<__mpz_struct> vec;
+        for (int j = 0; j < branches; j++)
+            vec.push_back(branchU(proof, j)[0]);
+        vec.push_back(proof->c[0]);
+        for (int j = 0; j < branches; j++)
+            vec.push_back(plaintexts[j]->m[0]);
+        valid &= paillier_challenge(e, vec, proof->version);
+        valid &= mpz_cmp(e, proof->e) == 0;
+
+        mpz_neg(temp, e);
+        for (int j = 0; j < branches; j++)
+        {
+            valid &= mpz_sgn(branchE(proof, j)) >= 0;
+            mpz_add(temp, temp, branchE(proof, j));
+        }
+        valid &= mpz_divisible_p(temp, pub->n) != 0;
+    }
+
+    // only the units form a group, in which the combined check is sound
+    mpz_gcd(temp, units, pub->n);
+    valid &= mpz_cmp_ui(temp, 1) == 0;
+
+    // --- Check all equations at once ---
+
+    // with random dj per branch j of every proof:
+    // (prod vj^dj)^(n^s) * g^(sum dj*mj*ej)
+    //     = prod uj^dj * prod c^(sum dj*ej) mod n^(s+1)
+    if (valid)
+    {
+        mpz_set_ui(gExp, 0);
+        for (int i = 0; i < count; i++)
+        {
+            paillier_ciphertext_proof_t *proof = proofs[i];
+
+            mpz_set_ui(cExps[i].value, 0);
+            for (int j = 0; j < branches; j++)
+            {
+                mpz_ptr d = deltas[branches * i + j].value;
+                mpz_urandomb(d, rand, PAILLIER_BATCH_EXPONENT_BITS);
+
+                vBases[branches * i + j] = branchV(proof, j);
+                uBases[branches * i + j] = branchU(proof, j);
+                smallExps[branches * i + j] = d;
+
+                mpz_mul(temp, d, branchE(proof, j));
+                mpz_add(cExps[i].value, cExps[i].value, temp);
+                mpz_addmul(gExp, temp, plaintexts[j]->m);
+            }
+
+            cBases[i] = proof->c;
+            bigExps[i] = cExps[i].value;
+        }
+
+        paillier_powm_multi(left, &vBases[0], &smallExps[0], branches * count, pub->n_s1);
+        mpz_powm(left, left, pub->n_s, pub->n_s1);
+        paillier_pow_g(temp, gExp, pub);
+        mpz_mul(left, left, temp);
+        mpz_mod(left, left, pub->n_s1);
+
+        paillier_powm_multi(right, &uBases[0], &smallExps[0], branches * count, pub->n_s1);
+        paillier_powm_multi(temp, &cBases[0], &bigExps[0], count, pub->n_s1);
+        mpz_mul(right, right, temp);
+        mpz_mod(right, right, pub->n_s1);
+
+        // factors of order 2 are tolerated (see sameCommitment)
+        mpz_powm_ui(left, left, 2, pub->n_s1);
+        mpz_powm_ui(right, right, 2, pub->n_s1);
+        valid = mpz_cmp(left, right) == 0;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < branches; j++)
+            mpz_clear(deltas[branches * i + j].value);
+        mpz_clear(cExps[i].value);
+    }
+    mpz_clears(e, temp, units, gExp, left, right, NULL);
+
+    return valid;
+}
+
+bool paillier_verify_enc_batch(paillier_pubkey_t *pub,
+                               paillier_ciphertext_proof_t **proofs,
+                               int count,
+                               bool *results,
+                               paillier_get_rand_t get_rand)
+{
+    paillier_plaintext_t *pt1 = paillier_plaintext_from_ui(0);
+    paillier_plaintext_t *pt2 = paillier_plaintext_from_ui(1);
+    bool out = paillier_verify_enc_batch(pub,
+                                         proofs,
+                                         count,
+                                         pt1,
+                                         pt2,
+                                         results,
+                                         get_rand);
+    paillier_freeplaintext(pt1);
+    paillier_freeplaintext(pt2);
+    return out;
+}
+
+bool paillier_verify_enc_batch(paillier_pubkey_t *pub,
+                               paillier_ciphertext_proof_t **proofs,
+                               int count,
+                               paillier_plaintext_t *pt1,
+                               paillier_plaintext_t *pt2,
+                               bool *results,
+                               paillier_get_rand_t get_rand)
+{
+    paillier_plaintext_t *plaintexts[] = { pt1, pt2 };
+    return paillier_verify_enc_batch(pub, proofs, count, plaintexts, 2, results, get_rand);
+}
+
+bool paillier_verify_enc_batch(paillier_pubkey_t *pub,
+                               paillier_ciphertext_proof_t **proofs,
+                               int count,
+                               paillier_plaintext_t **plaintexts,
+                               int numPlaintexts,
+                               bool *results,
+                               paillier_get_rand_t get_rand)
+{
+    gmp_randstate_t rand;
+    init_rand(rand, get_rand, PAILLIER_BATCH_EXPONENT_BITS / 8 + 1);
+
+    // proofs with published commitments are combined, others checked one by one
+    std::vector<int> combinable;
+    bool result = true;
+    for (int i = 0; i < count; i++)
+    {
+        if (results)
+            results[i] = true;
+
+        if (proofs[i]->version >= PAILLIER_PROOF_V3 && proofs[i]->count == numPlaintexts &&
+                (numPlaintexts == 2 || proofs[i]->version >= PAILLIER_PROOF_V5))
+        {
+            combinable.push_back(i);
+            continue;
+        }
+
+        bool valid = paillier_verify_enc(pub, proofs[i], plaintexts, numPlaintexts);
+        if (results)
+            results[i] = valid;
+        result &= valid;
+    }
+
+    std::vector<paillier_ciphertext_proof_t*> batch;
+    for (unsigned int start = 0; start < combinable.size(); start += PAILLIER_BATCH_SIZE)
+    {
+        unsigned int end = std::min<unsigned int>(start + PAILLIER_BATCH_SIZE, combinable.size());
+
+        batch.clear();
+        for (unsigned int i = start; i < end; i++)
+            batch.push_back(proofs[combinable[i]]);
+
+        if (verifyEncCombined(pub, &batch[0], batch.size(), plaintexts, numPlaintexts, rand))
+            continue;
+
+        // the individual verification decides (and finds the invalid proofs)
+        for (unsigned int i = start; i < end && (result || results); i++)
+        {
+            bool valid = paillier_verify_enc(pub, proofs[combinable[i]], plaintexts, numPlaintexts);
+            if (results)
+                results[combinable[i]] = valid;
+            result &= valid;
+        }
+
+        if (!result && !results)
+            break;
+    }
+
+    gmp_randclear(rand);
+
+    return result;
+}
+
 paillier_partialdecryption_proof_t*
 paillier_dec( paillier_partialdecryption_proof_t* res,
                             paillier_pubkey_t* pub,
@@ -632,7 +1123,7 @@ paillier_dec( paillier_partialdecryption_proof_t* res,
 
     mpz_mul(exp, pub->delta, prv->s);
     mpz_mul_ui(exp, exp, 2);
-    mpz_powm(res->decryption, ct->c, exp, pub->n_squared);
+    mpz_powm(res->decryption, ct->c, exp, pub->n_s1);
 
 
     /* clear temporary integers */
@@ -647,13 +1138,16 @@ paillier_dec_proof( paillier_pubkey_t* pub,
                     paillier_partialkey_t* prv,
                     paillier_ciphertext_pure_t* ct,
                     paillier_get_rand_t get_rand,
-                    const char* r_hex )
+                    const char* r_hex,
+                    int version )
 {
     mpz_t r;
     mpz_t a;
     mpz_t b;
     gmp_randstate_t rand;
 
+    assert(version >= PAILLIER_PROOF_V1 && version <= PAILLIER_PROOF_V5);
+
     paillier_partialdecryption_proof_t* partDecrProof;
     partDecrProof = (paillier_partialdecryption_proof_t*) malloc(sizeof(paillier_partialdecryption_proof_t));
 
@@ -663,8 +1157,9 @@ paillier_dec_proof( paillier_pubkey_t* pub,
         mpz_init(r);
         init_rand(rand, get_rand, pub->bits / 8 + 1);
 
+        // r has to hide e*si*delta, where si < n^s*m
         int hashLength = 256;
-        mpz_urandomb(r, rand, 3*pub->bits + hashLength);
+        mpz_urandomb(r, rand, (pub->s + 2)*pub->bits + hashLength);
     }
     mpz_init(a);
     mpz_init(b);
@@ -672,23 +1167,32 @@ paillier_dec_proof( paillier_pubkey_t* pub,
     mpz_init(partDecrProof->ci2);
     mpz_init(partDecrProof->e);
     mpz_init(partDecrProof->z);
+    mpz_init(partDecrProof->a);
+    mpz_init(partDecrProof->b);
     mpz_init(partDecrProof->decryption);
+    partDecrProof->version = version;
 
     // c4 = c^4 mod n^(s+1)
-    mpz_powm_ui(partDecrProof->c4, ct->c, 4, pub->n_squared);
+    mpz_powm_ui(partDecrProof->c4, ct->c, 4, pub->n_s1);
     // a = c^4r mod n^(s+1)
-    mpz_powm(a, partDecrProof->c4, r, pub->n_squared);
+    mpz_powm(a, partDecrProof->c4, r, pub->n_s1);
     // b = v^r mod n^(s+1)
-    mpz_powm(b, pub->v, r, pub->n_squared);
+    paillier_powm_fixed(b, pub->v, r, pub->n_s1);
 
     // partial-decrypt ciphertext (ci = c^(2*Delta*si))
     paillier_dec(partDecrProof, pub, prv, ct);
     // ci^2 mod n^(s+1)
-    mpz_powm_ui(partDecrProof->ci2, partDecrProof->decryption, 2, pub->n_squared);
+    mpz_powm_ui(partDecrProof->ci2, partDecrProof->decryption, 2, pub->n_s1);
 
     // hash: H(a,b,c4,ci2)
-    uint256 hash = hash4(a, b, partDecrProof->c4, partDecrProof->ci2);
-    mpz_set_str(partDecrProof->e, hash.GetHex().c_str(), 16);
+    challenge4(partDecrProof->e, a, b, partDecrProof->c4, partDecrProof->ci2, version);
+
+    // publish the commitments (allows batch verification)
+    if (version >= PAILLIER_PROOF_V4)
+    {
+        mpz_set(partDecrProof->a, a);
+        mpz_set(partDecrProof->b, b);
+    }
     // z = r + e*si*delta
     mpz_mul(partDecrProof->z, prv->s, partDecrProof->e);
     mpz_mul(partDecrProof->z, partDecrProof->z, pub->delta);
@@ -708,42 +1212,264 @@ bool
 paillier_verify_decryption( paillier_pubkey_t* pub,
                             paillier_partialdecryption_proof_t* dec_proof )
 {
+    // unknown decryption-server
+    if (dec_proof->id < 1 || dec_proof->id > pub->decryptServers)
+        return false;
+
     mpz_t a;
     mpz_t b;
     mpz_t e;
     mpz_t temp;
+    mpz_t vie;
 
     mpz_init(a);
     mpz_init(b);
     mpz_init(e);
     mpz_init(temp);
+    mpz_init(vie);
+
+    // the proof is about ci2, which has to belong to the published decryption
+    mpz_mul(temp, dec_proof->decryption, dec_proof->decryption);
+    mpz_mod(temp, temp, pub->n_s1);
+    bool result = mpz_cmp(temp, dec_proof->ci2) == 0;
+
+    mpz_neg(temp, dec_proof->e);
 
     // tries to compute the original a = c^4z * ci^(2*-e)
-    mpz_powm(a, dec_proof->c4, dec_proof->z, pub->n_squared);
-    mpz_ui_sub(temp, 0, dec_proof->e);
-    mpz_powm(temp, dec_proof->ci2, temp, pub->n_squared);
-    mpz_mul(a, a, temp);
-    mpz_mod(a, a, pub->n_squared);
+    result &= paillier_powm2(a, dec_proof->c4, dec_proof->z, dec_proof->ci2, temp, pub->n_s1);
 
     // tries to compute the original b = v^z * vi^(-e)
-    mpz_powm(b, pub->v, dec_proof->z, pub->n_squared);
-    mpz_ui_sub(temp, 0, dec_proof->e);
-    mpz_powm(temp, pub->verificationKeys[dec_proof->id - 1]->v, temp, pub->n_squared);
-    mpz_mul(b, b, temp);
-    mpz_mod(b, b, pub->n_squared);
+    // (both bases are fixed for the key, see paillier_powm_fixed)
+    result &= paillier_powm_fixed(b, pub->v, dec_proof->z, pub->n_s1);
+    result &= paillier_powm_fixed(vie, pub->verificationKeys[dec_proof->id - 1]->v, temp, pub->n_s1);
+    mpz_mul(b, b, vie);
+    mpz_mod(b, b, pub->n_s1);
+
+    // the published commitments are hashed, they have to match
+    // the recomputed ones (see sameCommitment)
+    if (dec_proof->version >= PAILLIER_PROOF_V4)
+    {
+        result &= sameCommitment(a, dec_proof->a, pub);
+        result &= sameCommitment(b, dec_proof->b, pub);
+        mpz_set(a, dec_proof->a);
+        mpz_set(b, dec_proof->b);
+    }
 
     // tries to rehash the value H(a, b, c^4, ci2)
-    uint256 hash = hash4(a, b, dec_proof->c4, dec_proof->ci2);
-    mpz_set_str(e, hash.GetHex().c_str(), 16);
+    result = result && challenge4(e, a, b, dec_proof->c4, dec_proof->ci2, dec_proof->version);
 
     // see if the original hash is equal to the guessed hash
-    bool result = mpz_cmp(e, dec_proof->e) == 0;
+    result = result && mpz_cmp(e, dec_proof->e) == 0;
 
     // clear temporary variables
     mpz_clear(a);
     mpz_clear(b);
     mpz_clear(e);
     mpz_clear(temp);
+    mpz_clear(vie);
+
+    return result;
+}
+
+// checks the proofs[0..count) of PAILLIER_PROOF_V4 by the same
+// decryption-server together (see header), returns false if one of them
+// might be invalid
+static bool
+verifyDecCombined(paillier_pubkey_t *pub,
+                  paillier_partialdecryption_proof_t **proofs,
+                  int count,
+                  gmp_randstate_t rand)
+{
+    std::vector<mpz_wrapper> deltas(2 * count);
+    std::vector<mpz_wrapper> zExps(count);
+    std::vector<mpz_wrapper> eExps(count);
+    std::vector<mpz_srcptr> c4Bases(count);
+    std::vector<mpz_srcptr> ci2Bases(count);
+    std::vector<mpz_srcptr> aBases(count);
+    std::vector<mpz_srcptr> bBases(count);
+    std::vector<mpz_srcptr> aExps(count);
+    std::vector<mpz_srcptr> bExps(count);
+    std::vector<mpz_srcptr> zPtrs(count);
+    std::vector<mpz_srcptr> ePtrs(count);
+
+    mpz_t e, temp, units, vExp, viExp, left, right;
+    mpz_inits(e, temp, units, vExp, viExp, left, right, NULL);
+    for (int i = 0; i < count; i++)
+    {
+        mpz_init(deltas[2 * i].value);
+        mpz_init(deltas[2 * i + 1].value);
+        mpz_init(zExps[i].value);
+        mpz_init(eExps[i].value);
+    }
+
+    // --- Check each proof (without exponentiations) ---
+
+    int id = proofs[0]->id;
+    bool valid = id >= 1 && id <= pub->decryptServers;
+    mpz_set_ui(units, 1);
+    for (int i = 0; i < count && valid; i++)
+    {
+        paillier_partialdecryption_proof_t *proof = proofs[i];
+        valid &= proof->id == id;
+
+        // all values are in Z_{n^(s+1)} (their product has to be a unit)
+        mpz_srcptr values[] = { proof->c4, proof->ci2, proof->a, proof->b };
+        BOOST_FOREACH(mpz_srcptr value, values)
+        {
+            valid &= mpz_sgn(value) > 0 && mpz_cmp(value, pub->n_s1) < 0;
+            mpz_mul(units, units, value);
+            mpz_mod(units, units, pub->n);
+        }
+
+        // exponents are not negative (negative ones are verified one by one)
+        valid &= mpz_sgn(proof->z) >= 0 && mpz_sgn(proof->e) >= 0;
+
+        // the proven ci2 belongs to the published decryption
+        mpz_mul(temp, proof->decryption, proof->decryption);
+        mpz_mod(temp, temp, pub->n_s1);
+        valid &= mpz_cmp(temp, proof->ci2) == 0;
+
+        // e = H(a,b,c4,ci2)
+        valid &= challenge4(e, proof->a, proof->b, proof->c4, proof->ci2, proof->version);
+        valid &= mpz_cmp(e, proof->e) == 0;
+    }
+
+    // only the units form a group, in which the combined check is sound
+    mpz_gcd(temp, units, pub->n);
+    valid &= mpz_cmp_ui(temp, 1) == 0;
+
+    // --- Check all equations at once ---
+
+    // with random d1, d2 per proof:
+    // prod c4^(d1*z) = prod a^d1 * prod ci2^(d1*e) mod n^(s+1)
+    // v^(sum d2*z) = prod b^d2 * vi^(sum d2*e) mod n^(s+1)
+    if (valid)
+    {
+        mpz_set_ui(vExp, 0);
+        mpz_set_ui(viExp, 0);
+        for (int i = 0; i < count; i++)
+        {
+            paillier_partialdecryption_proof_t *proof = proofs[i];
+            mpz_ptr d1 = deltas[2 * i].value;
+            mpz_ptr d2 = deltas[2 * i + 1].value;
+            mpz_urandomb(d1, rand, PAILLIER_BATCH_EXPONENT_BITS);
+            mpz_urandomb(d2, rand, PAILLIER_BATCH_EXPONENT_BITS);
+
+            mpz_mul(zExps[i].value, d1, proof->z);
+            mpz_mul(eExps[i].value, d1, proof->e);
+            mpz_addmul(vExp, d2, proof->z);
+            mpz_addmul(viExp, d2, proof->e);
+
+            c4Bases[i] = proof->c4;
+            ci2Bases[i] = proof->ci2;
+            aBases[i] = proof->a;
+            bBases[i] = proof->b;
+            aExps[i] = d1;
+            bExps[i] = d2;
+            zPtrs[i] = zExps[i].value;
+            ePtrs[i] = eExps[i].value;
+        }
+
+        paillier_powm_multi(left, &c4Bases[0], &zPtrs[0], count, pub->n_s1);
+        paillier_powm_multi(right, &aBases[0], &aExps[0], count, pub->n_s1);
+        paillier_powm_multi(temp, &ci2Bases[0], &ePtrs[0], count, pub->n_s1);
+        mpz_mul(right, right, temp);
+        mpz_mod(right, right, pub->n_s1);
+
+        // factors of order 2 are tolerated (see sameCommitment)
+        mpz_powm_ui(left, left, 2, pub->n_s1);
+        mpz_powm_ui(right, right, 2, pub->n_s1);
+        valid = mpz_cmp(left, right) == 0;
+    }
+
+    if (valid)
+    {
+        // both bases are fixed for the key (see paillier_powm_fixed)
+        paillier_powm_fixed(left, pub->v, vExp, pub->n_s1);
+        paillier_powm_multi(right, &bBases[0], &bExps[0], count, pub->n_s1);
+        paillier_powm_fixed(temp, pub->verificationKeys[id - 1]->v, viExp, pub->n_s1);
+        mpz_mul(right, right, temp);
+        mpz_mod(right, right, pub->n_s1);
+
+        mpz_powm_ui(left, left, 2, pub->n_s1);
+        mpz_powm_ui(right, right, 2, pub->n_s1);
+        valid = mpz_cmp(left, right) == 0;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        mpz_clear(deltas[2 * i].value);
+        mpz_clear(deltas[2 * i + 1].value);
+        mpz_clear(zExps[i].value);
+        mpz_clear(eExps[i].value);
+    }
+    mpz_clears(e, temp, units, vExp, viExp, left, right, NULL);
+
+    return valid;
+}
+
+bool
+paillier_verify_decryption_batch( paillier_pubkey_t* pub,
+                                  paillier_partialdecryption_proof_t** proofs,
+                                  int count,
+                                  bool* results,
+                                  paillier_get_rand_t get_rand )
+{
+    gmp_randstate_t rand;
+    init_rand(rand, get_rand, PAILLIER_BATCH_EXPONENT_BITS / 8 + 1);
+
+    // proofs with published commitments are combined per decryption-server,
+    // others checked one by one
+    std::map<int, std::vector<int>> combinable;
+    bool result = true;
+    for (int i = 0; i < count; i++)
+    {
+        if (results)
+            results[i] = true;
+
+        if (proofs[i]->version >= PAILLIER_PROOF_V4)
+        {
+            combinable[proofs[i]->id].push_back(i);
+            continue;
+        }
+
+        bool valid = paillier_verify_decryption(pub, proofs[i]);
+        if (results)
+            results[i] = valid;
+        result &= valid;
+    }
+
+    std::vector<paillier_partialdecryption_proof_t*> batch;
+    std::map<int, std::vector<int>>::iterator iter;
+    for (iter = combinable.begin(); iter != combinable.end() && (result || results); iter++)
+    {
+        std::vector<int> &indices = iter->second;
+        for (unsigned int start = 0; start < indices.size(); start += PAILLIER_BATCH_SIZE)
+        {
+            unsigned int end = std::min<unsigned int>(start + PAILLIER_BATCH_SIZE, indices.size());
+
+            batch.clear();
+            for (unsigned int i = start; i < end; i++)
+                batch.push_back(proofs[indices[i]]);
+
+            if (verifyDecCombined(pub, &batch[0], batch.size(), rand))
+                continue;
+
+            // the individual verification decides (and finds the invalid proofs)
+            for (unsigned int i = start; i < end && (result || results); i++)
+            {
+                bool valid = paillier_verify_decryption(pub, proofs[indices[i]]);
+                if (results)
+                    results[indices[i]] = valid;
+                result &= valid;
+            }
+
+            if (!result && !results)
+                break;
+        }
+    }
+
+    gmp_randclear(rand);
 
     return result;
 }
@@ -753,57 +1479,120 @@ paillier_combining( paillier_plaintext_t* res,
                             paillier_pubkey_t* pub,
                             paillier_partialdecryption_proof_t** partDecr)
 {
-    mpz_t cprime;
-    mpz_t divisor;
-    mpz_t lambda;
-    mpz_t exp;
-    mpz_t factor;
-    mpz_t L;
+    int* ids = (int*) malloc(sizeof(int) * pub->threshold);
+    for (int i = 0; i < pub->threshold; ++i)
+        ids[i] = partDecr[i]->id;
 
-    if( !res )
-    {
-        res = (paillier_plaintext_t*) malloc(sizeof(paillier_plaintext_t));
-        mpz_init(res->m);
-    }
+    paillier_combiner_t* combiner = paillier_create_combiner(pub, ids);
+    res = paillier_combining(res, pub, combiner, partDecr);
 
-    /* initialize our integers */
+    paillier_freecombiner(combiner);
+    free(ids);
 
-    mpz_init(cprime);
-    mpz_init(divisor);
-    mpz_init(lambda);
-    mpz_init(exp);
-    mpz_init(factor);
-    mpz_init(L);
+    return res;
+}
+
+paillier_combiner_t*
+paillier_create_combiner( paillier_pubkey_t* pub, int* ids )
+{
+    mpz_t numerator;
+    mpz_t denominator;
+
+    paillier_combiner_t* combiner = (paillier_combiner_t*) malloc(sizeof(paillier_combiner_t));
+    combiner->count = pub->threshold;
+    combiner->ids = (int*) malloc(sizeof(int) * combiner->count);
+    combiner->exps = (mpz_t*) malloc(sizeof(mpz_t) * combiner->count);
 
-    mpz_set_ui(cprime, 1);
-    for (int i = 0; i < pub->threshold; ++i) {
-        mpz_set(lambda, pub->delta);
+    mpz_init(numerator);
+    mpz_init(denominator);
 
-        for (int j = 0; j < pub->threshold; ++j) {
+    // lambda_i = delta * prod_{j!=i} -id_j / (id_i - id_j),
+    // which is an integer for delta = l!
+    for (int i = 0; i < combiner->count; ++i) {
+        combiner->ids[i] = ids[i];
+
+        mpz_set(numerator, pub->delta);
+        mpz_set_ui(denominator, 1);
+        for (int j = 0; j < combiner->count; ++j) {
             if (j != i)
             {
-                mpz_mul_si(lambda, lambda, -partDecr[j]->id);
-                mpz_set_si(divisor, partDecr[i]->id-partDecr[j]->id);
-                mpz_tdiv_q(lambda, lambda, divisor);
+                mpz_mul_si(numerator, numerator, -ids[j]);
+                mpz_mul_si(denominator, denominator, ids[i] - ids[j]);
             }
         }
-        mpz_mul_ui(exp, lambda, 2);
-        mpz_powm(factor, partDecr[i]->decryption, exp, pub->n_squared);
-        mpz_mul(cprime, cprime, factor);
-        mpz_mod(cprime, cprime, pub->n_squared);
+
+        mpz_init(combiner->exps[i]);
+        mpz_divexact(combiner->exps[i], numerator, denominator);
+        mpz_mul_ui(combiner->exps[i], combiner->exps[i], 2);
+    }
+
+    mpz_clear(numerator);
+    mpz_clear(denominator);
+
+    return combiner;
+}
+
+paillier_plaintext_t*
+paillier_combining( paillier_plaintext_t* res,
+                            paillier_pubkey_t* pub,
+                            paillier_combiner_t* combiner,
+                            paillier_partialdecryption_proof_t** partDecr)
+{
+    mpz_t cprime;
+    mpz_t L;
+
+    std::vector<mpz_wrapper> bases(combiner->count);
+    std::vector<mpz_wrapper> exps(combiner->count);
+    std::vector<mpz_srcptr> basePtrs(combiner->count);
+    std::vector<mpz_srcptr> expPtrs(combiner->count);
+
+    /* c_i^(2*lambda_i) = (c_i^-1)^(-2*lambda_i) for negative lambda_i */
+
+    bool invertible = true;
+    for (int i = 0; i < combiner->count; ++i) {
+        mpz_init(bases[i].value);
+        mpz_init(exps[i].value);
+
+        mpz_abs(exps[i].value, combiner->exps[i]);
+        if (mpz_sgn(combiner->exps[i]) < 0)
+            invertible &= mpz_invert(bases[i].value, partDecr[i]->decryption, pub->n_s1) != 0;
+        else
+            mpz_set(bases[i].value, partDecr[i]->decryption);
+
+        basePtrs[i] = bases[i].value;
+        expPtrs[i] = exps[i].value;
     }
 
-    mpz_sub_ui(L, cprime, 1);
-    mpz_div(L, L, pub->n);
-    mpz_mul(res->m, L, pub->combineSharesConstant);
-    mpz_mod(res->m, res->m, pub->n);
+    if (invertible)
+    {
+        if( !res )
+        {
+            res = (paillier_plaintext_t*) malloc(sizeof(paillier_plaintext_t));
+            mpz_init(res->m);
+        }
+
+        mpz_init(cprime);
+        mpz_init(L);
+
+        // c' = prod c_i^(2*lambda_i) mod n^(s+1) (one pass for all)
+        paillier_powm_multi(cprime, &basePtrs[0], &expPtrs[0], combiner->count, pub->n_s1);
+
+        // c' = g^(4*delta^2*m), so m = log_g(c') * (4*delta^2)^(-1) mod n^s
+        paillier_log_g(L, cprime, pub);
+        mpz_mul(res->m, L, pub->combineSharesConstant);
+        mpz_mod(res->m, res->m, pub->n_s);
+
+        mpz_clear(cprime);
+        mpz_clear(L);
+    }
+    else
+        res = NULL;
 
     /* clear temporary integers */
-    mpz_clear(cprime);
-    mpz_clear(lambda);
-    mpz_clear(exp);
-    mpz_clear(factor);
-    mpz_clear(L);
+    for (int i = 0; i < combiner->count; ++i) {
+        mpz_clear(bases[i].value);
+        mpz_clear(exps[i].value);
+    }
 
     return res;
 }
@@ -815,7 +1604,50 @@ paillier_mul( paillier_pubkey_t* pub,
                             paillier_ciphertext_pure_t* ct1 )
 {
     mpz_mul(res->c, ct0->c, ct1->c);
-    mpz_mod(res->c, res->c, pub->n_squared);
+    mpz_mod(res->c, res->c, pub->n_s1);
+}
+
+void
+paillier_div( paillier_pubkey_t* pub,
+                            paillier_ciphertext_pure_t* res,
+                            paillier_ciphertext_pure_t* ct0,
+                            paillier_ciphertext_pure_t* ct1 )
+{
+    mpz_t inverse;
+    mpz_init(inverse);
+
+    mpz_invert(inverse, ct1->c, pub->n_s1);
+    mpz_mul(res->c, ct0->c, inverse);
+    mpz_mod(res->c, res->c, pub->n_s1);
+
+    mpz_clear(inverse);
+}
+
+paillier_ciphertext_pure_t*
+paillier_pack( paillier_pubkey_t* pub,
+                            paillier_ciphertext_pure_t** ct,
+                            const unsigned int* digits,
+                            int count,
+                            unsigned long base )
+{
+    paillier_ciphertext_pure_t* res = paillier_create_enc_zero();
+
+    mpz_t shift;
+    mpz_init(shift);
+
+    /* Horner's scheme from the last ciphertext, which only
+       takes exponents of the size of one digit range each */
+    for (int i = count - 1; i >= 0; i--)
+    {
+        mpz_ui_pow_ui(shift, base, digits[i]);
+        mpz_powm(res->c, res->c, shift, pub->n_s1);
+        mpz_mul(res->c, res->c, ct[i]->c);
+        mpz_mod(res->c, res->c, pub->n_s1);
+    }
+
+    mpz_clear(shift);
+
+    return res;
 }
 
 void
@@ -824,7 +1656,7 @@ paillier_exp( paillier_pubkey_t* pub,
                             paillier_ciphertext_pure_t* ct,
                             paillier_plaintext_t* pt )
 {
-    mpz_powm(res->c, ct->c, pt->m, pub->n_squared);
+    mpz_powm(res->c, ct->c, pt->m, pub->n_s1);
 }
 
 paillier_plaintext_t*
@@ -926,6 +1758,16 @@ paillier_ciphertext_to_bytes( int len, paillier_ciphertext_pure_t* ct )
     return buf;
 }
 
+void
+paillier_freecombiner( paillier_combiner_t* combiner )
+{
+    for (int i = 0; i < combiner->count; ++i)
+        mpz_clear(combiner->exps[i]);
+    free(combiner->exps);
+    free(combiner->ids);
+    free(combiner);
+}
+
 void
 paillier_freepolynomialpoint( paillier_polynomial_point_t* p )
 {
@@ -948,14 +1790,76 @@ paillier_freepartdecryptionproof( paillier_partialdecryption_proof_t* pdp )
     mpz_clear(pdp->decryption);
     mpz_clear(pdp->e);
     mpz_clear(pdp->z);
+    mpz_clear(pdp->a);
+    mpz_clear(pdp->b);
     free(pdp);
 }
 
+paillier_pubkey_t*
+paillier_copypubkey( paillier_pubkey_t* pub )
+{
+    paillier_pubkey_t* copy = (paillier_pubkey_t*) malloc(sizeof(paillier_pubkey_t));
+
+    copy->bits = pub->bits;
+    copy->s = pub->s;
+    copy->decryptServers = pub->decryptServers;
+    copy->threshold = pub->threshold;
+    mpz_init_set(copy->n, pub->n);
+    mpz_init_set(copy->v, pub->v);
+    mpz_init(copy->n_s);
+    mpz_init(copy->n_s1);
+    mpz_init(copy->n_plusone);
+    mpz_init(copy->delta);
+    mpz_init(copy->combineSharesConstant);
+
+    copy->verificationKeys = (paillier_verificationkey_t**) malloc(sizeof(paillier_verificationkey_t*) * pub->decryptServers);
+    for (int i = 0; i < pub->decryptServers; ++i) {
+        copy->verificationKeys[i] = (paillier_verificationkey_t*) malloc(sizeof(paillier_verificationkey_t));
+        copy->verificationKeys[i]->id = pub->verificationKeys[i]->id;
+        mpz_init_set(copy->verificationKeys[i]->v, pub->verificationKeys[i]->v);
+    }
+
+    copy->complete();
+    return copy;
+}
+
+paillier_ciphertext_pure_t*
+paillier_copyciphertext( paillier_ciphertext_pure_t* ct )
+{
+    paillier_ciphertext_pure_t* copy = (paillier_ciphertext_pure_t*) malloc(sizeof(paillier_ciphertext_pure_t));
+    mpz_init_set(copy->c, ct->c);
+
+    return copy;
+}
+
+void
+paillier_freeencprecomputation( paillier_enc_precomputation_t* pre )
+{
+    mpz_clear(pre->r);
+    mpz_clear(pre->rho);
+    mpz_clear(pre->e2);
+    mpz_clear(pre->v2);
+    mpz_clear(pre->rn);
+    mpz_clear(pre->u1);
+    mpz_clear(pre->u2);
+    for (int j = 0; j < pre->count - 2; j++)
+    {
+        mpz_clear(pre->ek[j]);
+        mpz_clear(pre->vk[j]);
+        mpz_clear(pre->uk[j]);
+    }
+    free(pre->ek);
+    free(pre->vk);
+    free(pre->uk);
+    free(pre);
+}
+
 void
 paillier_freepubkey( paillier_pubkey_t* pub )
 {
     mpz_clear(pub->n);
-    mpz_clear(pub->n_squared);
+    mpz_clear(pub->n_s);
+    mpz_clear(pub->n_s1);
     mpz_clear(pub->n_plusone);
     mpz_clear(pub->delta);
     mpz_clear(pub->v);
@@ -1006,6 +1910,17 @@ paillier_freeciphertextproof( paillier_ciphertext_proof_t *ct)
     mpz_clear(ct->v1);
     mpz_clear(ct->e2);
     mpz_clear(ct->v2);
+    mpz_clear(ct->u1);
+    mpz_clear(ct->u2);
+    for (int i = 0; i < ct->count - 2; i++)
+    {
+        mpz_clear(ct->ek[i]);
+        mpz_clear(ct->vk[i]);
+        mpz_clear(ct->uk[i]);
+    }
+    free(ct->ek);
+    free(ct->vk);
+    free(ct->uk);
     free(ct);
 }
 
@@ -26,6 +26,7 @@
 #include <boost/serialization/string.hpp>
 #include <boost/serialization/version.hpp>
 #include <boost/serialization/split_member.hpp>
+#include <boost/archive/archive_exception.hpp>
 #include <boost/archive/text_oarchive.hpp>
 
 /*
@@ -65,6 +66,38 @@ enum PLAINTEXT_SELECTION
     SECOND
 };
 
+/*
+  Format of the Fiat-Shamir challenge of the zero-knowledge-proofs.
+  V1 hashes the concatenated hex strings of the values (see hashMultiple),
+  V2 hashes a binary transcript of the values (see hashTranscript).
+  V3 hashes like V2 (with its own version byte), but encryption proofs also
+  publish their commitments u1, u2, which allows to verify many proofs at
+  once (see paillier_verify_enc_batch).
+  V4 hashes like V3, but decryption proofs also publish their commitments
+  a, b (see paillier_verify_decryption_batch).
+  V5 hashes like V4, but encryption proofs may cover more than two
+  plaintexts (and encode their number of plaintexts).
+  New proofs are always created with PAILLIER_PROOF_CURRENT, proofs of
+  every known version can be verified.
+*/
+enum PAILLIER_PROOF_VERSION
+{
+    PAILLIER_PROOF_V1 = 1,
+    PAILLIER_PROOF_V2 = 2,
+    PAILLIER_PROOF_V3 = 3,
+    PAILLIER_PROOF_V4 = 4,
+    PAILLIER_PROOF_V5 = 5
+};
+
+#define PAILLIER_PROOF_CURRENT PAILLIER_PROOF_V5
+
+/*
+  Largest number of plaintexts an encryption proof may cover (see the
+  1-out-of-count paillier_enc_proof). Proofs received from others with
+  more (or less than two) plaintexts are rejected when they are loaded.
+*/
+#define PAILLIER_MAX_PLAINTEXTS 256
+
 typedef struct
 {
     mpz_t value;
@@ -111,18 +144,30 @@ typedef struct
     BOOST_SERIALIZATION_SPLIT_MEMBER()
 } paillier_verificationkey_t;
 
+/*
+  Largest s of the keys (see paillier_pubkey_t), larger keys received from
+  others are rejected when they are loaded.
+*/
+#define PAILLIER_MAX_S 16
+
 /*
     This represents a Paillier public key, which is basically just global properties,
     the modulus n and the verification value/keys.
     The other values are just stored to avoid recomputation.
+    Keys follow the generalization of Damgard and Jurik: plaintexts are in
+    Z_{n^s} and ciphertexts in Z*_{n^(s+1)}, so a ciphertext of (s+1) times
+    the size of n holds s times its size of plaintext. s = 1 is the original
+    Paillier scheme.
 */
 typedef struct
 {
     int bits;  /* e.g., 1024 */
+    int s;     /* plaintexts are in Z_{n^s} (1 for Paillier) */
     int decryptServers; /* number of authorities */
     int threshold; /* number of authorities necessary for decryption */
     mpz_t n;   /* public modulus n = p q */
-    mpz_t n_squared; /* cached to avoid recomputing */
+    mpz_t n_s;  /* n^s (plaintext modulus), cached to avoid recomputing */
+    mpz_t n_s1; /* n^(s+1) (ciphertext modulus), cached to avoid recomputing */
     mpz_t n_plusone; /* cached to avoid recomputing */
     mpz_t delta; /* cached to avoid recomputing */
     mpz_t combineSharesConstant; /* cached to avoid recomputing */
@@ -132,8 +177,9 @@ typedef struct
     // compute the 'other' values (the basic values must be set already)
     void complete()
     {
-        // n^2
-        mpz_mul(n_squared, n, n);
+        // n^s and n^(s+1)
+        mpz_pow_ui(n_s, n, s);
+        mpz_mul(n_s1, n_s, n);
         // n+1
         mpz_add_ui(n_plusone, n, 1);
         //delta = l!
@@ -141,7 +187,7 @@ typedef struct
         // combineSharesConstant = (4*delta^2)^(-1) mod n^s
         mpz_mul( combineSharesConstant, delta, delta);
         mpz_mul_ui( combineSharesConstant, combineSharesConstant, 4);
-        int errorCode = mpz_invert( combineSharesConstant, combineSharesConstant, n);
+        int errorCode = mpz_invert( combineSharesConstant, combineSharesConstant, n_s);
         if (errorCode == 0)
         {
             throw std::runtime_error("Inverse of 4*delta^2 mod n^s not found!");
@@ -160,9 +206,11 @@ typedef struct
         mpz_get_str(vChars, 16, v);
         std::string vStr(vChars);
 
-        if(version == 0)
+        if(version <= 1)
         {
             ar & bits;
+            if(version == 1)
+                ar & s;
             ar & decryptServers;
             ar & threshold;
             ar & nStr;
@@ -180,14 +228,26 @@ typedef struct
     {
         std::string nStr;
         std::string vStr;
-        mpz_init(n_squared);
+        mpz_init(n_s);
+        mpz_init(n_s1);
         mpz_init(n_plusone);
         mpz_init(delta);
         mpz_init(combineSharesConstant);
 
-        if(version == 0)
+        // keys before version 1 are Paillier keys
+        s = 1;
+
+        if(version <= 1)
         {
             ar & bits;
+            if(version == 1)
+                ar & s;
+
+            // s is received from others, n^s is computed below
+            if (s < 1 || s > PAILLIER_MAX_S)
+                throw boost::archive::archive_exception(boost::archive::archive_exception::other_exception,
+                                                        "invalid plaintext level of a public key");
+
             ar & decryptServers;
             ar & threshold;
             ar & nStr;
@@ -214,6 +274,9 @@ typedef struct
 
 } paillier_pubkey_t;
 
+// version 1: s (see paillier_pubkey_t)
+BOOST_CLASS_VERSION(paillier_pubkey_t, 1)
+
 /*
   Partial key for decryption-server with id 'id'.
 */
@@ -286,6 +349,13 @@ typedef struct : paillier_ciphertext_pure_t
     mpz_t v1;
     mpz_t e2;
     mpz_t v2;
+    mpz_t u1; /* commitments, only set for PAILLIER_PROOF_V3 (0 otherwise) */
+    mpz_t u2;
+    int version;
+    int count;  /* number of plaintexts (branches) the proof is about */
+    mpz_t* ek;  /* e, v and u of the branches after the second */
+    mpz_t* vk;  /* (count - 2 each, NULL for two plaintexts) */
+    mpz_t* uk;
 } paillier_ciphertext_proof_t;
 
 /*
@@ -300,8 +370,44 @@ typedef struct
     mpz_t ci2;
     mpz_t e;
     mpz_t z;
+    mpz_t a; /* commitments, only set since PAILLIER_PROOF_V4 (0 otherwise) */
+    mpz_t b;
+    int version;
 } paillier_partialdecryption_proof_t;
 
+/*
+  Everything of an encryption with ZKP (see paillier_enc_proof), which
+  neither depends on the plaintext nor on the challenge. It can be
+  computed in advance and is used for exactly one encryption.
+*/
+typedef struct
+{
+    mpz_t r;   /* blinding factor of the encryption */
+    mpz_t rho; /* randomness of the real proof */
+    mpz_t e2;  /* challenge of the simulated proof */
+    mpz_t v2;  /* response of the simulated proof */
+    mpz_t rn;  /* r^(n^s) mod n^(s+1) */
+    mpz_t u1;  /* rho^(n^s) mod n^(s+1) */
+    mpz_t u2;  /* v2^(n^s) * r^(-n^s*e2) mod n^(s+1) */
+    int count; /* number of plaintexts the proof will be about */
+    mpz_t* ek; /* e2, v2 and u2 of the further simulated proofs */
+    mpz_t* vk; /* (count - 2 each, NULL for two plaintexts) */
+    mpz_t* uk;
+} paillier_enc_precomputation_t;
+
+/*
+  Lagrange coefficients for combining the partial decryptions of one
+  subset of threshold trustees (see paillier_create_combiner). They only
+  depend on the ids of the trustees, so the same combiner works for all
+  questions decrypted by the same trustees.
+*/
+typedef struct
+{
+    int count;   /* number of trustees (= threshold) */
+    int* ids;    /* ids of the trustees */
+    mpz_t* exps; /* exponents 2*lambda_i of their partial decryptions */
+} paillier_combiner_t;
+
 /*
   Point of polynomial function (= evaluation of polynomial at X).
 */
@@ -331,12 +437,35 @@ typedef void (*paillier_get_rand_t) ( void* buf, int len );
   keys, and the given pointers will be set to point to the new
   paillier_pubkey_t and paillier_prvkey_t structures. The functions
   paillier_get_rand_devrandom and paillier_get_rand_devurandom may be
-  passed as the final argument.
+  passed as the get_rand argument. Plaintexts of the key are in Z_{n^s}
+  (see paillier_pubkey_t), s = 1 gives a Paillier key (at most
+  PAILLIER_MAX_S).
 */
 void paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
                       paillier_pubkey_t** pub,
                       paillier_partialkey_t*** partKeys,
-                      paillier_get_rand_t get_rand );
+                      paillier_get_rand_t get_rand,
+                      int s = 1 );
+
+/*
+  Callback for the progress of a key generation, which is called with
+  the number of safe primes found so far (of two) and the number of
+  candidates tested for them. Returning false cancels the key generation.
+  The data given to paillier_keygen is passed through.
+*/
+typedef bool (*paillier_keygen_progress_t) ( int primesFound, unsigned long tested, void* data );
+
+/*
+  Same as above, but reports the progress of the search for the primes
+  (which takes nearly all of the time) to the given callback. Returns
+  false, if the key generation was cancelled (nothing is allocated then).
+*/
+bool paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
+                      paillier_pubkey_t** pub,
+                      paillier_partialkey_t*** partKeys,
+                      paillier_get_rand_t get_rand,
+                      paillier_keygen_progress_t progress, void* data,
+                      int s = 1 );
 
  /*
      Encrypt the given plaintext with the given public key using
@@ -359,7 +488,8 @@ void paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
  paillier_ciphertext_proof_t *paillier_enc_proof(paillier_pubkey_t *pub,
                                            PLAINTEXT_SELECTION choice,
                                            paillier_get_rand_t get_rand,
-                                           const char *r_hex);
+                                           const char *r_hex,
+                                           int version = PAILLIER_PROOF_CURRENT);
 
  /*
      Encrypt the given plaintext with the given public key using
@@ -372,9 +502,62 @@ void paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
                                            paillier_plaintext_t *pt2,
                                            PLAINTEXT_SELECTION index,
                                            paillier_get_rand_t get_rand,
-                                           const char *r_hex);
+                                           const char *r_hex,
+                                           int version = PAILLIER_PROOF_CURRENT);
+
+ /*
+     Encrypt plaintexts[index] (one of count >= 2 plaintexts) and return
+     the result together with a 1-out-of-count zero-knowledge-proof, that
+     the encrypted plaintext was indeed one of the plaintexts. The proof
+     has one branch per plaintext, all but the one of index are simulated.
+     More than two plaintexts require PAILLIER_PROOF_V5.
+ */
+ paillier_ciphertext_proof_t *paillier_enc_proof(paillier_pubkey_t *pub,
+                                           paillier_plaintext_t **plaintexts,
+                                           int count,
+                                           int index,
+                                           paillier_get_rand_t get_rand,
+                                           const char *r_hex,
+                                           int version = PAILLIER_PROOF_CURRENT);
+
 
 
+ /*
+     Precomputes the expensive part of paillier_enc_proof (all modular
+     exponentiations mod n^(s+1)) using randomness from get_rand (or the
+     given blinding factor r_hex), for a proof about count plaintexts.
+ */
+ paillier_enc_precomputation_t *paillier_enc_precompute(paillier_pubkey_t *pub,
+                                                       paillier_get_rand_t get_rand,
+                                                       const char *r_hex,
+                                                       int count = 2);
+
+ /*
+     Same as paillier_enc_proof, but based on the given precomputation
+     (which must not be used again).
+ */
+ paillier_ciphertext_proof_t *paillier_enc_proof_precomputed(paillier_pubkey_t *pub,
+                                                           PLAINTEXT_SELECTION choice,
+                                                           paillier_enc_precomputation_t *pre,
+                                                           int version = PAILLIER_PROOF_CURRENT);
+
+ paillier_ciphertext_proof_t *paillier_enc_proof_precomputed(paillier_pubkey_t *pub,
+                                                           paillier_plaintext_t *pt,
+                                                           paillier_plaintext_t *pt2,
+                                                           PLAINTEXT_SELECTION index,
+                                                           paillier_enc_precomputation_t *pre,
+                                                           int version = PAILLIER_PROOF_CURRENT);
+
+ /*
+     Same as the 1-out-of-count paillier_enc_proof, the precomputation
+     has to be for count plaintexts.
+ */
+ paillier_ciphertext_proof_t *paillier_enc_proof_precomputed(paillier_pubkey_t *pub,
+                                                           paillier_plaintext_t **plaintexts,
+                                                           int count,
+                                                           int index,
+                                                           paillier_enc_precomputation_t *pre,
+                                                           int version = PAILLIER_PROOF_CURRENT);
 
  /*
      Verifies the ZKP that the encrypter encrpyted 0 or 1.
@@ -390,6 +573,57 @@ void paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
                           paillier_plaintext_t *pt1,
                           paillier_plaintext_t *pt2);
 
+ /*
+     Verifies the ZKP that the encrypter encrypted one of the count
+     plaintexts (the proof has to be about exactly these plaintexts).
+ */
+ bool paillier_verify_enc(paillier_pubkey_t *pub,
+                          paillier_ciphertext_proof_t *encrProof,
+                          paillier_plaintext_t **plaintexts,
+                          int count);
+
+ /*
+     Verifies the ZKPs of count encryptions of 0 or 1 at once and returns
+     true, if all of them are valid. If results is not null, results[i]
+     is set to the validity of proofs[i].
+ */
+ bool paillier_verify_enc_batch(paillier_pubkey_t *pub,
+                                paillier_ciphertext_proof_t **proofs,
+                                int count,
+                                bool *results,
+                                paillier_get_rand_t get_rand);
+
+ /*
+     Verifies the ZKPs of count encryptions of one of the possibleMessages
+     at once (see above).
+     Proofs of PAILLIER_PROOF_V3 are checked together, using the published
+     commitments: the equations v^(n^s) * g^(pt*e) = u * c^e of all proofs are
+     raised to small random exponents and multiplied, so that only a few
+     full-size exponentiations remain. If that check fails, the proofs are
+     verified one by one to find the invalid ones. Proofs of other versions
+     are always verified one by one.
+ */
+ bool paillier_verify_enc_batch(paillier_pubkey_t *pub,
+                                paillier_ciphertext_proof_t **proofs,
+                                int count,
+                                paillier_plaintext_t *pt1,
+                                paillier_plaintext_t *pt2,
+                                bool *results,
+                                paillier_get_rand_t get_rand);
+
+ /*
+     Verifies the ZKPs of count encryptions of one of the numPlaintexts
+     plaintexts at once (see above), the equations of all branches are
+     combined.
+ */
+ bool paillier_verify_enc_batch(paillier_pubkey_t *pub,
+                                paillier_ciphertext_proof_t **proofs,
+                                int count,
+                                paillier_plaintext_t **plaintexts,
+                                int numPlaintexts,
+                                bool *results,
+                                paillier_get_rand_t get_rand);
+
  /*
      Decrypt the given ciphertext with the given key pair. If res is not
      null, its contents will be overwritten with the result. Otherwise, a
@@ -409,7 +643,8 @@ void paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
                      paillier_partialkey_t* prv,
                      paillier_ciphertext_pure_t* ct,
                      paillier_get_rand_t get_rand,
-                     const char* r_hex );
+                     const char* r_hex,
+                     int version = PAILLIER_PROOF_CURRENT );
 
  /*
      Verifies the ZKP that the decryption-server used it's private key to create
@@ -418,6 +653,23 @@ void paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
  bool paillier_verify_decryption( paillier_pubkey_t* pub,
                              paillier_partialdecryption_proof_t* dec_proof );
 
+ /*
+     Verifies the ZKPs of count partial decryptions at once and returns
+     true, if all of them are valid. If results is not null, results[i]
+     is set to the validity of proofs[i].
+     Proofs of PAILLIER_PROOF_V4 by the same decryption-server are checked
+     together, using the published commitments: the equations
+     c4^z = a * ci2^e and v^z = b * vi^e of all proofs are raised to small
+     random exponents and multiplied, so that v and vi are only raised once.
+     If that check fails, the proofs are verified one by one to find the
+     invalid ones. Proofs of other versions are always verified one by one.
+ */
+ bool paillier_verify_decryption_batch( paillier_pubkey_t* pub,
+                             paillier_partialdecryption_proof_t** proofs,
+                             int count,
+                             bool* results,
+                             paillier_get_rand_t get_rand );
+
  /*
      Combines (at least) threshold partial decryptions. The result is the
      original plaintext.
@@ -427,6 +679,25 @@ void paillier_keygen( int modulusbits, int decryptServers, int thresholdServers,
                              paillier_pubkey_t* pub,
                              paillier_partialdecryption_proof_t** partDecr);
 
+ /*
+     Computes the Lagrange coefficients for the threshold trustees with
+     the given (distinct) ids.
+ */
+ paillier_combiner_t*
+ paillier_create_combiner( paillier_pubkey_t* pub, int* ids );
+
+ /*
+     Same as above, but with the coefficients of the given combiner, where
+     partDecr[i] has to be the partial decryption of trustee ids[i]. The
+     powers of all partial decryptions are computed at once. Returns NULL
+     (and leaves res unchanged), if a partial decryption is not invertible.
+ */
+ paillier_plaintext_t*
+ paillier_combining( paillier_plaintext_t* res,
+                             paillier_pubkey_t* pub,
+                             paillier_combiner_t* combiner,
+                             paillier_partialdecryption_proof_t** partDecr);
+
 /*****************************
  USE OF ADDITIVE HOMOMORPHISM
 *****************************/
@@ -444,7 +715,7 @@ void paillier_mul(paillier_pubkey_t* pub,
 /*
   Raise the given ciphertext to power pt and store the result in res,
   which is assumed to be already allocated. If ct is an encryption of
-  x, then res will become an encryption of x * pt mod n, where n is
+  x, then res will become an encryption of x * pt mod n^s, where n is
   the modulus in pub.
 */
 void paillier_exp(paillier_pubkey_t* pub,
@@ -452,6 +723,31 @@ void paillier_exp(paillier_pubkey_t* pub,
                                      paillier_ciphertext_pure_t *ct,
                                      paillier_plaintext_t* pt );
 
+/*
+  Divide ct0 by ct1 assuming the modulus in the given public key and
+  store the result in res (already allocated). If ct0 and ct1 are
+  encryptions of x0 and x1, res becomes an encryption of x0 - x1 mod n^s,
+  i.e. ct1 is removed from a product of ciphertexts.
+*/
+void paillier_div(paillier_pubkey_t* pub,
+                                     paillier_ciphertext_pure_t *res,
+                                     paillier_ciphertext_pure_t *ct0,
+                                     paillier_ciphertext_pure_t *ct1 );
+
+/*
+  Pack the given ciphertexts into one, i.e. the product of ct[i] raised
+  to base^(digits[0] + ... + digits[i-1]). If ct[i] is an encryption of
+  x_i, the result is an encryption of the number with x_i at digit
+  digits[0] + ... + digits[i-1] (to the given base), so that one
+  decryption yields all x_i as long as they do not overflow their
+  digits. The result has to be freed by the caller.
+*/
+paillier_ciphertext_pure_t* paillier_pack(paillier_pubkey_t* pub,
+                                          paillier_ciphertext_pure_t** ct,
+                                          const unsigned int* digits,
+                                          int count,
+                                          unsigned long base );
+
 /****************************
  PLAINTEXT IMPORT AND EXPORT
 ****************************/
@@ -502,6 +798,18 @@ void paillier_freeciphertextproof(paillier_ciphertext_proof_t *ct );
 void paillier_freeverificationkey( paillier_verificationkey_t* v );
 void paillier_freepartdecryptionproof( paillier_partialdecryption_proof_t* pdp );
 void paillier_freepolynomialpoint( paillier_polynomial_point_t* p );
+void paillier_freeencprecomputation( paillier_enc_precomputation_t* pre );
+void paillier_freecombiner( paillier_combiner_t* combiner );
+
+/*
+  Allocates a deep copy of the given public key.
+*/
+paillier_pubkey_t* paillier_copypubkey( paillier_pubkey_t* pub );
+
+/*
+  Allocates a copy of the given ciphertext (without proof).
+*/
+paillier_ciphertext_pure_t* paillier_copyciphertext( paillier_ciphertext_pure_t* ct );
 
 /***********
  MISC STUFF
@@ -523,6 +831,14 @@ void paillier_get_rand_devrandom(  void* buf, int len );
 void paillier_get_rand_devurandom( void* buf, int len );
 
 uint256 hashMultiple(std::vector<__mpz_struct> &in);
+uint256 hashTranscript(std::vector<__mpz_struct> &in, int version);
+
+/*
+    Computes the challenge e of a zero-knowledge-proof over the given
+    values, using the hash of the given proof version. Returns false
+    for unknown versions.
+*/
+bool paillier_challenge(mpz_t e, std::vector<__mpz_struct> &in, int version);
 
 
 /*
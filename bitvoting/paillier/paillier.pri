@@ -2,9 +2,13 @@ INCLUDEPATH  += $$PWD/
 
 SOURCES      += \
     $$PWD/paillier.cpp \
-    $$PWD/comparison.cpp
+    $$PWD/arithmetic.cpp \
+    $$PWD/comparison.cpp \
+    $$PWD/primes.cpp
 
 HEADERS      += \
     $$PWD/paillier.h \
+    $$PWD/arithmetic.h \
     $$PWD/serialization.h \
-    $$PWD/comparison.h
+    $$PWD/comparison.h \
+    $$PWD/primes.h
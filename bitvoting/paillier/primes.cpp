@@ -0,0 +1,238 @@
+#include "primes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+// number of small odd primes the candidates are sieved with
+#define PAILLIER_SIEVE_PRIMES 2048
+
+// number of candidates per sieved interval
+#define PAILLIER_SIEVE_SIZE 4096
+
+// rounds of Miller-Rabin for p1 (as for mpz_probab_prime_p)
+#define PAILLIER_PRIME_REPS 10
+
+// time between two progress reports (msec)
+#define PAILLIER_PROGRESS_INTERVAL 100
+
+// ================================================================
+
+// state shared by all threads of one search
+struct SafePrimeSearch
+{
+    mpz_t* p1;
+    mpz_t* p;
+    int count;
+    int bits;
+
+    // protects p1, p and found
+    boost::mutex mutex;
+    boost::condition_variable changed;
+    int found = 0;
+
+    // set, if enough primes are found or the search is cancelled
+    std::atomic<bool> stop;
+
+    // number of candidates tested so far (survivors of the sieve)
+    std::atomic<unsigned long> tested;
+
+    SafePrimeSearch() : stop(false), tested(0) {}
+};
+
+// ----------------------------------------------------------------
+
+// the first odd primes, computed once and shared by all searches
+static const std::vector<unsigned long>&
+sievePrimes()
+{
+    static const std::vector<unsigned long> primes = []()
+    {
+        std::vector<unsigned long> result;
+        for (unsigned long q = 3; result.size() < PAILLIER_SIEVE_PRIMES; q += 2)
+        {
+            bool prime = true;
+            for (unsigned int i = 0; i < result.size() && result[i] * result[i] <= q; i++)
+            {
+                if (q % result[i] == 0)
+                {
+                    prime = false;
+                    break;
+                }
+            }
+
+            if (prime)
+                result.push_back(q);
+        }
+        return result;
+    }();
+
+    return primes;
+}
+
+// ----------------------------------------------------------------
+
+// Fermat test to base 2 (temp is used as temporary)
+static bool
+isFermatPrime(const mpz_t n, mpz_t exp, mpz_t temp)
+{
+    mpz_sub_ui(exp, n, 1);
+    mpz_set_ui(temp, 2);
+    mpz_powm(temp, temp, exp, n);
+    return mpz_cmp_ui(temp, 1) == 0;
+}
+
+// ----------------------------------------------------------------
+
+// keeps a found safe prime, unless enough are found already
+// or it was found before
+static void
+addSafePrime(SafePrimeSearch *search, const mpz_t p1, const mpz_t p)
+{
+    boost::mutex::scoped_lock lock(search->mutex);
+
+    if (search->found >= search->count)
+        return;
+
+    for (int i = 0; i < search->found; i++)
+    {
+        if (mpz_cmp(search->p1[i], p1) == 0)
+            return;
+    }
+
+    mpz_set(search->p1[search->found], p1);
+    mpz_set(search->p[search->found], p);
+    search->found++;
+
+    if (search->found == search->count)
+        search->stop = true;
+
+    search->changed.notify_all();
+}
+
+// ----------------------------------------------------------------
+
+// searches safe primes in random intervals until the search is stopped,
+// runs in its own thread (with its own seed)
+static void
+searchSafePrimes(SafePrimeSearch *search, std::vector<unsigned char> seed)
+{
+    const std::vector<unsigned long> &primes = sievePrimes();
+
+    gmp_randstate_t rand;
+    mpz_t s, start, p1, p, exp, temp;
+    mpz_inits(s, start, p1, p, exp, temp, NULL);
+
+    gmp_randinit_default(rand);
+    mpz_import(s, seed.size(), 1, 1, 0, 0, seed.data());
+    gmp_randseed(rand, s);
+
+    // all candidates are at least 2^(bits-1) + 2^(bits-2), so no candidate
+    // is sieved out for being one of the small primes itself
+    unsigned int numPrimes = primes.size();
+    while (numPrimes > 0 && search->bits < 64 &&
+           primes[numPrimes - 1] >= (1ul << (search->bits - 2)))
+        numPrimes--;
+
+    std::vector<bool> sieve(PAILLIER_SIEVE_SIZE);
+    while (!search->stop)
+    {
+        // odd start with the upper two bits set,
+        // candidate k of the interval is p1 = start + 2k
+        mpz_urandomb(start, rand, search->bits);
+        mpz_setbit(start, search->bits - 1);
+        mpz_setbit(start, search->bits - 2);
+        mpz_setbit(start, 0);
+
+        std::fill(sieve.begin(), sieve.end(), false);
+        for (unsigned int i = 0; i < numPrimes; i++)
+        {
+            unsigned long q = primes[i];
+            unsigned long r = mpz_fdiv_ui(start, q);
+            unsigned long half = (q + 1) / 2; // inverse of 2 mod q
+
+            // q divides p1, if 2k = -r mod q,
+            // and q divides p = 2*p1 + 1, if 2k = (q-1)/2 - r mod q
+            unsigned long k0 = ((q - r) % q) * half % q;
+            unsigned long k1 = (((q - 1) / 2 + q - r) % q) * half % q;
+
+            for (unsigned long k = k0; k < PAILLIER_SIEVE_SIZE; k += q)
+                sieve[k] = true;
+            for (unsigned long k = k1; k < PAILLIER_SIEVE_SIZE; k += q)
+                sieve[k] = true;
+        }
+
+        for (unsigned int k = 0; k < PAILLIER_SIEVE_SIZE && !search->stop; k++)
+        {
+            if (sieve[k])
+                continue;
+
+            mpz_add_ui(p1, start, 2 * k);
+            if (mpz_sizeinbase(p1, 2) > (size_t) search->bits)
+                break;
+
+            search->tested++;
+
+            if (!isFermatPrime(p1, exp, temp))
+                continue;
+
+            mpz_mul_2exp(p, p1, 1);
+            mpz_add_ui(p, p, 1);
+            if (!isFermatPrime(p, exp, temp))
+                continue;
+
+            if (!mpz_probab_prime_p(p1, PAILLIER_PRIME_REPS))
+                continue;
+
+            addSafePrime(search, p1, p);
+        }
+    }
+
+    mpz_clears(s, start, p1, p, exp, temp, NULL);
+    gmp_randclear(rand);
+}
+
+// ================================================================
+
+bool
+paillier_gen_safe_primes(mpz_t* p1, mpz_t* p, int count, int bits,
+                         paillier_get_rand_t get_rand,
+                         paillier_keygen_progress_t progress, void* data)
+{
+    SafePrimeSearch search;
+    search.p1 = p1;
+    search.p = p;
+    search.count = count;
+    search.bits = bits;
+
+    // the calling thread only reports the progress
+    unsigned int numThreads = std::max(1u, boost::thread::hardware_concurrency());
+    boost::thread_group threads;
+    for (unsigned int i = 0; i < numThreads; i++)
+    {
+        std::vector<unsigned char> seed(bits / 8 + 1);
+        get_rand(seed.data(), seed.size());
+        threads.create_thread(boost::bind(&searchSafePrimes, &search, seed));
+    }
+
+    {
+        boost::mutex::scoped_lock lock(search.mutex);
+        while (search.found < count)
+        {
+            if (progress && !progress(search.found, search.tested, data))
+            {
+                search.stop = true;
+                break;
+            }
+
+            search.changed.timed_wait(lock, boost::posix_time::milliseconds(PAILLIER_PROGRESS_INTERVAL));
+        }
+    }
+
+    threads.join_all();
+
+    return search.found == count;
+}
@@ -0,0 +1,34 @@
+/*=============================================================================
+
+Search for the safe primes p = 2*p1 + 1 of a key (see paillier_keygen).
+
+All cores search at once, every thread in its own random intervals of odd
+candidates p1. An interval is first sieved with a table of small primes,
+shared by all threads: a candidate is dropped, if a small prime divides p1
+or p, i.e. if p1 mod q is 0 or (q-1)/2. Only the few survivors are tested
+for primality, p1 and p with a cheap Fermat test first and p1 with
+Miller-Rabin at last. Once p1 is prime, the Fermat test of p already proves
+p prime (Pocklington), so p needs no further rounds.
+As soon as enough primes are found, all threads stop at their next
+candidate.
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef PAILLIER_PRIMES_H
+#define PAILLIER_PRIMES_H
+
+#include "paillier.h"
+
+// ==========================================================================
+
+// Finds count distinct safe primes p[i] = 2*p1[i] + 1, where p1[i] has the
+// given number of bits (the upper two of them set, bits > 2). All p1[i]
+// and p[i] have to be initialized already.
+// The progress is reported to the given callback (if not NULL) from the
+// calling thread every PAILLIER_PROGRESS_INTERVAL msec, which cancels the
+// search by returning false. Returns false, if the search was cancelled.
+bool paillier_gen_safe_primes(mpz_t* p1, mpz_t* p, int count, int bits,
+                              paillier_get_rand_t get_rand,
+                              paillier_keygen_progress_t progress, void* data);
+
+#endif // PAILLIER_PRIMES_H
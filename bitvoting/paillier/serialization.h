@@ -13,8 +13,10 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #include <set>
 #include <vector>
 
+#include <boost/archive/archive_exception.hpp>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/split_free.hpp>
+#include <boost/serialization/version.hpp>
 
 // ==========================================================================
 
@@ -55,12 +57,39 @@ namespace serialization {
         a & str4;
         a & str5;
         a & str6;
+        a & t.version;
+
+        char hex7[mpz_sizeinbase(t.u1, 16) + 2];
+        mpz_get_str(hex7, 16, t.u1);
+        std::string str7(hex7);
+
+        char hex8[mpz_sizeinbase(t.u2, 16) + 2];
+        mpz_get_str(hex8, 16, t.u2);
+        std::string str8(hex8);
+
+        a & str7;
+        a & str8;
+
+        // further branches of a 1-out-of-k proof (e, v, u each)
+        a & t.count;
+        for (int i = 0; i < t.count - 2; i++)
+        {
+            mpz_srcptr values[] = { t.ek[i], t.vk[i], t.uk[i] };
+            for (int j = 0; j < 3; j++)
+            {
+                char hex[mpz_sizeinbase(values[j], 16) + 2];
+                mpz_get_str(hex, 16, values[j]);
+                std::string str(hex);
+
+                a & str;
+            }
+        }
     }
 
     // ----------------------------------------------------------------
 
     template<class Archive>
-    void load(Archive& a, paillier_ciphertext_proof_t& t, unsigned int)
+    void load(Archive& a, paillier_ciphertext_proof_t& t, unsigned int version)
     {
         std::string str1;
         std::string str2;
@@ -68,6 +97,8 @@ namespace serialization {
         std::string str4;
         std::string str5;
         std::string str6;
+        std::string str7("0");
+        std::string str8("0");
 
         a & str1;
         a & str2;
@@ -76,6 +107,45 @@ namespace serialization {
         a & str5;
         a & str6;
 
+        // proofs stored before the version was introduced
+        t.version = PAILLIER_PROOF_V1;
+        if (version > 0)
+            a & t.version;
+
+        // proofs stored before the commitments were introduced
+        if (version > 1)
+        {
+            a & str7;
+            a & str8;
+        }
+
+        // proofs stored before 1-out-of-k proofs were introduced,
+        // the number of branches is received from others
+        t.count = 2;
+        if (version > 2)
+            a & t.count;
+
+        if (t.count < 2 || t.count > PAILLIER_MAX_PLAINTEXTS)
+            throw boost::archive::archive_exception(boost::archive::archive_exception::other_exception,
+                                                    "invalid number of plaintexts of an encryption proof");
+
+        t.ek = t.vk = t.uk = NULL;
+        if (t.count > 2)
+        {
+            t.ek = (mpz_t*) malloc(sizeof(mpz_t) * (t.count - 2));
+            t.vk = (mpz_t*) malloc(sizeof(mpz_t) * (t.count - 2));
+            t.uk = (mpz_t*) malloc(sizeof(mpz_t) * (t.count - 2));
+        }
+
+        if (t.count > 2 && (!t.ek || !t.vk || !t.uk))
+        {
+            free(t.ek);
+            free(t.vk);
+            free(t.uk);
+            throw boost::archive::archive_exception(boost::archive::archive_exception::other_exception,
+                                                    "out of memory for an encryption proof");
+        }
+
         const char* hex1 = str1.c_str();
         mpz_init_set_str(t.c, hex1, 16);
 
@@ -93,6 +163,49 @@ namespace serialization {
 
         const char* hex6 = str6.c_str();
         mpz_init_set_str(t.v2, hex6, 16);
+
+        const char* hex7 = str7.c_str();
+        mpz_init_set_str(t.u1, hex7, 16);
+
+        const char* hex8 = str8.c_str();
+        mpz_init_set_str(t.u2, hex8, 16);
+
+        for (int i = 0; i < t.count - 2; i++)
+        {
+            mpz_ptr values[] = { t.ek[i], t.vk[i], t.uk[i] };
+            for (int j = 0; j < 3; j++)
+            {
+                std::string str;
+                a & str;
+
+                mpz_init_set_str(values[j], str.c_str(), 16);
+            }
+        }
+    }
+
+    // ================================================================
+
+    template<class Archive>
+    void save(Archive& a, const paillier_ciphertext_pure_t& t, unsigned int)
+    {
+        char hex1[mpz_sizeinbase(t.c, 16) + 2];
+        mpz_get_str(hex1, 16, t.c);
+        std::string str1(hex1);
+
+        a & str1;
+    }
+
+    // ----------------------------------------------------------------
+
+    template<class Archive>
+    void load(Archive& a, paillier_ciphertext_pure_t& t, unsigned int)
+    {
+        std::string str1;
+
+        a & str1;
+
+        const char* hex1 = str1.c_str();
+        mpz_init_set_str(t.c, hex1, 16);
     }
 
     // ================================================================
@@ -126,18 +239,32 @@ namespace serialization {
         a & str3;
         a & str4;
         a & str5;
+        a & t.version;
+
+        char hex6[mpz_sizeinbase(t.a, 16) + 2];
+        mpz_get_str(hex6, 16, t.a);
+        std::string str6(hex6);
+
+        char hex7[mpz_sizeinbase(t.b, 16) + 2];
+        mpz_get_str(hex7, 16, t.b);
+        std::string str7(hex7);
+
+        a & str6;
+        a & str7;
     }
 
     // ----------------------------------------------------------------
 
     template<class Archive>
-    void load(Archive& a, paillier_partialdecryption_proof_t& t, unsigned int)
+    void load(Archive& a, paillier_partialdecryption_proof_t& t, unsigned int version)
     {
         std::string str1;
         std::string str2;
         std::string str3;
         std::string str4;
         std::string str5;
+        std::string str6("0");
+        std::string str7("0");
 
         a & t.id;
         a & str1;
@@ -146,6 +273,18 @@ namespace serialization {
         a & str4;
         a & str5;
 
+        // proofs stored before the version was introduced
+        t.version = PAILLIER_PROOF_V1;
+        if (version > 0)
+            a & t.version;
+
+        // proofs stored before the commitments were introduced
+        if (version > 1)
+        {
+            a & str6;
+            a & str7;
+        }
+
         const char* hex1 = str1.c_str();
         mpz_init_set_str(t.decryption, hex1, 16);
 
@@ -160,11 +299,24 @@ namespace serialization {
 
         const char* hex5 = str5.c_str();
         mpz_init_set_str(t.z, hex5, 16);
+
+        const char* hex6 = str6.c_str();
+        mpz_init_set_str(t.a, hex6, 16);
+
+        const char* hex7 = str7.c_str();
+        mpz_init_set_str(t.b, hex7, 16);
     }
 }
 }
 
+BOOST_SERIALIZATION_SPLIT_FREE(paillier_ciphertext_pure_t)
 BOOST_SERIALIZATION_SPLIT_FREE(paillier_ciphertext_proof_t)
 BOOST_SERIALIZATION_SPLIT_FREE(paillier_partialdecryption_proof_t)
 
+// version 1: proof version (see PAILLIER_PROOF_VERSION)
+// version 2: commitments (of decryption proofs since PAILLIER_PROOF_V4)
+// version 3: further branches of encryption proofs (see PAILLIER_PROOF_V5)
+BOOST_CLASS_VERSION(paillier_ciphertext_proof_t, 3)
+BOOST_CLASS_VERSION(paillier_partialdecryption_proof_t, 2)
+
 #endif // PAILLIER_SERIALIZATION_H
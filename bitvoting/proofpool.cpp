@@ -0,0 +1,164 @@
+#include "proofpool.h"
+
+#include "helper.h"
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+// ================================================================
+
+ProofPoolEntry::~ProofPoolEntry()
+{
+    BOOST_FOREACH(paillier_enc_precomputation_t* pre, this->precomputations)
+        paillier_freeencprecomputation(pre);
+
+    paillier_freepubkey(this->key);
+}
+
+// ================================================================
+
+ProofPool::ProofPool(boost::thread_group *threadGroup, unsigned int capacity) :
+    capacity(capacity)
+{
+    if (threadGroup)
+        threadGroup->create_thread(boost::bind(&ProofPool::fill, this));
+}
+
+// ----------------------------------------------------------------
+
+void
+ProofPool::add(const uint256 &election, paillier_pubkey_t *key)
+{
+    boost::mutex::scoped_lock lock(this->mutex);
+
+    if (this->pools.count(election))
+        return;
+
+    this->pools[election] = boost::shared_ptr<ProofPoolEntry>(new ProofPoolEntry(key));
+    this->poolsChanged.notify_all();
+}
+
+// ----------------------------------------------------------------
+
+void
+ProofPool::remove(const uint256 &election)
+{
+    boost::mutex::scoped_lock lock(this->mutex);
+
+    // freed as soon as the filling thread is done with it
+    this->pools.erase(election);
+}
+
+// ----------------------------------------------------------------
+
+paillier_enc_precomputation_t*
+ProofPool::take(const uint256 &election, paillier_pubkey_t *key)
+{
+    {
+        boost::mutex::scoped_lock lock(this->mutex);
+
+        std::map<uint256, boost::shared_ptr<ProofPoolEntry>>::iterator iter = this->pools.find(election);
+        if (iter != this->pools.end() && !iter->second->precomputations.empty())
+        {
+            paillier_enc_precomputation_t* pre = iter->second->precomputations.front();
+            iter->second->precomputations.pop_front();
+
+            // there is something to refill
+            this->poolsChanged.notify_all();
+            return pre;
+        }
+    }
+
+    Log::i("(ProofPool) No precomputation available, computing it now");
+    return paillier_enc_precompute(key, paillier_get_rand_devurandom, NULL);
+}
+
+// ----------------------------------------------------------------
+
+unsigned int
+ProofPool::size(const uint256 &election)
+{
+    boost::mutex::scoped_lock lock(this->mutex);
+
+    std::map<uint256, boost::shared_ptr<ProofPoolEntry>>::iterator iter = this->pools.find(election);
+    if (iter == this->pools.end())
+        return 0;
+
+    return iter->second->precomputations.size();
+}
+
+// ----------------------------------------------------------------
+
+bool
+ProofPool::fillNext()
+{
+    // find the emptiest pool
+    boost::shared_ptr<ProofPoolEntry> entry;
+    {
+        boost::mutex::scoped_lock lock(this->mutex);
+
+        std::map<uint256, boost::shared_ptr<ProofPoolEntry>>::iterator iter;
+        for (iter = this->pools.begin(); iter != this->pools.end(); iter++)
+        {
+            if (iter->second->precomputations.size() >= this->capacity)
+                continue;
+
+            if (!entry || iter->second->precomputations.size() < entry->precomputations.size())
+                entry = iter->second;
+        }
+    }
+
+    if (!entry)
+        return false;
+
+    // the expensive part is done without holding the lock
+    paillier_enc_precomputation_t* pre = paillier_enc_precompute(entry->key, paillier_get_rand_devurandom, NULL);
+
+    boost::mutex::scoped_lock lock(this->mutex);
+    entry->precomputations.push_back(pre);
+
+    return true;
+}
+
+// ----------------------------------------------------------------
+
+bool
+ProofPool::needsFilling()
+{
+    std::map<uint256, boost::shared_ptr<ProofPoolEntry>>::iterator iter;
+    for (iter = this->pools.begin(); iter != this->pools.end(); iter++)
+    {
+        if (iter->second->precomputations.size() < this->capacity)
+            return true;
+    }
+
+    return false;
+}
+
+// ----------------------------------------------------------------
+
+void
+ProofPool::fill()
+{
+    Log::i("(ProofPool) Started precomputing ballot encryptions");
+
+    try
+    {
+        while (true)
+        {
+            // wait until a pool is added or something is taken
+            {
+                boost::mutex::scoped_lock lock(this->mutex);
+                while (!this->needsFilling())
+                    this->poolsChanged.wait(lock);
+            }
+
+            boost::this_thread::interruption_point();
+            this->fillNext();
+        }
+    }
+    catch (boost::thread_interrupted&)
+    {
+        Log::i("(ProofPool) Stopped precomputing ballot encryptions");
+    }
+}
@@ -0,0 +1,88 @@
+/*=============================================================================
+
+Pool of precomputed ballot encryptions (see paillier_enc_precompute).
+
+Most of the work of encrypting a ballot with its proof neither depends on the
+answer nor on the challenge of the proof. For every election the client may
+vote in, a background thread computes this part in advance (up to a limit),
+so that creating a vote only needs a few multiplications and one hash per
+question. If a pool runs empty, the precomputation is done on the spot.
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_PROOFPOOL_H
+#define BITVOTING_PROOFPOOL_H
+
+#include "settings.h"
+#include "bitcoin/uint256.h"
+#include "paillier/paillier.h"
+
+#include <deque>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+// ----------------------------------------------------------------
+// Precomputations for the public key of one election
+struct ProofPoolEntry
+{
+    // own copy of the public key of the election
+    paillier_pubkey_t* key;
+
+    std::deque<paillier_enc_precomputation_t*> precomputations;
+
+    ProofPoolEntry(paillier_pubkey_t* key):
+        key(paillier_copypubkey(key)) {}
+
+    ProofPoolEntry(ProofPoolEntry const&)  = delete;
+    void operator=(ProofPoolEntry const&)  = delete;
+
+    ~ProofPoolEntry();
+};
+
+// ----------------------------------------------------------------
+class ProofPool
+{
+public:
+    // the pools are filled by a thread of the given group
+    // (or only by calling fillNext, if it is NULL)
+    ProofPool(boost::thread_group *threadGroup,
+              unsigned int capacity = Settings::PROOF_POOL_SIZE);
+
+    // starts precomputing for the given election (if not done already)
+    void add(const uint256 &election, paillier_pubkey_t *key);
+
+    // drops the pool of the given election
+    void remove(const uint256 &election);
+
+    // takes a precomputation for the given election, which has to be freed
+    // by the caller. Computed on the spot if the pool is empty.
+    paillier_enc_precomputation_t* take(const uint256 &election, paillier_pubkey_t *key);
+
+    // number of available precomputations for the given election
+    unsigned int size(const uint256 &election);
+
+    // adds one precomputation to a pool, which is not full.
+    // Returns false, if all pools are full.
+    bool fillNext();
+
+private:
+    unsigned int capacity;
+
+    // protects pools
+    boost::mutex mutex;
+    boost::condition_variable poolsChanged;
+
+    // pools per election, shared with the thread computing for it
+    std::map<uint256, boost::shared_ptr<ProofPoolEntry>> pools;
+
+    // checks if any pool is not full (mutex must be held)
+    bool needsFilling();
+
+    // fills the pools whenever there is something to do,
+    // runs in its own thread
+    void fill();
+};
+
+#endif // BITVOTING_PROOFPOOL_H
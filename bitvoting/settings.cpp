@@ -70,7 +70,13 @@ Settings::ParseArguments(int argc, char** argv)
             ("duplicate-validity", po::value<long>(),
              "determines how long messages should be remembered (valid) for duplicate checking (msec, default 1min)")
             ("ping-interval", po::value<long>(),
-             "interval in which neighborhood should be pinged for new connections (msec, default 5min)");
+             "interval in which neighborhood should be pinged for new connections (msec, default 5min)")
+            ("block-max-bytes", po::value<uint64_t>(),
+             "maximum size of the transactions of a mined block (bytes, default 4MB)")
+            ("block-max-transactions", po::value<unsigned int>(),
+             "maximum number of transactions of a mined block (default 1000)")
+            ("block-max-wait", po::value<long>(),
+             "maximum time transactions wait for a block to fill up before it is mined (msec, default 10sec)");
 
     // assemble options
     po::options_description cmdline_options;
@@ -121,6 +127,9 @@ Settings::ParseArguments(int argc, char** argv)
     Log::i("(Settings) Ping Interval: \t\t%lu", Settings::GetPingInterval());
     Log::i("(Settings) Max. Connections: \t\t%d", Settings::GetMaxConnections());
     Log::i("(Settings) Mining Threads: \t\t%d", Settings::GetMiningThreads());
+    Log::i("(Settings) Block Max. Bytes: \t\t%lu", Settings::GetBlockMaxBytes());
+    Log::i("(Settings) Block Max. Transactions: \t%d", Settings::GetBlockMaxTransactions());
+    Log::i("(Settings) Block Max. Wait: \t\t%lu", Settings::GetBlockMaxWait());
     Log::i("(Settings) Log to File: \t\t%d", Settings::GetPrintToFile());
 
     return true;
@@ -246,3 +255,36 @@ Settings::GetMiningThreads()
 
     return Settings::defaultMiningThreads;
 }
+
+// ----------------------------------------------------------------
+
+uint64_t
+Settings::GetBlockMaxBytes()
+{
+    if (vm.count("block-max-bytes"))
+        return vm["block-max-bytes"].as<uint64_t>();
+
+    return Settings::defaultBlockMaxBytes;
+}
+
+// ----------------------------------------------------------------
+
+unsigned int
+Settings::GetBlockMaxTransactions()
+{
+    if (vm.count("block-max-transactions"))
+        return vm["block-max-transactions"].as<unsigned int>();
+
+    return Settings::defaultBlockMaxTransactions;
+}
+
+// ----------------------------------------------------------------
+
+long
+Settings::GetBlockMaxWait()
+{
+    if (vm.count("block-max-wait"))
+        return vm["block-max-wait"].as<long>();
+
+    return Settings::defaultBlockMaxWait;
+}
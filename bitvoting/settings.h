@@ -36,6 +36,12 @@ namespace Settings
     // This is only needed by uint256.h
     const int PROTOCOL_VERSION = 1;
 
+    // Version of the block header format
+    // (2: fixed-size binary header with merkle root of the transactions)
+    // (3: compact hash target in header, retargeted from past blocks)
+    // (4: key id of the miner in header)
+    const int BLOCK_VERSION = 4;
+
     // Default database cache size (in bytes)
     const int64_t DEFAULT_DB_CACHE = 100;
 
@@ -48,14 +54,44 @@ namespace Settings
     // Number of bits of generated paillier keys
     const int PAILLIER_BITS = 1024;
 
+    // bounds of the pool of transactions waiting to be mined
+    const unsigned int MEMPOOL_MAX_TRANSACTIONS = 100000;
+    const uint64_t MEMPOOL_MAX_BYTES = 512 * 1024 * 1024;
+
     // minimum number of transactions to be mined into one block
     const int MINING_MIN_TRANSACTIONS = 1;
 
-    // leading zero bits for hash-target (difficulty for proof-of-work)
-    const int MINING_LEADING_ZEROS = 17;
+    // leading zero bits for the hash-target (difficulty for proof-of-work)
+    // of the first blocks and at least for every block
+    const int MINING_INITIAL_LEADING_ZEROS = 17;
+    const int MINING_MIN_LEADING_ZEROS = 8;
 
-    // number of nonces consumed at once by a miner-thread
+    // desired time between two blocks (msec), the hash-target is adapted
+    // to the time the last MINING_RETARGET_WINDOW blocks took, but by at
+    // most MINING_RETARGET_MAX_FACTOR per block
+    const long MINING_TARGET_BLOCK_TIME = 20 * 1000;
+    const unsigned int MINING_RETARGET_WINDOW = 24;
+    const int MINING_RETARGET_MAX_FACTOR = 4;
+
+    // number of nonces consumed at once by a miner-thread (initially,
+    // adapted per thread so that a chunk takes MINING_CHUNK_MILLISECONDS)
     const int MINING_NONCES_AT_ONCE = 1000;
+    const int MINING_NONCES_MAX_AT_ONCE = 1 << 24;
+    const int MINING_CHUNK_MILLISECONDS = 50;
+
+    // interval in which the hash rate is measured and logged (msec)
+    const long MINING_STATS_INTERVAL = 60 * 1000;
+
+    // number of ballot encryptions precomputed per election (see ProofPool)
+    const unsigned int PROOF_POOL_SIZE = 32;
+
+    // number of ballots a thread verifies (at once) and multiplies,
+    // before taking the next ones (see ElectionManager::combineBallots)
+    const unsigned int TALLY_BALLOTS_AT_ONCE = 64;
+
+    // number of snapshots of the running tally kept per election, i.e. how
+    // many blocks with votes back a tally can be read without recounting
+    const unsigned int TALLY_SNAPSHOTS = 16;
 
     // ----------------------------------------------------------------
     // CLI/Config default arguments
@@ -70,6 +106,9 @@ namespace Settings
     const bool defaultLogToConsole = true;
     const bool defaultLogToFile = true;
     const unsigned int defaultMiningThreads = 2;
+    const uint64_t defaultBlockMaxBytes = 4 * 1024 * 1024;
+    const unsigned int defaultBlockMaxTransactions = 1000;
+    const long defaultBlockMaxWait = 10 * 1000;
 
     // ----------------------------------------------------------------
 
@@ -90,6 +129,9 @@ namespace Settings
     bool GetPrintToConsole();
     bool GetPrintToFile();
     unsigned int GetMiningThreads();
+    uint64_t GetBlockMaxBytes();
+    unsigned int GetBlockMaxTransactions();
+    long GetBlockMaxWait();
 }
 
 #endif // SETTINGS_H
@@ -6,6 +6,16 @@
 #include "tests/test_blockchain.h"
 #include "tests/test_paillier.h"
 #include "tests/test_database_store.h"
+#include "tests/test_merkle.h"
+#include "tests/test_sha256.h"
+#include "tests/test_mempool.h"
+#include "tests/test_difficulty.h"
+#include "tests/test_miningstats.h"
+#include "tests/test_canonical.h"
+#include "tests/test_hashsink.h"
+#include "tests/test_proofpool.h"
+#include "tests/test_arithmetic.h"
+#include "tests/test_tally.h"
 
 void test_start()
 {
@@ -14,6 +24,16 @@ void test_start()
     test_blockchain();
     test_pailler();
     test_database_store();
+    test_merkle();
+    test_sha256();
+    test_mempool();
+    test_difficulty();
+    test_miningstats();
+    test_canonical();
+    test_hashsink();
+    test_proofpool();
+    test_arithmetic();
+    test_tally();
 
     // call others too...
 }
@@ -5,7 +5,17 @@ SOURCES += \
     $$PWD/test_blockchain.cpp \
     $$PWD/test_paillier.cpp \
     $$PWD/test_comparison.cpp \
-    $$PWD/test_database_store.cpp
+    $$PWD/test_database_store.cpp \
+    $$PWD/test_merkle.cpp \
+    $$PWD/test_sha256.cpp \
+    $$PWD/test_mempool.cpp \
+    $$PWD/test_difficulty.cpp \
+    $$PWD/test_miningstats.cpp \
+    $$PWD/test_canonical.cpp \
+    $$PWD/test_hashsink.cpp \
+    $$PWD/test_proofpool.cpp \
+    $$PWD/test_arithmetic.cpp \
+    $$PWD/test_tally.cpp
 
 HEADERS += \
     $$PWD/test.h \
@@ -13,4 +23,14 @@ HEADERS += \
     $$PWD/test_blockchain.h \
     $$PWD/test_paillier.h \
     $$PWD/test_comparison.h \
-    $$PWD/test_database_store.h
\ No newline at end of file
+    $$PWD/test_database_store.h \
+    $$PWD/test_merkle.h \
+    $$PWD/test_sha256.h \
+    $$PWD/test_mempool.h \
+    $$PWD/test_difficulty.h \
+    $$PWD/test_miningstats.h \
+    $$PWD/test_canonical.h \
+    $$PWD/test_hashsink.h \
+    $$PWD/test_proofpool.h \
+    $$PWD/test_arithmetic.h \
+    $$PWD/test_tally.h
\ No newline at end of file
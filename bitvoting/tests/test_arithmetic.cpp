@@ -0,0 +1,142 @@
+#include "test_arithmetic.h"
+
+#include "helper.h"
+#include "paillier/arithmetic.h"
+#include "paillier/paillier.h"
+
+void test_arithmetic()
+{
+    Log::i("(Test) # Test: Paillier arithmetic");
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(256, 3, 2, &pub, &prv, paillier_get_rand_devurandom);
+
+    gmp_randstate_t rand;
+    gmp_randinit_default(rand);
+
+    mpz_t x, b1, b2, e1, e2, expected, temp, result;
+    mpz_inits(x, b1, b2, e1, e2, expected, temp, result, NULL);
+
+    // powers of g = n+1 in closed form
+    for (int i = 0; i < 20; i++)
+    {
+        mpz_urandomb(x, rand, 2 * pub->bits);
+        if (i % 2)
+            mpz_neg(x, x);
+
+        mpz_powm(expected, pub->n_plusone, x, pub->n_s1);
+        paillier_pow_g(result, x, pub);
+        assert(mpz_cmp(result, expected) == 0);
+    }
+
+    // products of two powers, also with negative, zero and
+    // differently sized exponents
+    for (int i = 0; i < 20; i++)
+    {
+        mpz_urandomm(b1, rand, pub->n_s1);
+        mpz_urandomm(b2, rand, pub->n_s1);
+        mpz_urandomb(e1, rand, 3 * pub->bits + 256);
+        mpz_urandomb(e2, rand, (i % 4) ? 256 : pub->bits);
+        if (i % 3 == 1)
+            mpz_neg(e2, e2);
+        if (i % 5 == 2)
+            mpz_set_ui(e1, 0);
+
+        mpz_powm(expected, b1, e1, pub->n_s1);
+        mpz_powm(temp, b2, e2, pub->n_s1);
+        mpz_mul(expected, expected, temp);
+        mpz_mod(expected, expected, pub->n_s1);
+
+        assert(paillier_powm2(result, b1, e1, b2, e2, pub->n_s1));
+        assert(mpz_cmp(result, expected) == 0);
+    }
+
+    // inverse does not exist
+    mpz_set(b2, pub->n);
+    mpz_set_si(e2, -1);
+    assert(!paillier_powm2(result, b1, e1, b2, e2, pub->n_s1));
+
+    // products of many powers with exponents of different lengths
+    const int count = 7;
+    mpz_t bases[count], exps[count];
+    mpz_srcptr basePtrs[count], expPtrs[count];
+    mpz_set_ui(expected, 1);
+    for (int i = 0; i < count; i++)
+    {
+        mpz_init(bases[i]);
+        mpz_init(exps[i]);
+        mpz_urandomm(bases[i], rand, pub->n_s1);
+        mpz_urandomb(exps[i], rand, (i % 2) ? 64 : 2 * pub->bits + 64);
+        basePtrs[i] = bases[i];
+        expPtrs[i] = exps[i];
+
+        mpz_powm(temp, bases[i], exps[i], pub->n_s1);
+        mpz_mul(expected, expected, temp);
+        mpz_mod(expected, expected, pub->n_s1);
+    }
+
+    paillier_powm_multi(result, basePtrs, expPtrs, count, pub->n_s1);
+    assert(mpz_cmp(result, expected) == 0);
+
+    // empty product
+    paillier_powm_multi(result, basePtrs, expPtrs, 0, pub->n_s1);
+    assert(mpz_cmp_ui(result, 1) == 0);
+
+    for (int i = 0; i < count; i++)
+    {
+        mpz_clear(bases[i]);
+        mpz_clear(exps[i]);
+    }
+
+    // fixed bases, the table is extended for longer exponents
+    mpz_urandomm(b1, rand, pub->n_s1);
+    for (int i = 0; i < 20; i++)
+    {
+        mpz_urandomb(e1, rand, (i < 10) ? 256 : 3 * pub->bits + 256);
+        if (i % 3 == 1)
+            mpz_neg(e1, e1);
+        if (i % 7 == 2)
+            mpz_set_ui(e1, 0);
+
+        mpz_powm(expected, b1, e1, pub->n_s1);
+
+        assert(paillier_powm_fixed(result, b1, e1, pub->n_s1));
+        assert(mpz_cmp(result, expected) == 0);
+    }
+    assert(paillier_fixed_tables_size() > 0);
+
+    // the verification keys are fixed bases as well
+    mpz_powm(expected, pub->verificationKeys[0]->v, e1, pub->n_s1);
+    assert(paillier_powm_fixed(result, pub->verificationKeys[0]->v, e1, pub->n_s1));
+    assert(mpz_cmp(result, expected) == 0);
+
+    // inverse does not exist
+    assert(!paillier_powm_fixed(result, pub->n, e2, pub->n_s1));
+
+    // powers of g and their logarithms for keys with s > 1
+    paillier_pubkey_t* pubDJ;
+    paillier_partialkey_t** prvDJ;
+    paillier_keygen(128, 1, 1, &pubDJ, &prvDJ, paillier_get_rand_devurandom, 3);
+    for (int i = 0; i < 20; i++)
+    {
+        mpz_urandomb(x, rand, 4 * pubDJ->bits);
+        if (i % 2)
+            mpz_neg(x, x);
+
+        mpz_powm(expected, pubDJ->n_plusone, x, pubDJ->n_s1);
+        paillier_pow_g(result, x, pubDJ);
+        assert(mpz_cmp(result, expected) == 0);
+
+        mpz_mod(expected, x, pubDJ->n_s);
+        paillier_log_g(result, result, pubDJ);
+        assert(mpz_cmp(result, expected) == 0);
+    }
+    paillier_freepartkeysarray(prvDJ, pubDJ->decryptServers);
+    paillier_freepubkey(pubDJ);
+
+    mpz_clears(x, b1, b2, e1, e2, expected, temp, result, NULL);
+    gmp_randclear(rand);
+    paillier_freepartkeysarray(prv, pub->decryptServers);
+    paillier_freepubkey(pub);
+}
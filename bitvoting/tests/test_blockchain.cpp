@@ -2,6 +2,7 @@
 
 #include "paillier/paillier.h"
 #include "block.h"
+#include "miner.h"
 #include "database/blockchaindb.h"
 #include "store.h"
 
@@ -164,6 +165,7 @@ void random_block(Block** out)
     Block* result = new Block();
     result->header.time = Helper::GenerateRandomUInt();
     result->header.nonce = Helper::GenerateRandomUInt();
+    result->header.bits = Difficulty::getInitialBits();
 
     int num = Helper::GenerateRandom(MAX_TRANSACTIONS - 1) + 1;
     for (int i = 0; i < num; i++)
@@ -173,6 +175,8 @@ void random_block(Block** out)
         result->transactions.insert(transaction);
     }
 
+    result->header.hashMerkleRoot = Miner::hashTransactions(result->transactions);
+
     *out = result;
 }
 
@@ -210,6 +214,12 @@ void test_blockchain()
             delete last;
         }
 
+        // the first blocks use the initial difficulty
+        unsigned int bits;
+        assert(BlockChainDB::getNextWorkRequired(lastHash, bits) == BlockChainStatus::BC_OK);
+        if (i < (int) Settings::MINING_RETARGET_WINDOW)
+            assert(bits == Difficulty::getInitialBits());
+
         // add a new block
         Block* block = NULL;
         random_block(&block);
@@ -230,6 +240,16 @@ void test_blockchain()
         int t = Helper::GenerateRandom(vector.size() - 1);
 
         assert(BlockChainDB::containsTransaction(vector[t]->getHash()));
+
+        MerkleProof proof;
+        assert(BlockChainDB::getMerkleProof(vector[t]->getHash(), proof) == BlockChainStatus::BC_OK);
+        assert(proof.block == lastHash);
+        assert(BlockChainDB::verifyMerkleProof(proof));
+
+        // the number of leaves is fixed by the block
+        MerkleProof wider = proof;
+        wider.leaves++;
+        assert(!BlockChainDB::verifyMerkleProof(wider));
     }
 
     Block* last = NULL;
@@ -237,6 +257,9 @@ void test_blockchain()
     assert(last->getHash() == lastHash);
     delete last;
 
+    unsigned int bits;
+    assert(BlockChainDB::getNextWorkRequired(Helper::GenerateRandom256(), bits) == BlockChainStatus::BC_NOT_FOUND);
+
     // add invalid
     Block* block = NULL;
     random_block(&block);
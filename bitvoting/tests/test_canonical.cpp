@@ -0,0 +1,152 @@
+#include "test_canonical.h"
+
+#include "helper.h"
+#include "paillier/paillier.h"
+#include "transactions/tally.h"
+#include "transactions/vote.h"
+#include "utils/canonical.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
+static std::vector<unsigned char> bytes(std::initializer_list<unsigned char> list)
+{
+    return std::vector<unsigned char>(list);
+}
+
+static std::vector<unsigned char> encoded(const std::ostringstream &stream)
+{
+    // without the version
+    std::string data = stream.str();
+    return std::vector<unsigned char>(data.begin() + 1, data.end());
+}
+
+static void test_canonical_writer()
+{
+    Log::i("(Test) - Writer");
+
+    std::ostringstream empty;
+    CanonicalWriter emptyWriter(empty);
+    assert(empty.str() == std::string(1, CANONICAL_ENCODING_VERSION));
+
+    // fixed width integers (little-endian)
+    std::ostringstream integers;
+    CanonicalWriter integersWriter(integers);
+    integersWriter.writeUInt8(0xab);
+    integersWriter.writeUInt32(0x01020304);
+    integersWriter.writeInt64(-2);
+    integersWriter.writeBool(true);
+    assert(encoded(integers) == bytes({ 0xab, 0x04, 0x03, 0x02, 0x01,
+                                        0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                        0x01 }));
+
+    // length-prefixed bytes
+    std::ostringstream strings;
+    CanonicalWriter stringsWriter(strings);
+    stringsWriter.writeString("ab");
+    stringsWriter.writeString("");
+    assert(encoded(strings) == bytes({ 0x02, 0x00, 0x00, 0x00, 'a', 'b',
+                                       0x00, 0x00, 0x00, 0x00 }));
+
+    // big-endian magnitude, zero without bytes
+    mpz_t value;
+    mpz_init_set_ui(value, 0x010203);
+    std::ostringstream numbers;
+    CanonicalWriter numbersWriter(numbers);
+    numbersWriter.writeMpz(value);
+    mpz_set_ui(value, 0);
+    numbersWriter.writeMpz(value);
+    assert(encoded(numbers) == bytes({ 0x03, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03,
+                                       0x00, 0x00, 0x00, 0x00 }));
+
+    // large numbers span several limbs
+    mpz_ui_pow_ui(value, 3, 1000);
+    std::vector<unsigned char> expected((mpz_sizeinbase(value, 2) + 7) / 8);
+    mpz_export(&expected[0], NULL, 1, 1, 1, 0, value);
+    std::ostringstream large;
+    CanonicalWriter largeWriter(large);
+    largeWriter.writeMpz(value);
+    assert(encoded(large).size() == expected.size() + 4);
+    assert(std::equal(expected.begin(), expected.end(), encoded(large).begin() + 4));
+    mpz_clear(value);
+
+    // hashes are written raw
+    uint256 hash = Helper::GenerateRandom256();
+    std::ostringstream hashes;
+    CanonicalWriter hashesWriter(hashes);
+    hashesWriter.writeHash(hash);
+    assert(encoded(hashes) == std::vector<unsigned char>(hash.begin(), hash.end()));
+}
+
+// ----------------------------------------------------------------
+
+static void test_canonical_transactions()
+{
+    Log::i("(Test) - Transactions");
+
+    CKey key;
+    key.MakeNewKey();
+
+    paillier_pubkey_t* publicKey = NULL;
+    paillier_partialkey_t** privateKeys = NULL;
+    paillier_keygen(256, 1, 1, &publicKey, &privateKeys, paillier_get_rand_devurandom);
+
+    TxVote* vote = new TxVote();
+    vote->election = Helper::GenerateRandom256();
+    vote->setPublicKey(key.GetPubKey());
+    for (int i = 0; i < 3; i++)
+    {
+        EncryptedBallot ballot;
+        ballot.questionID = Helper::GenerateRandom160();
+        ballot.answer = paillier_enc_proof(publicKey, PLAINTEXT_SELECTION::FIRST, paillier_get_rand_devurandom, NULL);
+        vote->ballots.insert(ballot);
+    }
+
+    uint256 hash = vote->getHash();
+
+    // the hash survives sending the transaction around
+    std::stringstream stream;
+    {
+        boost::archive::text_oarchive oa(stream);
+        Transaction* t = vote;
+        oa << t;
+    }
+    Transaction* loaded = NULL;
+    {
+        boost::archive::text_iarchive ia(stream);
+        ia >> loaded;
+    }
+    assert(loaded->getHash() == hash);
+
+    // every field is part of the hash
+    vote->election = Helper::GenerateRandom256();
+    vote->invalidateHash();
+    assert(vote->getHash() != hash);
+
+    TxTally* tally = new TxTally();
+    tally->setPublicKey(key.GetPubKey());
+    uint256 tallyHash = tally->getHash();
+    tally->endElection = true;
+    tally->invalidateHash();
+    assert(tally->getHash() != tallyHash);
+
+    delete vote;
+    delete loaded;
+    delete tally;
+    paillier_freepubkey(publicKey);
+    paillier_freepartkeysarray(privateKeys, 1);
+}
+
+// ----------------------------------------------------------------
+
+void test_canonical()
+{
+    Log::i("(Test) # Test: Canonical encoding");
+
+    test_canonical_writer();
+    test_canonical_transactions();
+}
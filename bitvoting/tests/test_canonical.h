@@ -0,0 +1,6 @@
+#ifndef TEST_CANONICAL_H
+#define TEST_CANONICAL_H
+
+void test_canonical();
+
+#endif // TEST_CANONICAL_H
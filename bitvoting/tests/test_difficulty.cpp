@@ -0,0 +1,60 @@
+#include "test_difficulty.h"
+
+#include "helper.h"
+#include "settings.h"
+#include "utils/difficulty.h"
+
+#include <vector>
+
+void test_difficulty()
+{
+    Log::i("(Test) # Test: Difficulty");
+
+    // known compact value (Bitcoin's genesis target)
+    uint256 known = 0xffff;
+    known <<= 208;
+    assert(Difficulty::fromCompact(0x1d00ffff) == known);
+    assert(Difficulty::toCompact(known) == 0x1d00ffff);
+
+    // small values
+    assert(Difficulty::fromCompact(0x01120000) == 0x12);
+    assert(Difficulty::toCompact(0x80) == 0x02008000);
+
+    // invalid encodings (negative, overflow)
+    assert(Difficulty::fromCompact(0x04923456) == 0);
+    assert(Difficulty::fromCompact(0xff123456) == 0);
+
+    // round trip keeps the three most significant bytes
+    for (int i = 0; i < 100; i++)
+    {
+        uint256 target = Helper::GenerateRandom256() >> Helper::GenerateRandom(200);
+        uint256 decoded = Difficulty::fromCompact(Difficulty::toCompact(target));
+
+        assert(decoded <= target);
+        assert((target - decoded) < (target >> 15));
+        assert(Difficulty::toCompact(decoded) == Difficulty::toCompact(target));
+    }
+
+    unsigned int initial = Difficulty::getInitialBits();
+    uint256 initialTarget = Difficulty::fromCompact(initial);
+    assert(initialTarget > 0 && initialTarget <= Difficulty::getMaxTarget());
+
+    std::vector<unsigned int> window(Settings::MINING_RETARGET_WINDOW, initial);
+    long long expected = (long long) window.size() * Settings::MINING_TARGET_BLOCK_TIME;
+
+    // blocks in time: target stays the same
+    assert(Difficulty::retarget(window, expected) == initial);
+
+    // blocks twice as fast: half the target
+    uint256 faster = Difficulty::fromCompact(Difficulty::retarget(window, expected / 2));
+    assert(faster < initialTarget);
+    assert(Difficulty::toCompact(faster) == Difficulty::toCompact(initialTarget >> 1));
+
+    // adjustment is limited
+    assert(Difficulty::retarget(window, 0) == Difficulty::retarget(window, expected / Settings::MINING_RETARGET_MAX_FACTOR));
+    assert(Difficulty::retarget(window, -expected) == Difficulty::retarget(window, 0));
+
+    // never easier than the maximum target
+    std::vector<unsigned int> easy(window.size(), Difficulty::toCompact(Difficulty::getMaxTarget()));
+    assert(Difficulty::fromCompact(Difficulty::retarget(easy, expected * 100)) <= Difficulty::getMaxTarget());
+}
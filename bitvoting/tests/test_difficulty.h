@@ -0,0 +1,6 @@
+#ifndef TEST_DIFFICULTY_H
+#define TEST_DIFFICULTY_H
+
+void test_difficulty();
+
+#endif // TEST_DIFFICULTY_H
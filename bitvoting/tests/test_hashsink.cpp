@@ -0,0 +1,74 @@
+#include "test_hashsink.h"
+
+#include "helper.h"
+#include "bitcoin/hash.h"
+#include "paillier/paillier.h"
+#include "utils/hashsink.h"
+
+#include <string>
+#include <vector>
+
+// hash over the concatenated hex strings, as hashMultiple is defined
+static uint256 hash_hex(std::vector<__mpz_struct> &in)
+{
+    std::string concat;
+    for (unsigned int i = 0; i < in.size(); i++)
+    {
+        mpz_t value = { in[i] };
+        char *str = mpz_get_str(NULL, 16, value);
+        concat += str;
+        free(str);
+    }
+
+    // including the null-terminator
+    return Hash(concat.c_str(), concat.c_str() + concat.size() + 1);
+}
+
+void test_hashsink()
+{
+    Log::i("(Test) # Test: Hash sink");
+
+    std::vector<unsigned char> data(10000);
+    for (unsigned int i = 0; i < data.size(); i++)
+        data[i] = Helper::GenerateRandom(255);
+
+    uint256 expected = Hash(data.begin(), data.end());
+
+    // written at once or in pieces
+    HashWriter once;
+    once.write(&data[0], data.size());
+    assert(once.getHash() == expected);
+
+    HashWriter pieces;
+    for (unsigned int i = 0; i < data.size(); i += 7)
+        pieces.write(&data[i], std::min<size_t>(7, data.size() - i));
+    assert(pieces.getHash() == expected);
+
+    // through a stream
+    HashWriter streamed;
+    {
+        HashStream stream(streamed);
+        stream.write((const char*) &data[0], data.size());
+        stream.flush();
+    }
+    assert(streamed.getHash() == expected);
+
+    // nothing written
+    HashWriter empty;
+    assert(empty.getHash() == Hash(data.begin(), data.begin()));
+
+    // hashMultiple (used for the proofs) must not change
+    mpz_t a, b, c;
+    mpz_init_set_ui(a, 0);
+    mpz_init_set_str(b, "123456789abcdef0123456789abcdef", 16);
+    mpz_init(c);
+    mpz_ui_pow_ui(c, 7, 500);
+
+    std::vector<__mpz_struct> values;
+    values.push_back(a[0]);
+    values.push_back(b[0]);
+    values.push_back(c[0]);
+    assert(hashMultiple(values) == hash_hex(values));
+
+    mpz_clears(a, b, c, NULL);
+}
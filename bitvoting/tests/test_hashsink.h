@@ -0,0 +1,6 @@
+#ifndef TEST_HASHSINK_H
+#define TEST_HASHSINK_H
+
+void test_hashsink();
+
+#endif // TEST_HASHSINK_H
@@ -0,0 +1,164 @@
+#include "test_mempool.h"
+
+#include "helper.h"
+#include "mempool.h"
+#include "paillier/paillier.h"
+#include "transactions/tally.h"
+#include "transactions/vote.h"
+
+#include <algorithm>
+#include <vector>
+
+static CPubKey new_public_key()
+{
+    CKey key;
+    key.MakeNewKey();
+    return key.GetPubKey();
+}
+
+static TxVote* new_vote(const uint256 &election, const CPubKey &voter)
+{
+    TxVote* vote = new TxVote();
+    vote->election = election;
+    vote->setPublicKey(voter);
+    return vote;
+}
+
+static void add_ballot(TxVote *vote)
+{
+    paillier_pubkey_t* publicKey = NULL;
+    paillier_partialkey_t** privateKeys = NULL;
+    paillier_keygen(256, 1, 1, &publicKey, &privateKeys, paillier_get_rand_devurandom);
+    paillier_freepartkeysarray(privateKeys, 1);
+
+    EncryptedBallot ballot;
+    ballot.questionID = Helper::GenerateRandom160();
+    ballot.answer = paillier_enc_proof(publicKey, PLAINTEXT_SELECTION::FIRST, paillier_get_rand_devurandom, NULL);
+    vote->ballots.insert(ballot);
+
+    paillier_freepubkey(publicKey);
+}
+
+static TxTally* new_tally(const CPubKey &creator)
+{
+    TxTally* tally = new TxTally();
+    tally->election = Helper::GenerateRandom256();
+    tally->lastBlock = Helper::GenerateRandom256();
+    tally->setPublicKey(creator);
+    return tally;
+}
+
+static bool selected(Mempool &mempool, Transaction *t)
+{
+    std::vector<Transaction*> out;
+    mempool.select(mempool.size(), mempool.bytes(), out);
+    return std::find(out.begin(), out.end(), t) != out.end();
+}
+
+void test_mempool()
+{
+    Log::i("(Test) # Test: Mempool");
+
+    uint256 election = Helper::GenerateRandom256();
+    CPubKey voterA = new_public_key();
+    CPubKey voterB = new_public_key();
+
+    TxVote* voteA1 = new_vote(election, voterA);
+    TxTally* tally = new_tally(voterB);
+    TxVote* voteA2 = new_vote(election, voterA);
+    add_ballot(voteA2); // differ from voteA1
+    TxVote* voteB1 = new_vote(election, voterB);
+    TxVote* voteA3 = new_vote(Helper::GenerateRandom256(), voterA);
+
+
+    // --- Lookup & duplicates ---
+
+    Mempool mempool;
+    assert(mempool.add(voteA1));
+    assert(mempool.add(tally));
+    assert(mempool.add(voteA2));
+    assert(mempool.add(voteB1));
+    assert(mempool.add(voteA3));
+    assert(!mempool.add(voteA1));
+
+    assert(mempool.size() == 5);
+    assert(mempool.bytes() > 0);
+    assert(mempool.contains(voteA2->getHash()));
+    assert(!mempool.contains(Helper::GenerateRandom256()));
+
+
+    // --- Selection (one vote per voter and election, in order of arrival) ---
+
+    std::vector<Transaction*> out;
+    mempool.select(10, mempool.bytes(), out);
+    assert(out.size() == 4);
+    assert(out[0] == voteA1 && out[1] == tally && out[2] == voteB1 && out[3] == voteA3);
+
+    mempool.select(2, mempool.bytes(), out);
+    assert(out.size() == 2);
+    assert(out[0] == voteA1 && out[1] == tally);
+
+    mempool.select(10, 1, out);
+    assert(out.size() == 1 && out[0] == voteA1);
+
+
+    // --- Assembly policy (full block or waited long enough) ---
+
+    long long now = Helper::GetUNIXTimestamp();
+    assert(mempool.isBlockDue(BlockAssemblyPolicy(mempool.bytes(), 4, 60000), now));
+    assert(mempool.isBlockDue(BlockAssemblyPolicy(1, 10, 60000), now));
+    assert(mempool.isBlockDue(BlockAssemblyPolicy(mempool.bytes() * 2, 10, 1000), now + 1000));
+    assert(!mempool.isBlockDue(BlockAssemblyPolicy(mempool.bytes() * 2, 10, 60000), now));
+    assert(!Mempool().isBlockDue(BlockAssemblyPolicy(0, 0, 0), now));
+
+    // a template being mined is only rebuilt once the block is full
+    assert(mempool.isBlockFull(BlockAssemblyPolicy(mempool.bytes(), 4, 0)));
+    assert(!mempool.isBlockFull(BlockAssemblyPolicy(mempool.bytes() * 2, 10, 0)));
+
+
+    // --- Removal (waiting vote becomes ready, caller gets the transaction) ---
+
+    assert(mempool.remove(voteA1->getHash()) == voteA1);
+    assert(mempool.remove(voteA1->getHash()) == NULL);
+    assert(selected(mempool, voteA2));
+
+    assert(mempool.remove(tally->getHash()) == tally);
+    assert(mempool.size() == 3);
+
+    // the size is measured once, along with the hash
+    assert(voteA1->getSize() > 0 && voteA1->getSize() < voteA2->getSize());
+
+    delete voteA1;
+    delete tally;
+
+
+    // --- Eviction (waiting votes first, then newest, evicted ones are deleted) ---
+
+    uint256 otherElection = Helper::GenerateRandom256();
+    TxVote* smallA1 = new_vote(otherElection, voterA);
+    TxVote* smallA2 = new_vote(otherElection, voterA);
+    add_ballot(smallA2);
+    TxTally* smallTally = new_tally(voterB);
+    TxVote* smallB1 = new_vote(otherElection, voterB);
+    TxVote* smallA3 = new_vote(Helper::GenerateRandom256(), voterA);
+    uint256 hashA2 = smallA2->getHash();
+
+    Mempool small(3);
+    assert(small.add(smallA1));
+    assert(small.add(smallA2));
+    assert(small.add(smallTally));
+    assert(small.add(smallB1));
+    assert(small.size() == 3);
+    assert(!small.contains(hashA2));
+
+    assert(!small.add(smallA3));
+    assert(small.size() == 3);
+    assert(selected(small, smallA1) && selected(small, smallTally) && selected(small, smallB1));
+
+    Mempool tiny(10, 0);
+    assert(!tiny.add(smallA3));
+    assert(tiny.size() == 0 && tiny.bytes() == 0);
+
+    // rejected transactions stay with the caller, the others with the pools
+    delete smallA3;
+}
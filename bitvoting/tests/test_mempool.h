@@ -0,0 +1,6 @@
+#ifndef TEST_MEMPOOL_H
+#define TEST_MEMPOOL_H
+
+void test_mempool();
+
+#endif // TEST_MEMPOOL_H
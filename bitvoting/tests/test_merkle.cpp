@@ -0,0 +1,76 @@
+#include "test_merkle.h"
+
+#include "helper.h"
+#include "utils/merkle.h"
+
+#include <vector>
+
+void test_merkle()
+{
+    Log::i("(Test) # Test: Merkle");
+
+    // --- Empty & single leaf ---
+
+    std::vector<uint256> leaves;
+    assert(MerkleTree::computeRoot(leaves) == 0);
+
+    leaves.push_back(Helper::GenerateRandom256());
+    uint256 single = MerkleTree::computeRoot(leaves);
+    assert(single != 0 && single != leaves[0]);
+
+    // a leaf is not hashed like an inner node
+    leaves.push_back(Helper::GenerateRandom256());
+    uint256 pair = MerkleTree::computeRoot(leaves);
+    leaves.push_back(pair);
+    leaves.erase(leaves.begin(), leaves.begin() + 2);
+    assert(MerkleTree::computeRoot(leaves) != pair);
+
+
+    // --- Proofs for every leaf of trees with different sizes ---
+
+    for (unsigned int n = 1; n <= 17; n++)
+    {
+        leaves.clear();
+        for (unsigned int i = 0; i < n; i++)
+            leaves.push_back(Helper::GenerateRandom256());
+
+        uint256 root = MerkleTree::computeRoot(leaves);
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            MerkleProof proof;
+            proof.transaction = leaves[i];
+            proof.index = i;
+            proof.leaves = n;
+            assert(MerkleTree::computeBranch(leaves, i, proof.branch));
+            assert(MerkleTree::verify(proof, root));
+
+            // wrong position
+            MerkleProof moved = proof;
+            moved.index = (i + 1) % n;
+            if (n > 1)
+                assert(!MerkleTree::verify(moved, root));
+
+            // wrong transaction
+            MerkleProof forged = proof;
+            forged.transaction = Helper::GenerateRandom256();
+            assert(!MerkleTree::verify(forged, root));
+
+            // manipulated branch
+            if (!proof.branch.empty())
+            {
+                forged = proof;
+                forged.branch.back() = Helper::GenerateRandom256();
+                assert(!MerkleTree::verify(forged, root));
+
+                forged = proof;
+                forged.branch.push_back(Helper::GenerateRandom256());
+                assert(!MerkleTree::verify(forged, root));
+            }
+        }
+
+        // out of range
+        std::vector<uint256> branch;
+        assert(!MerkleTree::computeBranch(leaves, n, branch));
+    }
+}
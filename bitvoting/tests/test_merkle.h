@@ -0,0 +1,6 @@
+#ifndef TEST_MERKLE_H
+#define TEST_MERKLE_H
+
+void test_merkle();
+
+#endif // TEST_MERKLE_H
@@ -0,0 +1,48 @@
+#include "test_miningstats.h"
+
+#include "helper.h"
+#include "miningstats.h"
+
+void test_miningstats()
+{
+    Log::i("(Test) # Test: Mining statistics");
+
+    MiningStats stats(2);
+    assert(stats.getNumThreads() == 2);
+
+    MiningStatsSnapshot empty = stats.getSnapshot();
+    assert(empty.totalHashes == 0 && empty.hashrate == 0 && empty.blocks == 0);
+    assert(empty.threadHashrates.size() == 2);
+
+    // hashes are counted per thread, rates only change on update
+    stats.addHashes(0, 1000);
+    stats.addHashes(1, 3000);
+    assert(stats.getSnapshot().totalHashes == 4000);
+    assert(stats.getSnapshot().hashrate == 0);
+
+    Helper::Sleep(20);
+    stats.update();
+
+    MiningStatsSnapshot snapshot = stats.getSnapshot();
+    assert(snapshot.threadHashrates[0] > 0);
+    assert(snapshot.threadHashrates[1] > snapshot.threadHashrates[0]);
+    assert(snapshot.hashrate == snapshot.threadHashrates[0] + snapshot.threadHashrates[1]);
+
+    // without new hashes the rate drops to zero
+    Helper::Sleep(20);
+    stats.update();
+    assert(stats.getSnapshot().hashrate == 0);
+    assert(stats.getSnapshot().totalHashes == 4000);
+
+    // time to block
+    stats.addBlock(300);
+    stats.addBlock(100);
+    stats.addBlock(200);
+
+    snapshot = stats.getSnapshot();
+    assert(snapshot.blocks == 3);
+    assert(snapshot.lastTimeToBlock == 200);
+    assert(snapshot.minTimeToBlock == 100);
+    assert(snapshot.maxTimeToBlock == 300);
+    assert(snapshot.averageTimeToBlock == 200);
+}
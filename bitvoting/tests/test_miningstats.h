@@ -0,0 +1,6 @@
+#ifndef TEST_MININGSTATS_H
+#define TEST_MININGSTATS_H
+
+void test_miningstats();
+
+#endif // TEST_MININGSTATS_H
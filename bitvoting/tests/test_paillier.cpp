@@ -2,9 +2,478 @@
 
 #include "helper.h"
 #include "paillier/paillier.h"
+#include "paillier/primes.h"
+#include "paillier/serialization.h"
 
+#include <sstream>
+
+#include <boost/archive/text_iarchive.hpp>
 #include <boost/foreach.hpp>
 
+// proofs of every version can be verified, but only with their own challenge
+static void test_paillier_versions(paillier_pubkey_t* pub, paillier_partialkey_t** prv)
+{
+    Log::i("(Test) - Proof versions");
+
+    int versions[] = { PAILLIER_PROOF_V1, PAILLIER_PROOF_V2, PAILLIER_PROOF_V3, PAILLIER_PROOF_V4,
+                       PAILLIER_PROOF_V5 };
+    BOOST_FOREACH(int version, versions)
+    {
+        paillier_ciphertext_proof_t *c = paillier_enc_proof(pub, PLAINTEXT_SELECTION::SECOND,
+                                                            paillier_get_rand_devurandom, NULL, version);
+        assert(c->version == version);
+        assert(paillier_verify_enc(pub, c));
+
+        paillier_partialdecryption_proof_t *d = paillier_dec_proof(pub, prv[0], c,
+                                                                   paillier_get_rand_devurandom, NULL, version);
+        assert(d->version == version);
+        assert(paillier_verify_decryption(pub, d));
+
+        // claiming another (or an unknown) version invalidates the proofs
+        c->version = d->version = (version == PAILLIER_PROOF_V1) ? PAILLIER_PROOF_V2 : PAILLIER_PROOF_V1;
+        assert(!paillier_verify_enc(pub, c));
+        assert(!paillier_verify_decryption(pub, d));
+
+        c->version = d->version = 0;
+        assert(!paillier_verify_enc(pub, c));
+        assert(!paillier_verify_decryption(pub, d));
+
+        paillier_freepartdecryptionproof(d);
+        paillier_freeciphertextproof(c);
+    }
+
+    // the v1 challenge is still the hash read as hex string
+    mpz_t value, e, expected;
+    mpz_init_set_str(value, "123456789abcdef0123456789abcdef", 16);
+    mpz_inits(e, expected, NULL);
+
+    std::vector<__mpz_struct> values;
+    values.push_back(value[0]);
+    assert(paillier_challenge(e, values, PAILLIER_PROOF_V1));
+    mpz_set_str(expected, hashMultiple(values).GetHex().c_str(), 16);
+    assert(mpz_cmp(e, expected) == 0);
+
+    // the transcript (v2 and later) separates the values
+    mpz_t a1, a2, b1, b2;
+    mpz_init_set_str(a1, "1234", 16);
+    mpz_init_set_str(a2, "56", 16);
+    mpz_init_set_str(b1, "12", 16);
+    mpz_init_set_str(b2, "3456", 16);
+
+    std::vector<__mpz_struct> split;
+    split.push_back(a1[0]);
+    split.push_back(a2[0]);
+    std::vector<__mpz_struct> shifted;
+    shifted.push_back(b1[0]);
+    shifted.push_back(b2[0]);
+    assert(hashMultiple(split) == hashMultiple(shifted));
+    assert(hashTranscript(split, PAILLIER_PROOF_V2) != hashTranscript(shifted, PAILLIER_PROOF_V2));
+    assert(hashTranscript(split, PAILLIER_PROOF_V2) != hashTranscript(split, PAILLIER_PROOF_V3));
+
+    mpz_clears(value, e, expected, a1, a2, b1, b2, NULL);
+}
+
+// a proof stored before proof versions were introduced (created with a fixed
+// key and fixed randomness) is still accepted as a v1 proof
+static void test_paillier_v1_known_answer()
+{
+    Log::i("(Test) - Known v1 proof");
+
+    const char* storedKey =
+        "22 serialization::archive 18 0 0 256 1 1 64 "
+        "d321962efcd285c66055343127920e6f6bae4b97b9d4a53e1f834148271ca965 128 "
+        "55768ddf24cffc5ea175a839277e852ff9083ab69f8428598aa5e4a14544a3f5"
+        "497be1b1d4c1e236c1a6bb61543e9d8d648ad412f9c25356ca53ae7bd38ca1cd 0 0 1 126 "
+        "6570659cc51dda6e832ac4d2508d5f3f0d326f99c82ea7cb9f792abf1c04eac4"
+        "971f9c6cf83590035c6f73aad350a681c5c33d2e28179072276e3939b3ecf7";
+
+    const char* storedProof =
+        "22 serialization::archive 18 0 0 128 "
+        "1b63b2aef9a8a1e40d6e2951b291d20b3ddf0584ffd430f0178583b3c067dea3"
+        "314bb6b90cafbf560491c9512e68a0f331824d58c83c1eaa2c781ec8717d7d42 64 "
+        "14a95456a8cab7b3ece4f8f391e8e3708d7db750cecd3f677dcb44160dc330cb 64 "
+        "8edfedf892bfc6b6798accc92e699474618d28560d817744e18d99fb807c783b 64 "
+        "58eafc8d12dd76c3d3af605b8b115d6b979eda927b206d60bbc0eb62b46361f5 64 "
+        "cdd93301269c27bc4c3667c9e0f87337204e19596770ad6bced74cc378226ed5 64 "
+        "2fd0842493482c7d3935698d7529a4c7ae8b00c7a4b5c3568208c40a99316f93";
+
+    paillier_pubkey_t* pub = (paillier_pubkey_t*) malloc(sizeof(paillier_pubkey_t));
+    {
+        std::istringstream stream(storedKey);
+        boost::archive::text_iarchive archive(stream);
+        archive >> *pub;
+    }
+
+    paillier_ciphertext_proof_t* c = (paillier_ciphertext_proof_t*) malloc(sizeof(paillier_ciphertext_proof_t));
+    {
+        std::istringstream stream(storedProof);
+        boost::archive::text_iarchive archive(stream);
+        archive >> *c;
+    }
+
+    assert(pub->s == 1);
+    assert(c->version == PAILLIER_PROOF_V1 && c->count == 2);
+    assert(paillier_verify_enc(pub, c));
+    assert(paillier_verify_enc_batch(pub, &c, 1, NULL, paillier_get_rand_devurandom));
+
+    // the stored challenge is bound to the ciphertext
+    mpz_add_ui(c->c, c->c, 1);
+    assert(!paillier_verify_enc(pub, c));
+
+    paillier_freeciphertextproof(c);
+    paillier_freepubkey(pub);
+}
+
+// the batch verification finds the same invalid proofs as verifying one by one
+static void test_paillier_batch(paillier_pubkey_t* pub)
+{
+    Log::i("(Test) - Batch verification");
+
+    // more than one batch, some proofs of an older version
+    const int count = 140;
+    std::vector<paillier_ciphertext_proof_t*> proofs;
+    for (int i = 0; i < count; i++)
+    {
+        int version = (i % 10 == 3) ? PAILLIER_PROOF_V2 : PAILLIER_PROOF_CURRENT;
+        PLAINTEXT_SELECTION choice = (i % 3) ? PLAINTEXT_SELECTION::FIRST : PLAINTEXT_SELECTION::SECOND;
+        proofs.push_back(paillier_enc_proof(pub, choice, paillier_get_rand_devurandom, NULL, version));
+    }
+
+    bool results[count];
+    assert(paillier_verify_enc_batch(pub, &proofs[0], count, results, paillier_get_rand_devurandom));
+    for (int i = 0; i < count; i++)
+        assert(results[i]);
+
+    assert(paillier_verify_enc_batch(pub, &proofs[0], 0, NULL, paillier_get_rand_devurandom));
+
+    // invalid responses, commitments and ciphertexts (also non-units)
+    mpz_add_ui(proofs[5]->v1, proofs[5]->v1, 1);
+    mpz_sub(proofs[17]->u2, pub->n_s1, proofs[17]->u2);
+    mpz_add_ui(proofs[13]->v2, proofs[13]->v2, 1);
+    mpz_set(proofs[70]->c, pub->n);
+    mpz_set(proofs[70]->u1, pub->n);
+    mpz_set(proofs[70]->u2, pub->n);
+    mpz_set(proofs[70]->v1, pub->n);
+    mpz_set(proofs[70]->v2, pub->n);
+    mpz_set_ui(proofs[139]->u1, 0);
+
+    assert(!paillier_verify_enc_batch(pub, &proofs[0], count, NULL, paillier_get_rand_devurandom));
+    assert(!paillier_verify_enc_batch(pub, &proofs[0], count, results, paillier_get_rand_devurandom));
+    for (int i = 0; i < count; i++)
+    {
+        bool invalid = (i == 5 || i == 13 || i == 17 || i == 70 || i == 139);
+        assert(results[i] == !invalid);
+        assert(paillier_verify_enc(pub, proofs[i]) == !invalid);
+    }
+
+    // only the valid proofs of the right plaintexts pass
+    assert(paillier_verify_enc_batch(pub, &proofs[0], 5, results, paillier_get_rand_devurandom));
+
+    paillier_plaintext_t *pt1 = paillier_plaintext_from_ui(0);
+    paillier_plaintext_t *pt2 = paillier_plaintext_from_ui(2);
+    assert(!paillier_verify_enc_batch(pub, &proofs[0], 5, pt1, pt2, results, paillier_get_rand_devurandom));
+    paillier_freeplaintext(pt1);
+    paillier_freeplaintext(pt2);
+
+    BOOST_FOREACH(paillier_ciphertext_proof_t *proof, proofs)
+        paillier_freeciphertextproof(proof);
+}
+
+// 1-out-of-k proofs are only valid for their own plaintexts, also in batches
+static void test_paillier_one_out_of_k(paillier_pubkey_t* pub, paillier_partialkey_t** prv)
+{
+    Log::i("(Test) - 1-out-of-k proofs");
+
+    const int k = 5;
+    paillier_plaintext_t* plaintexts[k];
+    for (int i = 0; i < k; i++)
+    {
+        plaintexts[i] = paillier_plaintext_from_ui(0);
+        mpz_ui_pow_ui(plaintexts[i]->m, 7, i);
+    }
+
+    const int count = 20;
+    std::vector<paillier_ciphertext_proof_t*> proofs;
+    for (int i = 0; i < count; i++)
+    {
+        paillier_ciphertext_proof_t* proof = paillier_enc_proof(pub, plaintexts, k, i % k,
+                                                                paillier_get_rand_devurandom, NULL);
+        assert(proof->count == k);
+        assert(paillier_verify_enc(pub, proof, plaintexts, k));
+
+        // the ciphertext is the encryption of the chosen plaintext
+        paillier_partialdecryption_proof_t* decryptions[3];
+        for (int j = 0; j < 3; j++)
+            decryptions[j] = paillier_dec_proof(pub, prv[j], proof, paillier_get_rand_devurandom, NULL);
+        paillier_plaintext_t* plaintext = paillier_combining(NULL, pub, decryptions);
+        assert(mpz_cmp(plaintext->m, plaintexts[i % k]->m) == 0);
+        paillier_freeplaintext(plaintext);
+        for (int j = 0; j < 3; j++)
+            paillier_freepartdecryptionproof(decryptions[j]);
+
+        proofs.push_back(proof);
+    }
+
+    // other plaintexts (or fewer of them) are not proven
+    std::swap(plaintexts[1], plaintexts[2]);
+    assert(!paillier_verify_enc(pub, proofs[0], plaintexts, k));
+    std::swap(plaintexts[1], plaintexts[2]);
+    assert(!paillier_verify_enc(pub, proofs[0], plaintexts, k - 1));
+    assert(!paillier_verify_enc(pub, proofs[0]));
+
+    // more than two plaintexts are not a proof of version 4
+    proofs[0]->version = PAILLIER_PROOF_V4;
+    assert(!paillier_verify_enc(pub, proofs[0], plaintexts, k));
+    proofs[0]->version = PAILLIER_PROOF_V5;
+
+    bool results[count];
+    assert(paillier_verify_enc_batch(pub, &proofs[0], count, plaintexts, k, results, paillier_get_rand_devurandom));
+    assert(!paillier_verify_enc_batch(pub, &proofs[0], count, plaintexts, k - 1, NULL, paillier_get_rand_devurandom));
+
+    // invalid further branches
+    mpz_add_ui(proofs[3]->ek[1], proofs[3]->ek[1], 1);
+    mpz_add_ui(proofs[8]->vk[2], proofs[8]->vk[2], 1);
+    mpz_sub(proofs[11]->uk[0], pub->n_s1, proofs[11]->uk[0]);
+
+    assert(!paillier_verify_enc_batch(pub, &proofs[0], count, plaintexts, k, results, paillier_get_rand_devurandom));
+    for (int i = 0; i < count; i++)
+    {
+        bool invalid = (i == 3 || i == 8 || i == 11);
+        assert(results[i] == !invalid);
+        assert(paillier_verify_enc(pub, proofs[i], plaintexts, k) == !invalid);
+    }
+
+    BOOST_FOREACH(paillier_ciphertext_proof_t *proof, proofs)
+        paillier_freeciphertextproof(proof);
+    for (int i = 0; i < k; i++)
+        paillier_freeplaintext(plaintexts[i]);
+}
+
+// the batch verification of partial decryptions finds the same invalid
+// proofs as verifying one by one
+static void test_paillier_decryption_batch(paillier_pubkey_t* pub, paillier_partialkey_t** prv)
+{
+    Log::i("(Test) - Batch verification of partial decryptions");
+
+    // proofs of two trustees, some of an older version
+    const int count = 12;
+    std::vector<paillier_ciphertext_proof_t*> ciphertexts;
+    std::vector<paillier_partialdecryption_proof_t*> proofs;
+    for (int i = 0; i < count; i++)
+    {
+        int version = (i % 5 == 2) ? PAILLIER_PROOF_V3 : PAILLIER_PROOF_CURRENT;
+        ciphertexts.push_back(paillier_enc_proof(pub, PLAINTEXT_SELECTION::SECOND,
+                                                 paillier_get_rand_devurandom, NULL));
+        proofs.push_back(paillier_dec_proof(pub, prv[i % 2], ciphertexts.back(),
+                                            paillier_get_rand_devurandom, NULL, version));
+    }
+
+    bool results[count];
+    assert(paillier_verify_decryption_batch(pub, &proofs[0], count, results, paillier_get_rand_devurandom));
+    for (int i = 0; i < count; i++)
+        assert(results[i]);
+
+    assert(paillier_verify_decryption_batch(pub, &proofs[0], 0, NULL, paillier_get_rand_devurandom));
+
+    // invalid responses, commitments, decryptions and trustees
+    mpz_add_ui(proofs[1]->z, proofs[1]->z, 1);
+    mpz_sub(proofs[4]->b, pub->n_s1, proofs[4]->b);
+    mpz_add_ui(proofs[6]->decryption, proofs[6]->decryption, 1);
+    mpz_set(proofs[8]->a, pub->n);
+    proofs[9]->id = pub->decryptServers + 1;
+    mpz_add_ui(proofs[7]->z, proofs[7]->z, 1);
+
+    assert(!paillier_verify_decryption_batch(pub, &proofs[0], count, NULL, paillier_get_rand_devurandom));
+    assert(!paillier_verify_decryption_batch(pub, &proofs[0], count, results, paillier_get_rand_devurandom));
+    for (int i = 0; i < count; i++)
+    {
+        bool invalid = (i == 1 || i == 4 || i == 6 || i == 7 || i == 8 || i == 9);
+        assert(results[i] == !invalid);
+        assert(paillier_verify_decryption(pub, proofs[i]) == !invalid);
+    }
+
+    // a proof of another trustee does not pass with its verification key
+    proofs[0]->id = 2;
+    assert(!paillier_verify_decryption_batch(pub, &proofs[0], 1, NULL, paillier_get_rand_devurandom));
+
+    BOOST_FOREACH(paillier_partialdecryption_proof_t *proof, proofs)
+        paillier_freepartdecryptionproof(proof);
+    BOOST_FOREACH(paillier_ciphertext_proof_t *ciphertext, ciphertexts)
+        paillier_freeciphertextproof(ciphertext);
+}
+
+// keys with s > 1 encrypt, prove and decrypt plaintexts larger than n
+static void test_paillier_damgard_jurik()
+{
+    Log::i("(Test) - Plaintexts mod n^s");
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(128, 3, 2, &pub, &prv, paillier_get_rand_devurandom, 3);
+    assert(mpz_sizeinbase(pub->n_s1, 2) > 4 * 127);
+
+    // answers 2^(100*j), all but the first larger than n
+    const int k = 4;
+    paillier_plaintext_t* plaintexts[k];
+    for (int i = 0; i < k; i++)
+    {
+        plaintexts[i] = paillier_plaintext_from_ui(0);
+        mpz_setbit(plaintexts[i]->m, 100 * i);
+    }
+
+    const int count = 10;
+    std::vector<paillier_ciphertext_proof_t*> proofs;
+    paillier_ciphertext_pure_t* sum = paillier_create_enc_zero();
+    mpz_t expected;
+    mpz_init_set_ui(expected, 0);
+    for (int i = 0; i < count; i++)
+    {
+        int index = (i * i) % k;
+        paillier_ciphertext_proof_t* proof = paillier_enc_proof(pub, plaintexts, k, index,
+                                                                paillier_get_rand_devurandom, NULL);
+        assert(paillier_verify_enc(pub, proof, plaintexts, k));
+
+        paillier_mul(pub, sum, sum, proof);
+        mpz_add(expected, expected, plaintexts[index]->m);
+        proofs.push_back(proof);
+    }
+
+    bool results[count];
+    assert(paillier_verify_enc_batch(pub, &proofs[0], count, plaintexts, k, results, paillier_get_rand_devurandom));
+
+    mpz_add_ui(proofs[2]->vk[0], proofs[2]->vk[0], 1);
+    assert(!paillier_verify_enc_batch(pub, &proofs[0], count, plaintexts, k, results, paillier_get_rand_devurandom));
+    for (int i = 0; i < count; i++)
+        assert(results[i] == (i != 2));
+
+    // the tally is decrypted by every subset of threshold trustees
+    paillier_partialdecryption_proof_t* decryptions[3];
+    for (int i = 0; i < 3; i++)
+        decryptions[i] = paillier_dec_proof(pub, prv[i], sum, paillier_get_rand_devurandom, NULL);
+    assert(paillier_verify_decryption_batch(pub, decryptions, 3, NULL, paillier_get_rand_devurandom));
+
+    paillier_partialdecryption_proof_t* subset[] = { decryptions[2], decryptions[0] };
+    paillier_plaintext_t* tally = paillier_combining(NULL, pub, decryptions);
+    assert(mpz_cmp(tally->m, expected) == 0);
+    paillier_combining(tally, pub, subset);
+    assert(mpz_cmp(tally->m, expected) == 0);
+
+    // proofs of another trustee do not pass
+    decryptions[0]->id = 2;
+    assert(!paillier_verify_decryption(pub, decryptions[0]));
+
+    paillier_freeplaintext(tally);
+    for (int i = 0; i < 3; i++)
+        paillier_freepartdecryptionproof(decryptions[i]);
+    paillier_freeciphertext(sum);
+    BOOST_FOREACH(paillier_ciphertext_proof_t *proof, proofs)
+        paillier_freeciphertextproof(proof);
+    for (int i = 0; i < k; i++)
+        paillier_freeplaintext(plaintexts[i]);
+    mpz_clear(expected);
+    paillier_freepartkeysarray(prv, 3);
+    paillier_freepubkey(pub);
+}
+
+// packed ciphertexts hold the plaintexts in disjoint digits
+static void test_paillier_pack(paillier_pubkey_t* pub, paillier_partialkey_t** prv)
+{
+    Log::i("(Test) - Packing");
+
+    // digits to the base 32: 3 at 0, 17 at 1 (two digits wide), 31 at 3
+    const unsigned long base = 32;
+    unsigned long values[] = { 3, 17, 31 };
+    unsigned int digits[] = { 1, 2, 1 };
+    paillier_ciphertext_pure_t* slots[3];
+    for (int i = 0; i < 3; i++)
+    {
+        paillier_plaintext_t* plaintexts[] = { paillier_plaintext_from_ui(0), paillier_plaintext_from_ui(values[i]) };
+        slots[i] = paillier_enc_proof(pub, plaintexts, 2, 1, paillier_get_rand_devurandom, NULL);
+        for (int j = 0; j < 2; j++)
+            paillier_freeplaintext(plaintexts[j]);
+    }
+
+    paillier_ciphertext_pure_t* packed = paillier_pack(pub, slots, digits, 3, base);
+
+    paillier_partialdecryption_proof_t* decryptions[pub->threshold];
+    for (int i = 0; i < pub->threshold; i++)
+        decryptions[i] = paillier_dec_proof(pub, prv[i], packed, paillier_get_rand_devurandom, NULL);
+
+    paillier_plaintext_t* plain = paillier_combining(NULL, pub, decryptions);
+    assert(mpz_cmp_ui(plain->m, 3 + 17 * base + 31 * base * base * base) == 0);
+
+    // the order of the slots matters
+    std::swap(slots[0], slots[2]);
+    paillier_ciphertext_pure_t* swapped = paillier_pack(pub, slots, digits, 3, base);
+    assert(mpz_cmp(swapped->c, packed->c) != 0);
+
+    paillier_freeplaintext(plain);
+    for (int i = 0; i < pub->threshold; i++)
+        paillier_freepartdecryptionproof(decryptions[i]);
+    paillier_freeciphertext(swapped);
+    paillier_freeciphertext(packed);
+    for (int i = 0; i < 3; i++)
+        paillier_freeciphertextproof((paillier_ciphertext_proof_t*) slots[i]);
+}
+
+// counts the progress reports, cancels if data is NULL
+static int progressReports = 0;
+static bool on_progress(int primesFound, unsigned long, void* data)
+{
+    assert(primesFound >= 0 && primesFound <= 2);
+    progressReports++;
+    return data != NULL;
+}
+
+// distinct safe primes of the requested size are found (or the search is cancelled)
+static void test_paillier_safe_primes()
+{
+    Log::i("(Test) - Safe primes");
+
+    mpz_t p1[3], p[3];
+    for (int i = 0; i < 3; i++)
+        mpz_inits(p1[i], p[i], NULL);
+
+    int bits = 127;
+    assert(paillier_gen_safe_primes(p1, p, 3, bits, paillier_get_rand_devurandom, NULL, NULL));
+    for (int i = 0; i < 3; i++)
+    {
+        assert(mpz_sizeinbase(p1[i], 2) == (size_t) bits);
+        assert(mpz_tstbit(p1[i], bits - 2));
+        assert(mpz_probab_prime_p(p1[i], 25));
+        assert(mpz_probab_prime_p(p[i], 25));
+
+        mpz_t temp;
+        mpz_init(temp);
+        mpz_mul_ui(temp, p1[i], 2);
+        mpz_add_ui(temp, temp, 1);
+        assert(mpz_cmp(temp, p[i]) == 0);
+        mpz_clear(temp);
+
+        for (int j = 0; j < i; j++)
+            assert(mpz_cmp(p[i], p[j]) != 0);
+    }
+
+    // the progress is reported
+    paillier_pubkey_t* pub = NULL;
+    paillier_partialkey_t** prv = NULL;
+    int dummy;
+    assert(paillier_keygen(256, 2, 2, &pub, &prv, paillier_get_rand_devurandom, &on_progress, &dummy));
+    assert(progressReports > 0);
+    assert(mpz_sizeinbase(pub->n, 2) == 256);
+    paillier_freepartkeysarray(prv, 2);
+    paillier_freepubkey(pub);
+
+    // cancelled at the first report (long before 2048 bit primes are found)
+    pub = NULL;
+    prv = NULL;
+    assert(!paillier_keygen(4096, 2, 2, &pub, &prv, paillier_get_rand_devurandom, &on_progress, NULL));
+    assert(pub == NULL && prv == NULL);
+
+    for (int i = 0; i < 3; i++)
+        mpz_clears(p1[i], p[i], NULL);
+}
+
 void test_pailler()
 {
     Log::i("(Test) # Test: Paillier");
@@ -56,6 +525,23 @@ void test_pailler()
     }
 
 
+    // The ciphertext of a proof equals the plain encryption
+    // (with the same blinding factor)
+    const char* r_hex = "123456789abcdef";
+    paillier_ciphertext_proof_t *withProof = paillier_enc_proof(pub, pt1, pt2, SECOND, paillier_get_rand_devurandom, r_hex);
+    mpz_t r;
+    mpz_init(r);
+    gmp_randstate_t rand;
+    gmp_randinit_default(rand);
+    paillier_ciphertext_pure_t *plain = paillier_enc(NULL, r, pub, pt2, rand, r_hex);
+    assert(mpz_cmp(withProof->c, plain->c) == 0);
+    assert(paillier_verify_enc(pub, withProof, pt1, pt2));
+    paillier_freeciphertext(plain);
+    paillier_freeciphertextproof(withProof);
+    gmp_randclear(rand);
+    mpz_clear(r);
+
+
     // --- Use Homomrphic Property To Add Up ---
 
     paillier_ciphertext_pure_t *sum = paillier_create_enc_zero();
@@ -117,6 +603,40 @@ void test_pailler()
     mpz_init_set_ui(targetResult, targetSum);
     assert(mpz_cmp(result->m, targetResult) == 0);
 
+    // Any subset of threshold trustees (in any order) gives the same result
+    int subsets[][3] = { {3, 1, 0}, {1, 2, 3}, {0, 2, 3} };
+    for (int i = 0; i < 3; i++)
+    {
+        int ids[3];
+        paillier_partialdecryption_proof_t* subset[3];
+        for (int j = 0; j < threshold; j++)
+        {
+            subset[j] = partialDecryptions[subsets[i][j]];
+            ids[j] = subset[j]->id;
+        }
+
+        paillier_combiner_t *combiner = paillier_create_combiner(pub, ids);
+        paillier_plaintext_t *combined = paillier_combining(NULL, pub, combiner, subset);
+        assert(mpz_cmp(combined->m, targetResult) == 0);
+
+        // the coefficients are reused for other decryptions of the same trustees
+        paillier_combining(combined, pub, combiner, subset);
+        assert(mpz_cmp(combined->m, targetResult) == 0);
+
+        paillier_freeplaintext(combined);
+        paillier_freecombiner(combiner);
+    }
+
+
+    test_paillier_versions(pub, prv);
+    test_paillier_v1_known_answer();
+    test_paillier_batch(pub);
+    test_paillier_one_out_of_k(pub, prv);
+    test_paillier_decryption_batch(pub, prv);
+    test_paillier_damgard_jurik();
+    test_paillier_pack(pub, prv);
+    test_paillier_safe_primes();
+
 
     // --- Clean up ---
 
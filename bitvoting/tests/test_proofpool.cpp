@@ -0,0 +1,73 @@
+#include "test_proofpool.h"
+
+#include "helper.h"
+#include "proofpool.h"
+#include "paillier/paillier.h"
+
+#include <boost/thread.hpp>
+
+void test_proofpool()
+{
+    Log::i("(Test) # Test: Proof pool");
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(256, 3, 2, &pub, &prv, paillier_get_rand_devurandom);
+
+    uint256 election = Helper::GenerateRandom256();
+    uint256 unknown = Helper::GenerateRandom256();
+
+    // filled explicitly up to its capacity
+    ProofPool pool(NULL, 3);
+    assert(!pool.fillNext());
+
+    pool.add(election, pub);
+    assert(pool.size(election) == 0);
+    while (pool.fillNext());
+    assert(pool.size(election) == 3);
+
+    // precomputed encryptions are taken from the pool and verify
+    paillier_enc_precomputation_t* pre = pool.take(election, pub);
+    assert(pool.size(election) == 2);
+    paillier_ciphertext_proof_t* cipher = paillier_enc_proof_precomputed(pub, SECOND, pre);
+    paillier_freeencprecomputation(pre);
+    assert(paillier_verify_enc(pub, cipher));
+    paillier_freeciphertextproof(cipher);
+
+    // or computed on the spot
+    pre = pool.take(unknown, pub);
+    cipher = paillier_enc_proof_precomputed(pub, FIRST, pre);
+    paillier_freeencprecomputation(pre);
+    assert(paillier_verify_enc(pub, cipher));
+    paillier_freeciphertextproof(cipher);
+    assert(pool.size(unknown) == 0);
+
+    pool.remove(election);
+    assert(pool.size(election) == 0);
+    assert(!pool.fillNext());
+
+    // filled in the background
+    boost::thread_group threadGroup;
+    {
+        ProofPool background(&threadGroup, 4);
+        background.add(election, pub);
+
+        long long start = Helper::GetUNIXTimestamp();
+        while (background.size(election) < 4 && Helper::GetUNIXTimestamp() - start < 10000)
+            Helper::Sleep(10);
+        assert(background.size(election) == 4);
+
+        // refilled after taking
+        paillier_freeencprecomputation(background.take(election, pub));
+        start = Helper::GetUNIXTimestamp();
+        while (background.size(election) < 4 && Helper::GetUNIXTimestamp() - start < 10000)
+            Helper::Sleep(10);
+        assert(background.size(election) == 4);
+
+        threadGroup.interrupt_all();
+        threadGroup.join_all();
+    }
+
+    paillier_freepartkeysarray(prv, pub->decryptServers);
+    paillier_freepubkey(pub);
+}
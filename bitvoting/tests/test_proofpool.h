@@ -0,0 +1,6 @@
+#ifndef TEST_PROOFPOOL_H
+#define TEST_PROOFPOOL_H
+
+void test_proofpool();
+
+#endif // TEST_PROOFPOOL_H
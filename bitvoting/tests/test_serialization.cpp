@@ -69,6 +69,43 @@ void test_serialization_paillier()
 
     assert(*publicKey1 == *publicKey2);
 
+    // keys with larger plaintexts (see paillier_pubkey_t) keep them
+    paillier_pubkey_t* publicKey3 = NULL;
+    paillier_partialkey_t** privateKeys3 = NULL;
+    paillier_keygen(128, 1, 1, &publicKey3, &privateKeys3, paillier_get_rand_devurandom, 2);
+
+    serialize(publicKey3);
+    paillier_pubkey_t* publicKey4 = NULL;
+    deserialize(&publicKey4);
+
+    assert(publicKey4->s == 2);
+    assert(*publicKey3 == *publicKey4);
+
+    // keys with an invalid s are rejected when loaded
+    int levels[] = { 0, -1, PAILLIER_MAX_S + 1 };
+    for (int i = 0; i < 3; i++)
+    {
+        publicKey3->s = levels[i];
+        serialize(publicKey3);
+
+        bool rejected = false;
+        paillier_pubkey_t* publicKey5 = NULL;
+        try
+        {
+            deserialize(&publicKey5);
+        }
+        catch (boost::archive::archive_exception&)
+        {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+    publicKey3->s = 2;
+
+    paillier_freepubkey(publicKey3);
+    paillier_freepubkey(publicKey4);
+    paillier_freepartkeysarray(privateKeys3, 1);
+
     // check private keys
     for (int i = 0; i < n; i++)
     {
@@ -90,6 +127,27 @@ void test_serialization_paillier()
 
     assert(*cipher1 == *cipher2);
 
+    // proofs with an invalid number of plaintexts are rejected when loaded
+    int counts[] = { 0, 1, -1000 };
+    for (int i = 0; i < 3; i++)
+    {
+        cipher1->count = counts[i];
+        serialize(*cipher1);
+
+        bool rejected = false;
+        paillier_ciphertext_proof_t* cipher3 = NULL;
+        try
+        {
+            deserialize(&cipher3);
+        }
+        catch (boost::archive::archive_exception&)
+        {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+    cipher1->count = 2;
+
     // check partial decryption
     paillier_partialdecryption_proof_t* proof1 = paillier_dec_proof(publicKey1, privateKeys1[0], cipher1, paillier_get_rand_devurandom, NULL);
 
@@ -109,6 +167,48 @@ void test_serialization_paillier()
     paillier_freepartdecryptionproof(proof2);
 }
 
+// ----------------------------------------------------------------------------
+
+#include "transactions/tally.h"
+
+void test_serialization_transactions()
+{
+    Log::i("(Test) - Transactions");
+
+    SignKeyPair skp;
+    assert(SignKeyStore::genNewSignKeyPair(Role::KEY_ELECTION, skp));
+    SignKeyStore::removeSignKeyPair(skp.second.GetID()); // revert auto add to db
+
+    TxTally* tally1 = new TxTally();
+    tally1->election = Helper::GenerateRandom256();
+    tally1->lastBlock = Helper::GenerateRandom256();
+    assert(tally1->sign(skp));
+
+    uint256 hash = tally1->getHash();
+    assert(tally1->verifySignature());
+
+    // the hash is cached, until it is invalidated
+    tally1->endElection = true;
+    assert(tally1->getHash() == hash);
+    tally1->invalidateHash();
+    assert(tally1->getHash() != hash);
+    tally1->endElection = false;
+    tally1->invalidateHash();
+    assert(tally1->getHash() == hash);
+
+    // loaded transactions hash their own fields
+    Transaction* t1 = tally1;
+    serialize(t1);
+    Transaction* t2 = NULL;
+    deserialize(&t2);
+
+    assert(t2->getHash() == hash);
+    assert(t2->verifySignature());
+
+    delete tally1;
+    delete t2;
+}
+
 // ============================================================================
 
 void test_serialization()
@@ -118,4 +218,5 @@ void test_serialization()
     test_serialization_uints();
     test_serialization_keys();
     test_serialization_paillier();
+    test_serialization_transactions();
 }
@@ -0,0 +1,55 @@
+#include "test_sha256.h"
+
+#include "block.h"
+#include "helper.h"
+#include "utils/sha256.h"
+
+#include <boost/foreach.hpp>
+
+void test_sha256()
+{
+    Log::i("(Test) # Test: SHA-256 nonce scanner");
+
+    // random header
+    BlockHeader header;
+    header.hashPrevBlock = Helper::GenerateRandom256();
+    header.hashMerkleRoot = Helper::GenerateRandom256();
+    header.miner = Helper::GenerateRandom160();
+    header.time = Helper::GetUNIXTimestamp();
+    header.bits = Helper::GenerateRandomUInt();
+
+    unsigned char data[BLOCK_HEADER_SIZE];
+    header.toBinary(data);
+
+    HeaderMidstate midstate;
+    NonceScanner::prepare(data, midstate);
+
+    NonceScanner::Kernel kernels[] = { NonceScanner::KERNEL_SCALAR,
+                                       NonceScanner::KERNEL_SSE4,
+                                       NonceScanner::KERNEL_AVX2 };
+
+    // every supported kernel has to match the plain header hash
+    // (including nonces wrapping around)
+    BOOST_FOREACH(NonceScanner::Kernel kernel, kernels)
+    {
+        if (!NonceScanner::setKernel(kernel))
+            continue;
+
+        Log::i("(Test) - Kernel: %s", NonceScanner::kernelName());
+
+        unsigned int lanes = NonceScanner::lanes();
+        uint256 hashes[NONCE_SCANNER_MAX_LANES];
+        for (unsigned int nonce = 0xFFFFFFF0; nonce != 0x10; nonce += lanes)
+        {
+            assert(NonceScanner::scan(midstate, nonce, hashes) == lanes);
+
+            for (unsigned int l = 0; l < lanes; l++)
+            {
+                header.nonce = nonce + l;
+                assert(hashes[l] == header.getHash());
+            }
+        }
+    }
+
+    assert(NonceScanner::setKernel(NonceScanner::KERNEL_AUTO));
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_SHA256_H
+#define TEST_SHA256_H
+
+void test_sha256();
+
+#endif // TEST_SHA256_H
@@ -0,0 +1,646 @@
+#include "test_tally.h"
+
+#include "helper.h"
+#include "election.h"
+#include "electionmanager.h"
+#include "miner.h"
+#include "store.h"
+#include "database/blockchaindb.h"
+#include "utils/difficulty.h"
+#include "paillier/paillier.h"
+#include "transactions/election.h"
+#include "transactions/tally.h"
+#include "transactions/trustee_tally.h"
+#include "transactions/vote.h"
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+// marks the given index as done
+static void markDone(std::vector<int> &done, unsigned int index)
+{
+    done[index]++;
+}
+
+// signs the given transaction with a new key
+static void sign(Transaction* transaction, Role role)
+{
+    SignKeyPair skp;
+    SignKeyStore::genNewSignKeyPair(role, skp);
+    transaction->sign(skp);
+    SignKeyStore::removeSignKeyPair(skp.second.GetID()); // revert auto add to db
+}
+
+// appends a block with the given transactions to the chain
+static Block* append_block(std::set<Transaction*, pt_cmp> transactions)
+{
+    Block* block = new Block();
+    block->header.hashPrevBlock = BlockChainDB::getLatestBlockHash();
+    block->header.time = Helper::GetUNIXTimestamp();
+    block->header.bits = Difficulty::getInitialBits();
+    block->transactions = transactions;
+    block->header.hashMerkleRoot = Miner::hashTransactions(block->transactions);
+
+    SignKeyPair skp;
+    SignKeyStore::genNewSignKeyPair(Role::KEY_MINING, skp);
+    block->sign(skp);
+    SignKeyStore::removeSignKeyPair(skp.second.GetID());
+
+    assert(BlockChainDB::addBlock(block) == BlockChainStatus::BC_OK);
+    return block;
+}
+
+// creates a vote of the given voter for all questions
+static TxVote* create_vote(TxElection* txElection, SignKeyPair &voter)
+{
+    TxVote* vote = new TxVote();
+    vote->election = txElection->getHash();
+
+    BOOST_FOREACH(const Question &question, txElection->election->questions)
+    {
+        EncryptedBallot ballot;
+        ballot.questionID = question.id;
+        PLAINTEXT_SELECTION choice = (Helper::GenerateRandom() > 0.5) ? FIRST : SECOND;
+        ballot.answer = paillier_enc_proof(txElection->election->encPubKey, choice, paillier_get_rand_devurandom, NULL);
+        vote->ballots.insert(ballot);
+    }
+
+    vote->sign(voter);
+    return vote;
+}
+
+// the answers of a question with more than two answers are counted in
+// the digits of one plaintext
+static void test_packed_tally()
+{
+    Log::i("(Test) - Packed answers");
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(256, 3, 2, &pub, &prv, paillier_get_rand_devurandom);
+
+    Election election;
+    election.encPubKey = pub;
+    for (int i = 0; i < 20; i++)
+        election.voters.insert(CKeyID(Helper::GenerateRandom160()));
+
+    Answers answers = { "A", "B", "C", "D" };
+    Question question("Question #1", answers);
+    election.questions.push_back(question);
+    unsigned long base = election.getBase();
+    assert(base == 21);
+
+    // the tally has to fit into a plaintext of the key
+    assert(question.fits(base, pub));
+    for (int i = 0; i < 80; i++)
+        answers.push_back("X");
+    Question large("Question #2", answers);
+    assert(!large.fits(base, pub));
+
+    // unless the key has larger plaintexts (see Election::getPlaintextLevel)
+    assert(election.getPlaintextLevel(256) == 1);
+    election.questions.push_back(large);
+    int level = election.getPlaintextLevel(256);
+    assert(level == 2);
+    election.questions.pop_back();
+
+    paillier_pubkey_t* pubLarge;
+    paillier_partialkey_t** prvLarge;
+    paillier_keygen(256, 1, 1, &pubLarge, &prvLarge, paillier_get_rand_devurandom, level);
+    assert(large.fits(base, pubLarge));
+    paillier_freepartkeysarray(prvLarge, 1);
+    paillier_freepubkey(pubLarge);
+
+    // every voter answers once, the last two ballots are invalid
+    std::vector<paillier_plaintext_t*> plaintexts = question.getPlaintexts(base);
+    assert(plaintexts.size() == 4);
+    assert(mpz_cmp_ui(plaintexts[0]->m, 1) == 0 && mpz_cmp_ui(plaintexts[3]->m, 21 * 21 * 21) == 0);
+
+    std::vector<unsigned long> expected(4, 0);
+    std::multiset<EncryptedBallot> ballots;
+    for (int i = 0; i < 22; i++)
+    {
+        int answer = (i * 7) % 4;
+        EncryptedBallot ballot;
+        ballot.questionID = question.id;
+
+        if (i == 20)
+        {
+            // a proof of 0 or 1 does not prove one of the answers
+            ballot.answer = paillier_enc_proof(pub, SECOND, paillier_get_rand_devurandom, NULL);
+        }
+        else
+        {
+            ballot.answer = paillier_enc_proof(pub, &plaintexts[0], plaintexts.size(), answer,
+                                               paillier_get_rand_devurandom, NULL);
+            assert(ballot.answer->count == 4);
+            assert(paillier_verify_enc(pub, ballot.answer, &plaintexts[0], plaintexts.size()));
+
+            if (i == 21)
+                mpz_add_ui(ballot.answer->vk[0], ballot.answer->vk[0], 1);
+            else
+                expected[answer]++;
+        }
+
+        ballots.insert(ballot);
+    }
+
+    // one ciphertext for the question, decrypted and unpacked
+    std::map<uint160, paillier_ciphertext_pure_t*> combinations = ElectionManager::combineBallots(&election, ballots);
+    assert(combinations.size() == 1);
+
+    paillier_partialdecryption_proof_t* decryptions[2];
+    for (int i = 0; i < 2; i++)
+        decryptions[i] = paillier_dec_proof(pub, prv[i], combinations[question.id], paillier_get_rand_devurandom, NULL);
+
+    paillier_plaintext_t* tally = paillier_combining(NULL, pub, decryptions);
+    assert(question.getCounts(tally, base) == expected);
+
+    // yes/no questions keep their plaintexts and tally
+    Question yesNo("Question #3");
+    std::vector<paillier_plaintext_t*> binary = yesNo.getPlaintexts(base);
+    assert(mpz_cmp_ui(binary[0]->m, 0) == 0 && mpz_cmp_ui(binary[1]->m, 1) == 0);
+    assert(yesNo.getCounts(binary[1], base) == std::vector<unsigned long>(1, 1));
+
+    BOOST_FOREACH(paillier_plaintext_t* plaintext, binary)
+        paillier_freeplaintext(plaintext);
+    BOOST_FOREACH(paillier_plaintext_t* plaintext, plaintexts)
+        paillier_freeplaintext(plaintext);
+    BOOST_FOREACH(const EncryptedBallot &ballot, ballots)
+        paillier_freeciphertextproof(ballot.answer);
+    for (int i = 0; i < 2; i++)
+        paillier_freepartdecryptionproof(decryptions[i]);
+    paillier_freeplaintext(tally);
+    paillier_freeciphertext(combinations[question.id]);
+    paillier_freepartkeysarray(prv, pub->decryptServers);
+    paillier_freepubkey(pub);
+}
+
+// the questions of a packed election share the digits of one tally
+static void test_packed_questions()
+{
+    Log::i("(Test) - Packed questions");
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(256, 3, 2, &pub, &prv, paillier_get_rand_devurandom);
+
+    Election election;
+    election.encPubKey = pub;
+    election.packed = true;
+    for (int i = 0; i < 20; i++)
+        election.voters.insert(CKeyID(Helper::GenerateRandom160()));
+
+    // digits of 5 bits hold the up to 20 ballots of an answer
+    unsigned long base = election.getBase();
+    assert(base == 32);
+
+    Answers answers = { "A", "B", "C", "D" };
+    election.questions.push_back(Question("Question #1"));
+    election.questions.push_back(Question("Question #2"));
+    election.questions.push_back(Question("Question #3", answers));
+    election.questions.push_back(Question("Question #4"));
+
+    std::map<uint160, QuestionSlot> slots = election.getSlots();
+    unsigned int offsets[] = { 0, 1, 2, 6 };
+    for (unsigned int i = 0; i < election.questions.size(); i++)
+    {
+        const QuestionSlot &slot = slots[election.questions[i].id];
+        assert(slot.pack == election.questions[0].id);
+        assert(slot.offset == offsets[i]);
+    }
+
+    // every voter answers all questions (or abstains), in one packed ballot
+    TxElection txElection(&election);
+    ElectionManager manager(&txElection);
+    std::map<uint160, std::vector<unsigned long>> expected;
+    std::multiset<EncryptedBallot> ballots;
+    for (int i = 0; i < 20; i++)
+    {
+        std::set<Ballot> votes;
+        BOOST_FOREACH(const Question &question, election.questions)
+        {
+            Ballot ballot;
+            ballot.questionID = question.id;
+            ballot.answer = (i % 5 == 0) ? -1 : (i * 7 + question.answers.size()) % question.answers.size();
+            votes.insert(ballot);
+
+            std::vector<unsigned long> &counts = expected[question.id];
+            counts.resize(question.getDigits(), 0);
+            if (ballot.answer == -1)
+                continue;
+
+            if (question.answers.size() > 2)
+                counts[ballot.answer]++;
+            else
+                counts[0] += ballot.answer;
+        }
+
+        TxVote* vote = NULL;
+        assert(manager.createVote(votes, &vote) == VotingResult::OK);
+        assert(vote->ballots.size() == 1);
+
+        const EncryptedBallot &ballot = *vote->ballots.begin();
+        assert(ballot.questionID == election.questions[0].id);
+        assert(!ballot.answer && ballot.slots.size() == 4);
+
+        ballots.insert(ballot);
+        delete vote;
+    }
+
+    // packed ballots with an answer besides their slots, or with an
+    // invalid slot, are dropped
+    std::set<Ballot> abstain;
+    BOOST_FOREACH(const Question &question, election.questions)
+    {
+        Ballot ballot;
+        ballot.questionID = question.id;
+        abstain.insert(ballot);
+    }
+
+    std::vector<const EncryptedBallot*> invalid;
+    EncryptedBallot tampered[2];
+    for (int i = 0; i < 2; i++)
+    {
+        TxVote* vote = NULL;
+        assert(manager.createVote(abstain, &vote) == VotingResult::OK);
+        tampered[i] = *vote->ballots.begin();
+        delete vote;
+    }
+
+    // a yes, which would be counted instead of the slots
+    tampered[0].answer = paillier_enc_proof(pub, SECOND, paillier_get_rand_devurandom, NULL);
+
+    // a digit of 2 in a yes/no slot
+    paillier_plaintext_t* digits[] = { paillier_plaintext_from_ui(0), paillier_plaintext_from_ui(2) };
+    paillier_freeciphertextproof(tampered[1].slots[0]);
+    tampered[1].slots[0] = paillier_enc_proof(pub, digits, 2, 1, paillier_get_rand_devurandom, NULL);
+
+    for (int i = 0; i < 2; i++)
+    {
+        invalid.push_back(&tampered[i]);
+        ballots.insert(tampered[i]);
+    }
+
+    std::vector<bool> valid = ElectionManager::checkBallots(&election, invalid);
+    assert(!valid[0] && !valid[1]);
+
+    // one ciphertext for all questions, decrypted once and unpacked
+    std::map<uint160, paillier_ciphertext_pure_t*> packs = ElectionManager::combineBallots(&election, ballots);
+    assert(packs.size() == 1 && packs.count(election.questions[0].id));
+
+    paillier_partialdecryption_proof_t* decryptions[2];
+    for (int i = 0; i < 2; i++)
+        decryptions[i] = paillier_dec_proof(pub, prv[i], packs.begin()->second, paillier_get_rand_devurandom, NULL);
+
+    paillier_plaintext_t* tally = paillier_combining(NULL, pub, decryptions);
+    BOOST_FOREACH(const Question &question, election.questions)
+        assert(question.getCounts(tally, base, slots[question.id].offset) == expected[question.id]);
+
+    // a pack takes as many digits as fit into a plaintext
+    unsigned int capacity = (mpz_sizeinbase(pub->n_s, 2) - 1) / 5;
+    election.questions.clear();
+    for (int i = 0; i < 60; i++)
+        election.questions.push_back(Question("Question #" + std::to_string(i)));
+
+    slots = election.getSlots();
+    for (unsigned int i = 0; i < election.questions.size(); i++)
+    {
+        const QuestionSlot &slot = slots[election.questions[i].id];
+        assert(slot.pack == election.questions[i - i % capacity].id);
+        assert(slot.offset == i % capacity);
+    }
+
+    // otherwise, every question is counted on its own
+    election.packed = false;
+    assert(election.getBase() == 21);
+    slots = election.getSlots();
+    BOOST_FOREACH(const Question &question, election.questions)
+        assert(slots[question.id].pack == question.id && slots[question.id].offset == 0);
+
+    for (int i = 0; i < 2; i++)
+        paillier_freeplaintext(digits[i]);
+    BOOST_FOREACH(const EncryptedBallot &ballot, ballots)
+    {
+        if (ballot.answer)
+            paillier_freeciphertextproof(ballot.answer);
+        BOOST_FOREACH(paillier_ciphertext_proof_t* slot, ballot.slots)
+            paillier_freeciphertextproof(slot);
+    }
+    for (int i = 0; i < 2; i++)
+        paillier_freepartdecryptionproof(decryptions[i]);
+    paillier_freeplaintext(tally);
+    paillier_freeciphertext(packs.begin()->second);
+    paillier_freepartkeysarray(prv, pub->decryptServers);
+    paillier_freepubkey(pub);
+}
+
+// the running tally equals the product of the latest votes
+static void test_running_tally()
+{
+    Log::i("(Test) - Running tally");
+
+    BlockChainDB::clear();
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(256, 2, 2, &pub, &prv, paillier_get_rand_devurandom);
+
+    Election* election = new Election();
+    election->name = "Running Tally";
+    election->questions.push_back(Question("Question #1"));
+    election->questions.push_back(Question("Question #2"));
+    election->encPubKey = pub;
+
+    TxElection* txElection = new TxElection(election);
+    sign(txElection, Role::KEY_ELECTION);
+
+    std::set<Transaction*, pt_cmp> transactions;
+    transactions.insert(txElection);
+    Block* first = append_block(transactions);
+
+    ElectionManager manager(txElection);
+    manager.startRunningTally(1);
+
+    SignKeyPair voters[3];
+    for (int i = 0; i < 3; i++)
+    {
+        SignKeyStore::genNewSignKeyPair(Role::KEY_VOTE, voters[i]);
+        SignKeyStore::removeSignKeyPair(voters[i].second.GetID());
+    }
+
+    // two voters
+    TxVote* votes[] = { create_vote(txElection, voters[0]), create_vote(txElection, voters[1]) };
+    transactions.clear();
+    transactions.insert(votes[0]);
+    transactions.insert(votes[1]);
+    Block* second = append_block(transactions);
+    assert(manager.countVotes(second, 2));
+    assert(!manager.countVotes(second, 2));
+
+    // no votes of the election
+    TxVote* other = create_vote(txElection, voters[2]);
+    other->election = Helper::GenerateRandom256();
+    sign(other, Role::KEY_VOTE);
+    transactions.clear();
+    transactions.insert(other);
+    Block* third = append_block(transactions);
+    assert(!manager.countVotes(third, 3));
+
+    // the first voter votes again, a new voter joins
+    TxVote* latest[] = { create_vote(txElection, voters[0]), create_vote(txElection, voters[2]) };
+    transactions.clear();
+    transactions.insert(latest[0]);
+    transactions.insert(latest[1]);
+    Block* fourth = append_block(transactions);
+    assert(manager.countVotes(fourth, 4));
+
+    // compare with the products of the counted votes after every block
+    std::vector<TxVote*> expected[4];
+    expected[1].push_back(votes[0]);
+    expected[1].push_back(votes[1]);
+    expected[2] = expected[1];
+    expected[3].push_back(votes[1]);
+    expected[3].push_back(latest[0]);
+    expected[3].push_back(latest[1]);
+
+    Block* blocks[] = { first, second, third, fourth };
+    for (int i = 0; i < 4; i++)
+    {
+        std::map<uint160, paillier_ciphertext_pure_t*> sums;
+        assert(manager.getRunningTally(blocks[i]->getHash(), sums));
+        assert(sums.size() == (expected[i].empty() ? 0 : 2));
+
+        std::map<uint160, paillier_ciphertext_pure_t*>::iterator iter;
+        for (iter = sums.begin(); iter != sums.end(); iter++)
+        {
+            paillier_ciphertext_pure_t* product = paillier_create_enc_zero();
+            BOOST_FOREACH(TxVote* vote, expected[i])
+            {
+                BOOST_FOREACH(const EncryptedBallot &ballot, vote->ballots)
+                {
+                    if (ballot.questionID == iter->first)
+                        paillier_mul(pub, product, product, ballot.answer);
+                }
+            }
+
+            assert(mpz_cmp(iter->second->c, product->c) == 0);
+            paillier_freeciphertext(product);
+            paillier_freeciphertext(iter->second);
+        }
+    }
+
+    // unknown block
+    std::map<uint160, paillier_ciphertext_pure_t*> sums;
+    assert(!manager.getRunningTally(Helper::GenerateRandom256(), sums));
+
+    // a block with an invalid ballot stops the running tally
+    TxVote* invalid = create_vote(txElection, voters[1]);
+    paillier_ciphertext_proof_t* answer = invalid->ballots.begin()->answer;
+    mpz_add_ui(answer->v1, answer->v1, 1);
+    sign(invalid, Role::KEY_VOTE);
+    transactions.clear();
+    transactions.insert(invalid);
+    Block* fifth = append_block(transactions);
+    assert(manager.countVotes(fifth, 5));
+    assert(!manager.getRunningTally(fourth->getHash(), sums));
+    assert(!manager.countVotes(fifth, 5));
+
+    paillier_freepartkeysarray(prv, pub->decryptServers);
+    BlockChainDB::clear();
+}
+
+// a vote replayed by another voter is counted twice on both paths of a
+// trustee tally, i.e. the running tally and all votes of the chain
+static void test_replayed_votes()
+{
+    Log::i("(Test) - Replayed votes");
+
+    BlockChainDB::clear();
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(256, 2, 2, &pub, &prv, paillier_get_rand_devurandom);
+
+    Election* election = new Election();
+    election->name = "Replayed Votes";
+    election->questions.push_back(Question("Question #1"));
+    election->encPubKey = pub;
+
+    TxElection* txElection = new TxElection(election);
+    sign(txElection, Role::KEY_ELECTION);
+
+    std::set<Transaction*, pt_cmp> transactions;
+    transactions.insert(txElection);
+    append_block(transactions);
+
+    SignKeyPair voters[2];
+    for (int i = 0; i < 2; i++)
+    {
+        SignKeyStore::genNewSignKeyPair(Role::KEY_VOTE, voters[i]);
+        SignKeyStore::removeSignKeyPair(voters[i].second.GetID());
+    }
+
+    // the second voter publishes the ballots of the first one
+    TxVote* vote = create_vote(txElection, voters[0]);
+    TxVote* replay = new TxVote();
+    replay->election = vote->election;
+    replay->ballots = vote->ballots;
+    replay->sign(voters[1]);
+
+    transactions.clear();
+    transactions.insert(vote);
+    transactions.insert(replay);
+    Block* second = append_block(transactions);
+
+    ElectionManager counting(txElection);
+    counting.startRunningTally(1);
+    assert(counting.countVotes(second, 2));
+
+    ElectionManager collecting(txElection);
+
+    TxTally tally;
+    tally.election = txElection->getHash();
+    tally.lastBlock = second->getHash();
+
+    TxTrusteeTally* fromSnapshot = NULL;
+    TxTrusteeTally* fromChain = NULL;
+    assert(counting.createTrusteeTally(&tally, prv[0], &fromSnapshot));
+    assert(collecting.createTrusteeTally(&tally, prv[0], &fromChain));
+
+    // the same partial decryptions, both of the doubled ballot
+    assert(fromSnapshot->partialDecryption.size() == 1 && fromChain->partialDecryption.size() == 1);
+    paillier_partialdecryption_proof_t* snapshotDecryption = fromSnapshot->partialDecryption.begin()->answers;
+    paillier_partialdecryption_proof_t* chainDecryption = fromChain->partialDecryption.begin()->answers;
+    assert(mpz_cmp(snapshotDecryption->decryption, chainDecryption->decryption) == 0);
+
+    paillier_ciphertext_pure_t* doubled = paillier_create_enc_zero();
+    paillier_ciphertext_proof_t* answer = vote->ballots.begin()->answer;
+    paillier_mul(pub, doubled, answer, answer);
+    paillier_partialdecryption_proof_t* expected = paillier_dec_proof(pub, prv[0], doubled, paillier_get_rand_devurandom, NULL);
+    assert(mpz_cmp(expected->decryption, snapshotDecryption->decryption) == 0);
+
+    paillier_freepartdecryptionproof(expected);
+    paillier_freeciphertext(doubled);
+    paillier_freepartdecryptionproof(snapshotDecryption);
+    paillier_freepartdecryptionproof(chainDecryption);
+    delete fromSnapshot;
+    delete fromChain;
+    paillier_freepartkeysarray(prv, pub->decryptServers);
+    BlockChainDB::clear();
+}
+
+// the verified partial decryptions of a trustee tally are only remembered
+// for the same contents and key
+static void test_trustee_decryptions()
+{
+    Log::i("(Test) - Trustee decryptions");
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(256, 3, 2, &pub, &prv, paillier_get_rand_devurandom);
+
+    paillier_pubkey_t* other;
+    paillier_partialkey_t** otherPrv;
+    paillier_keygen(256, 3, 2, &other, &otherPrv, paillier_get_rand_devurandom);
+
+    paillier_ciphertext_proof_t* ballot = paillier_enc_proof(pub, SECOND, paillier_get_rand_devurandom, NULL);
+
+    TalliedBallots decryption;
+    decryption.questionID = Helper::GenerateRandom160();
+    decryption.answers = paillier_dec_proof(pub, prv[0], ballot, paillier_get_rand_devurandom, NULL);
+
+    TxTrusteeTally trusteeTally;
+    trusteeTally.partialDecryption.insert(decryption);
+    assert(trusteeTally.verifyDecryptions(pub));
+    assert(trusteeTally.verifyDecryptions(pub));
+    assert(!trusteeTally.verifyDecryptions(other));
+
+    // a changed decryption is verified again
+    mpz_add_ui(decryption.answers->decryption, decryption.answers->decryption, 1);
+    trusteeTally.invalidateHash();
+    assert(!trusteeTally.verifyDecryptions(pub));
+
+    paillier_freepartdecryptionproof(decryption.answers);
+    paillier_freeciphertextproof(ballot);
+    paillier_freepartkeysarray(otherPrv, other->decryptServers);
+    paillier_freepubkey(other);
+    paillier_freepartkeysarray(prv, pub->decryptServers);
+    paillier_freepubkey(pub);
+}
+
+void test_tally()
+{
+    Log::i("(Test) # Test: Tally");
+
+    // every index is worked on exactly once
+    std::vector<int> done(1000, 0);
+    Helper::ParallelFor(done.size(), boost::bind(&markDone, boost::ref(done), _1));
+    BOOST_FOREACH(int count, done)
+        assert(count == 1);
+
+    Helper::ParallelFor(0, boost::bind(&markDone, boost::ref(done), _1));
+
+    paillier_pubkey_t* pub;
+    paillier_partialkey_t** prv;
+    paillier_keygen(256, 3, 2, &pub, &prv, paillier_get_rand_devurandom);
+
+    // many ballots (more than one chunk) for the first question, some of
+    // them invalid, a few for the second and only invalid ones for the third
+    Election election;
+    election.encPubKey = pub;
+    election.questions.push_back(Question("Question #1"));
+    election.questions.push_back(Question("Question #2"));
+    election.questions.push_back(Question("Question #3"));
+
+    uint160 questions[] = { election.questions[0].id, election.questions[1].id, election.questions[2].id };
+    unsigned int counts[] = { 3 * Settings::TALLY_BALLOTS_AT_ONCE + 5, 3, 2 };
+
+    std::multiset<EncryptedBallot> ballots;
+    std::map<uint160, paillier_ciphertext_pure_t*> expected;
+    for (int q = 0; q < 3; q++)
+    {
+        for (unsigned int i = 0; i < counts[q]; i++)
+        {
+            EncryptedBallot ballot;
+            ballot.questionID = questions[q];
+            ballot.answer = paillier_enc_proof(pub, (i % 3) ? FIRST : SECOND, paillier_get_rand_devurandom, NULL);
+
+            // proof does not match anymore
+            if (q == 2 || i % 50 == 7)
+                mpz_add_ui(ballot.answer->v1, ballot.answer->v1, 1);
+            else
+            {
+                if (!expected.count(questions[q]))
+                    expected[questions[q]] = paillier_create_enc_zero();
+                paillier_mul(pub, expected[questions[q]], expected[questions[q]], ballot.answer);
+            }
+
+            ballots.insert(ballot);
+        }
+    }
+
+    // same products as multiplying the valid ballots one after another
+    std::map<uint160, paillier_ciphertext_pure_t*> combinations = ElectionManager::combineBallots(&election, ballots);
+    assert(combinations.size() == 2);
+    assert(!combinations.count(questions[2]));
+
+    std::map<uint160, paillier_ciphertext_pure_t*>::iterator iter;
+    for (iter = combinations.begin(); iter != combinations.end(); iter++)
+    {
+        assert(mpz_cmp(iter->second->c, expected[iter->first]->c) == 0);
+        paillier_freeciphertext(iter->second);
+        paillier_freeciphertext(expected[iter->first]);
+    }
+
+    BOOST_FOREACH(const EncryptedBallot &ballot, ballots)
+        paillier_freeciphertextproof(ballot.answer);
+    paillier_freepartkeysarray(prv, pub->decryptServers);
+    paillier_freepubkey(pub);
+
+    test_packed_tally();
+    test_packed_questions();
+    test_running_tally();
+    test_replayed_votes();
+    test_trustee_decryptions();
+}
@@ -1,9 +1,7 @@
 #include "transaction.h"
 
-#include <stdexcept>
-#include <sstream>
+#include "utils/hashsink.h"
 
-#include <boost/archive/text_oarchive.hpp>
 #include <boost/serialization/serialization.hpp>
 
 #include "export.h"
@@ -52,7 +50,9 @@ std::string printVerifyResult(const VerifyResult result)
 bool
 Signable::sign(SignKeyPair keys)
 {
+    // the signed fields are final now, so hash them (again)
     this->verificationKey = keys.second;
+    this->invalidateHash();
     uint256 hash = this->getHash();
     return keys.first.Sign(hash, this->signature);
 }
@@ -68,34 +68,51 @@ Signable::verifySignature() /*const*/
 const uint256
 Signable::getHash() /*const*/
 {
-    // make sure signature is not hashed!
-    this->hashing = true;
+    // hashing encodes the whole object, so only do it once
+    if (this->hashValid)
+        return this->cachedHash;
 
     if (!this->verificationKey.IsValid())
         Log::e("(Signable) Found invalid signature!");
 
-    // self reference
-    Signable* obj = this;
+    // encode straight into the hash (the signature is not part of it)
+    HashWriter hasher;
+    {
+        HashStream stream(hasher);
+        CanonicalWriter writer(stream);
+        this->encode(writer);
+        stream.flush();
+    }
 
-    // serialize object
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream);
-    oa << obj;
-    std::string strObj = stream.str();
+    this->cachedHash = hasher.getHash();
+    this->cachedSize = hasher.getSize();
+    this->hashValid = true;
 
-    // generate hash
-    SHA256_CTX ctx;
-    int r1 = SHA256_Init(&ctx);
-    int r2 = SHA256_Update(&ctx, strObj.c_str(), strObj.size());
-    uint256 hash1;
-    int r3 = SHA256_Final((unsigned char*)&hash1, &ctx);
-    uint256 hash2;
-    SHA256((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
+    return this->cachedHash;
+}
 
-    if(r1 != 1 || r2 != 1 || r3 != 1)
-        throw std::runtime_error("Critical error during hash creation");
+size_t
+Signable::getSize()
+{
+    // the encoding is measured along with the hash
+    this->getHash();
 
-    this->hashing = false;
+    return this->cachedSize + this->signature.size();
+}
 
-    return hash2;
+void
+Signable::encode(CanonicalWriter &writer) /*const*/
+{
+    // the role is part of the key
+    writer.writeUInt8(this->verificationKey.getRole());
+    writer.writeBytes(this->verificationKey.begin(), this->verificationKey.size());
+}
+
+// ====================================================================
+
+void
+Transaction::encode(CanonicalWriter &writer) /*const*/
+{
+    Signable::encode(writer);
+    writer.writeUInt8(this->type);
 }
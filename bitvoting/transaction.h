@@ -11,6 +11,7 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 
 #include "bitcoin/key.h"
 #include "bitcoin/uint256.h"
+#include "utils/canonical.h"
 
 #include <string>
 #include <vector>
@@ -64,8 +65,19 @@ public:
     // Use verification key to check signature
     bool verifySignature() /*const*/;
 
-    // Generate hash
-    const uint256 getHash() /*const*/;
+    // Generate hash (computed once, see invalidateHash)
+    virtual const uint256 getHash() /*const*/;
+
+    // Size of the signed fields (in canonical form) and the signature in
+    // bytes. The fields are measured while hashing them, see getHash
+    size_t getSize();
+
+    // Forget the cached hash. Has to be called after changing
+    // any field, which is part of the hash
+    inline void invalidateHash()
+    {
+        this->hashValid = false;
+    }
 
     // Get public key
     inline CPubKey getPublicKey() const
@@ -77,6 +89,7 @@ public:
     inline void setPublicKey(CPubKey verificationKey)
     {
         this->verificationKey = verificationKey;
+        this->invalidateHash();
     }
 
     // ----------------------------------------------------------------
@@ -95,26 +108,36 @@ public:
 
     virtual std::string toString() const = 0;
 
+protected:
+
+    // Write all signed fields in canonical form (see CanonicalWriter),
+    // subclasses have to append their own fields
+    virtual void encode(CanonicalWriter &writer) /*const*/;
+
 private:
 
     // Verification key, every user can verify this signature with
     CPubKey verificationKey;
 
-    // Created signature for this
+    // Created signature for this (not part of the hash)
     std::vector<unsigned char> signature;
 
-    // Flag, necessary because signature should not be part of hash
-    bool hashing = false;
+    // Cached hash and size of the hashed encoding (not serialized)
+    uint256 cachedHash;
+    size_t cachedSize = 0;
+    bool hashValid = false;
 
     friend class boost::serialization::access;
 
     template<typename Archive>
     void serialize(Archive& a, const unsigned int)
     {
-        a & this->verificationKey;
+        // loaded fields replace the hashed ones
+        if (Archive::is_loading::value)
+            this->invalidateHash();
 
-        if (!this->hashing)
-            a & this->signature;
+        a & this->verificationKey;
+        a & this->signature;
     }
 };
 
@@ -141,6 +164,10 @@ public:
 
     virtual VerifyResult verify() /*const*/ = 0;
 
+protected:
+
+    void encode(CanonicalWriter &writer) /*const*/;
+
 private:
 
     // Type of this transaction
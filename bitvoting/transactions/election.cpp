@@ -2,6 +2,8 @@
 
 #include "election.h"
 
+#include <boost/foreach.hpp>
+
 VerifyResult
 TxElection::verify() /*const*/
 {
@@ -12,9 +14,33 @@ TxElection::verify() /*const*/
 
     // check that election has appropriate values
     bool checkAttributes = (e->encPubKey != NULL &&
+            e->encPubKey->s >= 1 && e->encPubKey->s <= PAILLIER_MAX_S &&
             e->questions.size() > 0 &&
             e->trustees.size() > 0 &&
             e->voters.size() > 0);
 
+    // check that every question has answers, whose tally fits into a plaintext
+    // (and whose proofs do not cover too many plaintexts, including
+    // abstaining in packed elections, see Election::getPlaintexts)
+    BOOST_FOREACH(const Question &question, e->questions)
+    {
+        checkAttributes &= (question.answers.size() >= 2 &&
+                            question.answers.size() < PAILLIER_MAX_PLAINTEXTS &&
+                            e->encPubKey != NULL &&
+                            question.fits(e->getBase(), e->encPubKey));
+    }
+
     return checkAttributes ? VR_OK : VR_ELEC_ERROR;
 }
+
+// ----------------------------------------------------------------
+
+void
+TxElection::encode(CanonicalWriter &writer) /*const*/
+{
+    Transaction::encode(writer);
+
+    writer.writeBool(this->election != NULL);
+    if (this->election != NULL)
+        this->election->encode(writer);
+}
@@ -38,6 +38,10 @@ public:
         return "TxElection {}";
     }
 
+protected:
+
+    void encode(CanonicalWriter &writer) /*const*/;
+
 private:
     friend class boost::serialization::access;
 
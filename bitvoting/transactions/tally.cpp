@@ -59,3 +59,14 @@ TxTally::verify() /*const*/
 
     return VR_OK;
 }
+
+// ----------------------------------------------------------------
+
+void
+TxTally::encode(CanonicalWriter &writer) /*const*/
+{
+    Transaction::encode(writer);
+    writer.writeHash(this->election);
+    writer.writeHash(this->lastBlock);
+    writer.writeBool(this->endElection);
+}
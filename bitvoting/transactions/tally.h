@@ -47,6 +47,10 @@ public:
         return "TxTally {}";
     }
 
+protected:
+
+    void encode(CanonicalWriter &writer) /*const*/;
+
 private:
     friend class boost::serialization::access;
 
@@ -5,6 +5,13 @@
 #include "transactions/election.h"
 #include "transactions/tally.h"
 
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
 VerifyResult
 TxTrusteeTally::verify() /*const*/
 {
@@ -38,11 +45,19 @@ TxTrusteeTally::verify() /*const*/
     if (!em->isTrusteeEligible(this->getPublicKey()))
         return VR_USER_REJECTED;
 
-    // check that number of answers match number of questions
-    if (this->partialDecryption.size() != txElection->election->questions.size())
+    // questions counted in one tally are decrypted at once
+    // (see Election::getSlots)
+    std::set<uint160> packs;
+    std::map<uint160, QuestionSlot> slots = txElection->election->getSlots();
+    std::map<uint160, QuestionSlot>::iterator slot;
+    for (slot = slots.begin(); slot != slots.end(); slot++)
+        packs.insert(slot->second.pack);
+
+    // check that number of answers match number of packs
+    if (this->partialDecryption.size() != packs.size())
         return VR_BALLOT_ERROR;
 
-    // check that all questions at most once
+    // check that all packs at most once
     std::set<uint160> checked;
     BOOST_FOREACH(TalliedBallots ballot, this->partialDecryption)
     {
@@ -53,16 +68,81 @@ TxTrusteeTally::verify() /*const*/
         if (checked.find(ballot.questionID) != checked.end())
             return VR_BALLOT_ERROR;
 
-        BOOST_FOREACH(Question question, txElection->election->questions)
-        {
-            if (ballot.questionID != question.id)
-                continue;
-
-            checked.insert(question.id);
-        }
+        if (packs.count(ballot.questionID))
+            checked.insert(ballot.questionID);
     }
 
     // check that no unknown questions were answered
-    bool countCheck = this->partialDecryption.size() == checked.size();
-    return countCheck ? VR_OK : VR_BALLOT_ERROR;
+    if (this->partialDecryption.size() != checked.size())
+        return VR_BALLOT_ERROR;
+
+    // check the proofs of all partial decryptions at once
+    bool proofCheck = this->verifyDecryptions(txElection->election->encPubKey);
+    return proofCheck ? VR_OK : VR_BALLOT_ERROR;
+}
+
+// ----------------------------------------------------------------
+
+bool
+TxTrusteeTally::verifyDecryptions(paillier_pubkey_t *key, std::set<TalliedBallots> *valid)
+{
+    // the result is only reused for the same decryptions and key
+    // (see GMP docs for the +2)
+    std::vector<char> modulusChars(mpz_sizeinbase(key->n, 16) + 2);
+    mpz_get_str(&modulusChars[0], 16, key->n);
+    std::string modulus(&modulusChars[0]);
+
+    uint256 hash = this->getHash();
+    if (this->verifiedHash == hash && this->verifiedKey == modulus)
+    {
+        if (valid)
+            valid->insert(this->partialDecryption.begin(), this->partialDecryption.end());
+        return true;
+    }
+
+    std::vector<TalliedBallots> ballots;
+    std::vector<paillier_partialdecryption_proof_t*> proofs;
+    BOOST_FOREACH(const TalliedBallots &ballot, this->partialDecryption)
+    {
+        if (!ballot.answers)
+            continue;
+
+        ballots.push_back(ballot);
+        proofs.push_back(ballot.answers);
+    }
+
+    if (proofs.empty())
+        return this->partialDecryption.empty();
+
+    // (std::vector<bool> has no contiguous storage)
+    std::unique_ptr<bool[]> results(new bool[proofs.size()]);
+    bool result = paillier_verify_decryption_batch(key, &proofs[0], proofs.size(),
+                                                   valid ? results.get() : NULL,
+                                                   paillier_get_rand_devurandom);
+
+    for (unsigned int i = 0; valid && i < ballots.size(); i++)
+    {
+        if (results[i])
+            valid->insert(ballots[i]);
+    }
+
+    if (!result || proofs.size() != this->partialDecryption.size())
+        return false;
+
+    this->verifiedHash = hash;
+    this->verifiedKey = modulus;
+    return true;
+}
+
+// ----------------------------------------------------------------
+
+void
+TxTrusteeTally::encode(CanonicalWriter &writer) /*const*/
+{
+    Transaction::encode(writer);
+    writer.writeHash(this->tally);
+
+    writer.writeUInt32(this->partialDecryption.size());
+    BOOST_FOREACH(const TalliedBallots &ballots, this->partialDecryption)
+        ballots.encode(writer);
 }
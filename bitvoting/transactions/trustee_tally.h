@@ -13,6 +13,7 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 #include "../election.h"
 
 #include <set>
+#include <string>
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/access.hpp>
@@ -38,12 +39,31 @@ public:
 
     VerifyResult verify() /*const*/;
 
+    // Verifies the proofs of the partial decryptions of all questions at
+    // once (see paillier_verify_decryption_batch). If valid is not NULL,
+    // it receives the partial decryptions with a valid proof. Remembers
+    // if all are valid (for this hash and key), so that verify does not
+    // check them again. Returns false, if any proof is invalid.
+    bool verifyDecryptions(paillier_pubkey_t *key,
+                           std::set<TalliedBallots> *valid = NULL);
+
     std::string toString() const
     {
         return "TxTrusteeTally {}";
     }
 
+protected:
+
+    void encode(CanonicalWriter &writer) /*const*/;
+
 private:
+
+    // hash of the transaction and modulus of the key, for which the
+    // proofs of all partial decryptions were verified (not serialized).
+    // A changed transaction (see invalidateHash) is verified again.
+    uint256 verifiedHash = 0;
+    std::string verifiedKey;
+
     friend class boost::serialization::access;
 
     template <typename Archive>
@@ -5,6 +5,21 @@
 #include "database/electiondb.h"
 #include "transactions/election.h"
 
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+
+// Identifies the public key the ballots are encrypted with
+static std::string getKeyID(paillier_pubkey_t *key)
+{
+    // see GMP docs for the +2
+    std::vector<char> modulus(mpz_sizeinbase(key->n, 16) + 2);
+    mpz_get_str(&modulus[0], 16, key->n);
+    return std::string(&modulus[0]);
+}
+
+// ----------------------------------------------------------------
+
 VerifyResult
 TxVote::verify() /*const*/
 {
@@ -20,30 +35,36 @@ TxVote::verify() /*const*/
     if (!txElection)
         return VR_TX_MISSING;
 
-    // check that all questions at most once
+    // check that all questions (packs of questions for
+    // packed elections, see Election::getPacks) at most once
+    std::map<uint160, std::vector<Question>> packs = txElection->election->getPacks();
     std::set<uint160> checked;
     BOOST_FOREACH(EncryptedBallot ballot, this->ballots)
     {
-        if (!ballot.answer)
-            return VR_BALLOT_ERROR;
-
         // check for duplicate question ID
         if (checked.find(ballot.questionID) != checked.end())
             return VR_BALLOT_ERROR;
 
-        BOOST_FOREACH(Question question, txElection->election->questions)
-        {
-            if (ballot.questionID != question.id)
-                continue;
+        // check that every question of a pack has a slot
+        // (packed ballots only have slots, others only an answer)
+        if (!packs.count(ballot.questionID))
+            continue;
+        if (txElection->election->packed ? (ballot.answer || ballot.slots.size() != packs[ballot.questionID].size())
+                                         : (!ballot.answer || !ballot.slots.empty()))
+            return VR_BALLOT_ERROR;
 
-            checked.insert(question.id);
-        }
+        checked.insert(ballot.questionID);
     }
 
     // check that no unknown questions were answered
     if (this->ballots.size() != checked.size())
         return VR_BALLOT_ERROR;
 
+    // check that only valid answers were encrypted
+    // (unless done for all votes of a block already)
+    if (!TxVote::verifyBallots(std::vector<TxVote*>(1, this)))
+        return VR_BALLOT_ERROR;
+
     // check if verification key is indeed the public key referenced
     // in election => verification of signature with correct key
     ElectionManager *em = NULL;
@@ -53,3 +74,77 @@ TxVote::verify() /*const*/
     bool keyCheck = em->isVoterEligible(this->getPublicKey());
     return keyCheck ? VR_OK : VR_USER_REJECTED;
 }
+
+// ----------------------------------------------------------------
+
+bool
+TxVote::verifyBallots(const std::vector<TxVote*> &votes)
+{
+    // group the votes by election
+    std::map<uint256, std::vector<TxVote*>> elections;
+    BOOST_FOREACH(TxVote* vote, votes)
+        elections[vote->election].push_back(vote);
+
+    std::map<uint256, std::vector<TxVote*>>::iterator iter;
+    for (iter = elections.begin(); iter != elections.end(); iter++)
+    {
+        Transaction *tx = NULL;
+        if (BlockChainDB::getTransaction(iter->first, &tx) != BC_OK)
+            continue;
+
+        TxElection *txElection = dynamic_cast<TxElection*>(tx);
+        if (!txElection)
+            continue;
+
+        // the result is only reused for the same ballots and key
+        std::string key = getKeyID(txElection->election->encPubKey);
+        std::vector<TxVote*> pending;
+        std::vector<uint256> hashes;
+        BOOST_FOREACH(TxVote* vote, iter->second)
+        {
+            uint256 hash = vote->getHash();
+            if (vote->verifiedHash == hash && vote->verifiedKey == key)
+                continue;
+
+            pending.push_back(vote);
+            hashes.push_back(hash);
+        }
+
+        if (pending.empty())
+            continue;
+
+        // all ballots of the election are checked together
+        std::vector<const EncryptedBallot*> ballots;
+        BOOST_FOREACH(TxVote* vote, pending)
+        {
+            BOOST_FOREACH(const EncryptedBallot &ballot, vote->ballots)
+                ballots.push_back(&ballot);
+        }
+
+        // (ballots of unknown questions are invalid)
+        std::vector<bool> valid = ElectionManager::checkBallots(txElection->election, ballots);
+        if (std::count(valid.begin(), valid.end(), false))
+            return false;
+
+        for (unsigned int i = 0; i < pending.size(); i++)
+        {
+            pending[i]->verifiedHash = hashes[i];
+            pending[i]->verifiedKey = key;
+        }
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------
+
+void
+TxVote::encode(CanonicalWriter &writer) /*const*/
+{
+    Transaction::encode(writer);
+    writer.writeHash(this->election);
+
+    writer.writeUInt32(this->ballots.size());
+    BOOST_FOREACH(const EncryptedBallot &ballot, this->ballots)
+        ballot.encode(writer);
+}
@@ -14,6 +14,7 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/access.hpp>
@@ -39,12 +40,30 @@ public:
 
     VerifyResult verify() /*const*/;
 
+    // Verifies the proofs of the ballots of all given votes, the ballots
+    // of one election at once (see ElectionManager::checkBallots). Valid votes
+    // remember this for their current hash and the key of their election,
+    // so that they are not checked again (by verify or later calls).
+    // Votes of unknown elections are skipped (left to verify).
+    // Returns false, if any proof is invalid.
+    static bool verifyBallots(const std::vector<TxVote*> &votes);
+
     std::string toString() const
     {
         return "TxVote {}";
     }
 
+protected:
+
+    void encode(CanonicalWriter &writer) /*const*/;
+
 private:
+
+    // proofs of all ballots were verified (not serialized).
+    // A changed transaction (see invalidateHash) is verified again.
+    uint256 verifiedHash = 0;
+    std::string verifiedKey;
+
     friend class boost::serialization::access;
 
     template <typename Archive>
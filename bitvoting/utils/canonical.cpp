@@ -0,0 +1,195 @@
+#include "utils/canonical.h"
+
+#include <stdexcept>
+
+// ================================================================
+
+CanonicalWriter::CanonicalWriter(std::ostream &out) :
+    out(out)
+{
+    this->writeUInt8(CANONICAL_ENCODING_VERSION);
+}
+
+// ----------------------------------------------------------------
+
+void
+CanonicalWriter::writeUInt8(uint8_t value)
+{
+    this->write(&value, 1);
+}
+
+void
+CanonicalWriter::writeUInt32(uint32_t value)
+{
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; i++)
+        bytes[i] = (unsigned char) (value >> (8 * i));
+    this->write(bytes, sizeof(bytes));
+}
+
+void
+CanonicalWriter::writeUInt64(uint64_t value)
+{
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (unsigned char) (value >> (8 * i));
+    this->write(bytes, sizeof(bytes));
+}
+
+// ----------------------------------------------------------------
+
+void
+CanonicalWriter::writeHash(const uint160 &hash)
+{
+    this->write(hash.begin(), hash.size());
+}
+
+void
+CanonicalWriter::writeHash(const uint256 &hash)
+{
+    this->write(hash.begin(), hash.size());
+}
+
+// ----------------------------------------------------------------
+
+void
+CanonicalWriter::writeBytes(const unsigned char *bytes, size_t size)
+{
+    this->writeUInt32(size);
+    this->write(bytes, size);
+}
+
+void
+CanonicalWriter::writeString(const std::string &value)
+{
+    this->writeBytes((const unsigned char*) value.data(), value.size());
+}
+
+// ----------------------------------------------------------------
+
+void
+CanonicalWriter::writeMpz(const mpz_t value)
+{
+    if (mpz_sgn(value) < 0)
+        throw std::runtime_error("Negative numbers cannot be encoded");
+
+    // zero has no bytes at all
+    size_t size = (mpz_sizeinbase(value, 2) + 7) / 8;
+    if (mpz_sgn(value) == 0)
+        size = 0;
+
+    this->writeUInt32(size);
+
+    // read the bytes from the limbs directly (most significant first),
+    // so no copy of the whole number is needed
+    unsigned char buffer[64];
+    size_t buffered = 0;
+    for (size_t i = size; i > 0; i--)
+    {
+        size_t byte = i - 1;
+        mp_limb_t limb = mpz_getlimbn(value, byte / sizeof(mp_limb_t));
+        buffer[buffered++] = (unsigned char) (limb >> (8 * (byte % sizeof(mp_limb_t))));
+
+        if (buffered == sizeof(buffer))
+        {
+            this->write(buffer, buffered);
+            buffered = 0;
+        }
+    }
+    this->write(buffer, buffered);
+}
+
+// ----------------------------------------------------------------
+
+void
+CanonicalWriter::writePublicKey(const paillier_pubkey_t *key)
+{
+    // the flag is 2 for keys with s > 1 (followed by s),
+    // so Paillier keys keep their encoding
+    if (key == NULL)
+    {
+        this->writeUInt8(0);
+        return;
+    }
+
+    this->writeUInt8(key->s == 1 ? 1 : 2);
+    if (key->s != 1)
+        this->writeInt32(key->s);
+
+    // everything else is derived from these (see complete)
+    this->writeInt32(key->bits);
+    this->writeInt32(key->decryptServers);
+    this->writeInt32(key->threshold);
+    this->writeMpz(key->n);
+    this->writeMpz(key->v);
+
+    for (int i = 0; i < key->decryptServers; i++)
+    {
+        this->writeInt32(key->verificationKeys[i]->id);
+        this->writeMpz(key->verificationKeys[i]->v);
+    }
+}
+
+void
+CanonicalWriter::writeCiphertext(const paillier_ciphertext_proof_t *ciphertext)
+{
+    // the flag is the proof version (1 for proofs created before it existed)
+    if (ciphertext == NULL)
+    {
+        this->writeUInt8(0);
+        return;
+    }
+
+    this->writeUInt8(ciphertext->version);
+
+    this->writeMpz(ciphertext->c);
+    this->writeMpz(ciphertext->e);
+    this->writeMpz(ciphertext->e1);
+    this->writeMpz(ciphertext->e2);
+    this->writeMpz(ciphertext->v1);
+    this->writeMpz(ciphertext->v2);
+
+    if (ciphertext->version >= PAILLIER_PROOF_V3)
+    {
+        this->writeMpz(ciphertext->u1);
+        this->writeMpz(ciphertext->u2);
+    }
+
+    // further branches of a 1-out-of-k proof
+    if (ciphertext->version >= PAILLIER_PROOF_V5)
+    {
+        this->writeUInt32(ciphertext->count);
+        for (int i = 0; i < ciphertext->count - 2; i++)
+        {
+            this->writeMpz(ciphertext->ek[i]);
+            this->writeMpz(ciphertext->vk[i]);
+            this->writeMpz(ciphertext->uk[i]);
+        }
+    }
+}
+
+void
+CanonicalWriter::writePartialDecryption(const paillier_partialdecryption_proof_t *decryption)
+{
+    // the flag is the proof version (see writeCiphertext)
+    if (decryption == NULL)
+    {
+        this->writeUInt8(0);
+        return;
+    }
+
+    this->writeUInt8(decryption->version);
+
+    this->writeInt32(decryption->id);
+    this->writeMpz(decryption->decryption);
+    this->writeMpz(decryption->c4);
+    this->writeMpz(decryption->ci2);
+    this->writeMpz(decryption->e);
+    this->writeMpz(decryption->z);
+
+    if (decryption->version >= PAILLIER_PROOF_V4)
+    {
+        this->writeMpz(decryption->a);
+        this->writeMpz(decryption->b);
+    }
+}
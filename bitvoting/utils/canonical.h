@@ -0,0 +1,87 @@
+/*=============================================================================
+
+Canonical binary encoding of signed objects, used for hashing and signing only
+(the network and the databases still use boost serialization). The encoding is
+written to a stream, usually straight into the hash (see HashStream).
+
+The encoding is deterministic and does not depend on the platform or on the
+boost version:
+  - it starts with one byte CANONICAL_ENCODING_VERSION
+  - integers are written with fixed width, little-endian
+  - hashes (uint160, uint256) are written as their raw 20/32 bytes
+  - byte strings are prefixed by their length (uint32)
+  - big integers are written as length-prefixed big-endian magnitude
+  - containers are prefixed by their number of elements (uint32) and
+    written in their (sorted) order
+  - optional structures are prefixed by a flag (uint8), if they are present
+    (for Paillier proofs the flag is their proof version, which also
+    decides if the commitments of encryption proofs are written)
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_CANONICAL_H
+#define BITVOTING_CANONICAL_H
+
+#include "bitcoin/uint256.h"
+#include "paillier/paillier.h"
+
+#include <ostream>
+#include <string>
+
+#include <stdint.h>
+
+// version of the encoding (changes the hash of every object)
+#define CANONICAL_ENCODING_VERSION 1
+
+// ----------------------------------------------------------------
+class CanonicalWriter
+{
+public:
+    // writes the version to the given stream
+    CanonicalWriter(std::ostream &out);
+
+    void writeUInt8(uint8_t value);
+    void writeUInt32(uint32_t value);
+    void writeUInt64(uint64_t value);
+
+    void writeInt32(int32_t value)
+    {
+        this->writeUInt32((uint32_t) value);
+    }
+
+    void writeInt64(int64_t value)
+    {
+        this->writeUInt64((uint64_t) value);
+    }
+
+    void writeBool(bool value)
+    {
+        this->writeUInt8(value ? 1 : 0);
+    }
+
+    // Raw bytes of a hash (fixed size)
+    void writeHash(const uint160 &hash);
+    void writeHash(const uint256 &hash);
+
+    // Length-prefixed bytes
+    void writeBytes(const unsigned char *data, size_t size);
+    void writeString(const std::string &value);
+
+    // Length-prefixed big-endian magnitude (must not be negative)
+    void writeMpz(const mpz_t value);
+
+    // Paillier structures (only their essential values, may be NULL)
+    void writePublicKey(const paillier_pubkey_t *key);
+    void writeCiphertext(const paillier_ciphertext_proof_t *ciphertext);
+    void writePartialDecryption(const paillier_partialdecryption_proof_t *decryption);
+
+private:
+    void write(const unsigned char *data, size_t size)
+    {
+        out.write((const char*) data, size);
+    }
+
+    std::ostream &out;
+};
+
+#endif // BITVOTING_CANONICAL_H
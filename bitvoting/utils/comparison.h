@@ -14,6 +14,7 @@ Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
 struct pt_cmp
 {
     // cannot be const, as it delegates to Signable::getHash
+    // (which only computes the hash once)
     template<typename T>
     bool operator()(T /*const*/* t1, T /*const*/* t2) /*const*/
     {
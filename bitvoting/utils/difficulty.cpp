@@ -0,0 +1,138 @@
+#include "utils/difficulty.h"
+
+#include "settings.h"
+
+#include <gmp.h>
+
+// ================================================================
+
+// helpers to do the (256 bit) arithmetic with GMP
+static void importTarget(mpz_t out, const uint256 &target)
+{
+    mpz_import(out, target.size(), -1, 1, 0, 0, target.begin());
+}
+
+static uint256 exportTarget(const mpz_t in)
+{
+    uint256 result = 0;
+    if (mpz_sizeinbase(in, 256) > result.size())
+        return ~result;
+
+    mpz_export(result.begin(), NULL, -1, 1, 0, 0, in);
+    return result;
+}
+
+// ----------------------------------------------------------------
+
+unsigned int
+Difficulty::toCompact(const uint256 &target)
+{
+    // number of significant bytes
+    unsigned int size = target.size();
+    while (size > 0 && target.begin()[size - 1] == 0)
+        size--;
+
+    unsigned int compact;
+    if (size <= 3)
+        compact = (unsigned int) (target.GetLow64() << (8 * (3 - size)));
+    else
+        compact = (unsigned int) (target >> (8 * (size - 3))).GetLow64();
+
+    // the highest mantissa bit is a sign bit, so shift it out
+    if (compact & 0x00800000)
+    {
+        compact >>= 8;
+        size++;
+    }
+
+    return compact | (size << 24);
+}
+
+// ----------------------------------------------------------------
+
+uint256
+Difficulty::fromCompact(unsigned int bits)
+{
+    unsigned int size = bits >> 24;
+    unsigned int word = bits & 0x007fffff;
+
+    // negative or too large
+    if ((bits & 0x00800000) || size > 32 + 3)
+        return 0;
+
+    uint256 result;
+    if (size <= 3)
+    {
+        result = word >> (8 * (3 - size));
+    }
+    else
+    {
+        result = word;
+        result <<= 8 * (size - 3);
+
+        // bits of the mantissa were shifted out
+        if (size > 32 && (result >> (8 * (size - 3))) != word)
+            return 0;
+    }
+
+    return result;
+}
+
+// ----------------------------------------------------------------
+
+unsigned int
+Difficulty::getInitialBits()
+{
+    uint256 target = ~uint256(0) >> Settings::MINING_INITIAL_LEADING_ZEROS;
+    return Difficulty::toCompact(target);
+}
+
+// ----------------------------------------------------------------
+
+uint256
+Difficulty::getMaxTarget()
+{
+    return ~uint256(0) >> Settings::MINING_MIN_LEADING_ZEROS;
+}
+
+// ----------------------------------------------------------------
+
+unsigned int
+Difficulty::retarget(const std::vector<unsigned int> &bits, long long timespan)
+{
+    if (bits.empty())
+        return Difficulty::getInitialBits();
+
+    // limit the adjustment
+    long long expected = (long long) bits.size() * Settings::MINING_TARGET_BLOCK_TIME;
+    if (timespan < expected / Settings::MINING_RETARGET_MAX_FACTOR)
+        timespan = expected / Settings::MINING_RETARGET_MAX_FACTOR;
+    if (timespan > expected * Settings::MINING_RETARGET_MAX_FACTOR)
+        timespan = expected * Settings::MINING_RETARGET_MAX_FACTOR;
+
+    mpz_t sum, target;
+    mpz_inits(sum, target, NULL);
+
+    // average target of the window
+    for (unsigned int i = 0; i < bits.size(); i++)
+    {
+        importTarget(target, Difficulty::fromCompact(bits[i]));
+        mpz_add(sum, sum, target);
+    }
+
+    // scale by the ratio of actual and expected time (multiply first)
+    mpz_mul_ui(sum, sum, (unsigned long) timespan);
+    mpz_tdiv_q_ui(sum, sum, (unsigned long) expected);
+    mpz_tdiv_q_ui(sum, sum, bits.size());
+
+    uint256 result = exportTarget(sum);
+    mpz_clears(sum, target, NULL);
+
+    uint256 maxTarget = Difficulty::getMaxTarget();
+    if (result > maxTarget)
+        result = maxTarget;
+    if (result == 0)
+        result = 1;
+
+    return Difficulty::toCompact(result);
+}
@@ -0,0 +1,46 @@
+/*=============================================================================
+
+Difficulty of the proof of work. The hash target of a block is stored in its
+header in compact form (as in Bitcoin's nBits: one byte exponent, three bytes
+mantissa) and depends on the blocks before it:
+
+    target = average target of the last W blocks
+             * (time the last W blocks took) / (W * MINING_TARGET_BLOCK_TIME)
+
+So the time between two blocks stays close to MINING_TARGET_BLOCK_TIME,
+no matter how many miners are online. The factor is limited to
+MINING_RETARGET_MAX_FACTOR (in both directions), the target never exceeds
+the one given by MINING_MIN_LEADING_ZEROS.
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_DIFFICULTY_H
+#define BITVOTING_DIFFICULTY_H
+
+#include "bitcoin/uint256.h"
+
+#include <vector>
+
+// ----------------------------------------------------------------
+class Difficulty
+{
+public:
+
+    // Encode a target in compact form (precision is reduced to 3 bytes)
+    static unsigned int toCompact(const uint256 &target);
+
+    // Decode a compact target (0 if the encoding is invalid)
+    static uint256 fromCompact(unsigned int bits);
+
+    // Compact target of the first blocks of the chain
+    static unsigned int getInitialBits();
+
+    // Largest allowed target (lowest difficulty)
+    static uint256 getMaxTarget();
+
+    // Compute the compact target of the next block from the compact
+    // targets of the last blocks and the time they took (msec)
+    static unsigned int retarget(const std::vector<unsigned int> &bits, long long timespan);
+};
+
+#endif // BITVOTING_DIFFICULTY_H
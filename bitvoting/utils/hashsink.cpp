@@ -0,0 +1,36 @@
+#include "utils/hashsink.h"
+
+#include <stdexcept>
+
+// ================================================================
+
+HashWriter::HashWriter()
+{
+    if (SHA256_Init(&context) != 1)
+        throw std::runtime_error("Critical error during hash creation");
+}
+
+// ----------------------------------------------------------------
+
+void
+HashWriter::write(const void *data, size_t size)
+{
+    if (SHA256_Update(&context, data, size) != 1)
+        throw std::runtime_error("Critical error during hash creation");
+
+    this->size += size;
+}
+
+// ----------------------------------------------------------------
+
+uint256
+HashWriter::getHash()
+{
+    uint256 hash1;
+    if (SHA256_Final((unsigned char*) &hash1, &context) != 1)
+        throw std::runtime_error("Critical error during hash creation");
+
+    uint256 hash2;
+    SHA256((unsigned char*) &hash1, sizeof(hash1), (unsigned char*) &hash2);
+    return hash2;
+}
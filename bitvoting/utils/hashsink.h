@@ -0,0 +1,78 @@
+/*=============================================================================
+
+Incremental hashing: bytes are fed into the SHA-256 context as they are
+written, so hashing a large object never needs a copy of its encoding.
+
+HashWriter computes the double SHA-256 (same as Hash in bitcoin/hash.h) over
+everything written to it. HashSink makes a HashWriter usable as a boost
+iostreams device, so any stream based serialization can write into it:
+
+    HashWriter hasher;
+    HashStream stream(hasher);
+    stream << ...;
+    stream.flush();
+    uint256 hash = hasher.getHash();
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_HASHSINK_H
+#define BITVOTING_HASHSINK_H
+
+#include "bitcoin/uint256.h"
+
+#include <iosfwd>
+
+#include <openssl/sha.h>
+
+#include <boost/iostreams/categories.hpp>
+#include <boost/iostreams/stream.hpp>
+
+// ----------------------------------------------------------------
+class HashWriter
+{
+public:
+    HashWriter();
+
+    // Append bytes to the hashed data
+    void write(const void *data, size_t size);
+
+    // Double SHA-256 of all written bytes
+    // (finishes the hash, nothing may be written afterwards)
+    uint256 getHash();
+
+    // Number of bytes written so far
+    uint64_t getSize() const
+    {
+        return size;
+    }
+
+private:
+    SHA256_CTX context;
+    uint64_t size = 0;
+};
+
+// ----------------------------------------------------------------
+// boost iostreams sink writing into a HashWriter. Devices are copied by
+// the stream, so the sink only refers to the writer.
+class HashSink
+{
+public:
+    typedef char char_type;
+    typedef boost::iostreams::sink_tag category;
+
+    HashSink(HashWriter &writer) :
+        writer(&writer) {}
+
+    std::streamsize write(const char *data, std::streamsize size)
+    {
+        writer->write(data, size);
+        return size;
+    }
+
+private:
+    HashWriter *writer;
+};
+
+typedef boost::iostreams::stream<HashSink> HashStream;
+
+#endif // BITVOTING_HASHSINK_H
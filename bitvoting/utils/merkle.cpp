@@ -0,0 +1,150 @@
+#include "utils/merkle.h"
+
+#include "utils/hashsink.h"
+
+// ================================================================
+
+uint256
+MerkleTree::hashLeaf(const uint256 &transaction)
+{
+    // prefix leaves, so that an inner node (64 bytes) cannot be
+    // presented as a leaf and vice versa
+    static const unsigned char prefix = 0x00;
+
+    HashWriter hasher;
+    hasher.write(&prefix, 1);
+    hasher.write(transaction.begin(), transaction.size());
+    return hasher.getHash();
+}
+
+// ----------------------------------------------------------------
+
+uint256
+MerkleTree::hashNodes(const uint256 &left, const uint256 &right)
+{
+    // prefix inner nodes, so they cannot be confused with leaves
+    static const unsigned char prefix = 0x01;
+
+    HashWriter hasher;
+    hasher.write(&prefix, 1);
+    hasher.write(left.begin(), left.size());
+    hasher.write(right.begin(), right.size());
+    return hasher.getHash();
+}
+
+// ----------------------------------------------------------------
+
+uint256
+MerkleTree::computeRoot(std::vector<uint256> leaves)
+{
+    if (leaves.empty())
+        return 0;
+
+    for (unsigned int i = 0; i < leaves.size(); i++)
+        leaves[i] = MerkleTree::hashLeaf(leaves[i]);
+
+    // reduce level by level (in place)
+    unsigned int width = leaves.size();
+    while (width > 1)
+    {
+        for (unsigned int i = 0; i < width; i += 2)
+        {
+            // carry up nodes without sibling
+            if (i + 1 == width)
+                leaves[i / 2] = leaves[i];
+            else
+                leaves[i / 2] = MerkleTree::hashNodes(leaves[i], leaves[i + 1]);
+        }
+
+        width = (width + 1) / 2;
+    }
+
+    return leaves[0];
+}
+
+// ----------------------------------------------------------------
+
+bool
+MerkleTree::computeBranch(std::vector<uint256> leaves, unsigned int index,
+                          std::vector<uint256> &branchOut)
+{
+    branchOut.clear();
+
+    if (index >= leaves.size())
+        return false;
+
+    for (unsigned int i = 0; i < leaves.size(); i++)
+        leaves[i] = MerkleTree::hashLeaf(leaves[i]);
+
+    unsigned int width = leaves.size();
+    while (width > 1)
+    {
+        // remember sibling of the current node (if there is one)
+        unsigned int sibling = index ^ 1;
+        if (sibling < width)
+            branchOut.push_back(leaves[sibling]);
+
+        // compute next level
+        for (unsigned int i = 0; i < width; i += 2)
+        {
+            if (i + 1 == width)
+                leaves[i / 2] = leaves[i];
+            else
+                leaves[i / 2] = MerkleTree::hashNodes(leaves[i], leaves[i + 1]);
+        }
+
+        index /= 2;
+        width = (width + 1) / 2;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------
+
+uint256
+MerkleTree::rootFromProof(const MerkleProof &proof)
+{
+    uint256 node = MerkleTree::hashLeaf(proof.transaction);
+    unsigned int index = proof.index;
+    unsigned int width = proof.leaves;
+    unsigned int used = 0;
+
+    while (width > 1)
+    {
+        unsigned int sibling = index ^ 1;
+        if (sibling < width)
+        {
+            // branch is too short
+            if (used >= proof.branch.size())
+                return 0;
+
+            if (index & 1)
+                node = MerkleTree::hashNodes(proof.branch[used], node);
+            else
+                node = MerkleTree::hashNodes(node, proof.branch[used]);
+
+            used++;
+        }
+
+        index /= 2;
+        width = (width + 1) / 2;
+    }
+
+    // branch is too long
+    if (used != proof.branch.size())
+        return 0;
+
+    return node;
+}
+
+// ----------------------------------------------------------------
+
+bool
+MerkleTree::verify(const MerkleProof &proof, const uint256 &root)
+{
+    if (proof.index >= proof.leaves)
+        return false;
+
+    return (root != 0 && MerkleTree::rootFromProof(proof) == root);
+}
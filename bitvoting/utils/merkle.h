@@ -0,0 +1,84 @@
+/*=============================================================================
+
+Merkle tree over the transaction hashes of a block. The root is committed to
+in the block header, so that the inclusion of a single transaction can be
+proven with a branch of O(log n) hashes instead of the whole block.
+
+Leaves are hashed as H(0x00 | transaction hash) and inner nodes as
+H(0x01 | left | right), so that the two cannot be confused. A node without
+a sibling is carried up to the next level unchanged, which (unlike
+duplicating it) does not allow two different transaction lists to share the same root.
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_MERKLE_H
+#define BITVOTING_MERKLE_H
+
+#include "bitcoin/uint256.h"
+
+#include <vector>
+
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/vector.hpp>
+
+// ----------------------------------------------------------------
+// Compact proof that a transaction is part of a certain block
+struct MerkleProof
+{
+    // Hash of the block containing the transaction
+    uint256 block = 0;
+
+    // Hash of the proven transaction (leaf)
+    uint256 transaction = 0;
+
+    // Position of the transaction among the leaves
+    unsigned int index = 0;
+
+    // Number of leaves (transactions) in the tree, has to match the block
+    // (see BlockChainDB::verifyMerkleProof)
+    unsigned int leaves = 0;
+
+    // Sibling node hashes from the leaf up to the root
+    std::vector<uint256> branch;
+
+    // ----------------------------------------------------------------
+
+    template <typename Archive>
+    void serialize(Archive& a, const unsigned int)
+    {
+        a & block;
+        a & transaction;
+        a & index;
+        a & leaves;
+        a & branch;
+    }
+};
+
+// ----------------------------------------------------------------
+class MerkleTree
+{
+public:
+
+    // Compute the root for the given leaves (0 if there are none)
+    static uint256 computeRoot(std::vector<uint256> leaves);
+
+    // Collect the branch (sibling node hashes) of the leaf at the given index
+    static bool computeBranch(std::vector<uint256> leaves, unsigned int index,
+                              std::vector<uint256> &branchOut);
+
+    // Compute the root implied by the given proof
+    static uint256 rootFromProof(const MerkleProof &proof);
+
+    // Check that the given proof leads to the given root
+    static bool verify(const MerkleProof &proof, const uint256 &root);
+
+private:
+
+    // Hash a transaction hash to its leaf node
+    static uint256 hashLeaf(const uint256 &transaction);
+
+    // Hash two child nodes to their parent
+    static uint256 hashNodes(const uint256 &left, const uint256 &right);
+};
+
+#endif // BITVOTING_MERKLE_H
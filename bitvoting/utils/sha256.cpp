@@ -0,0 +1,321 @@
+#include "utils/sha256.h"
+
+#include <atomic>
+#include <string.h>
+
+// the rest of the header, the nonce and the padding fill one block
+static_assert(NONCE_SCANNER_TAIL_SIZE % 4 == 0 && NONCE_SCANNER_TAIL_SIZE + 4 + 9 <= 64,
+              "unsupported block header size");
+
+// the SIMD kernels are only built for x86, elsewhere the scalar one is used
+#if defined(__x86_64__) || defined(__i386__)
+#define NONCE_SCANNER_SIMD
+#endif
+
+#ifdef NONCE_SCANNER_SIMD
+
+// ================================================================
+// Multi-lane SHA-256 (one message per 32 bit lane of a vector)
+
+typedef uint32_t lanes4_t __attribute__((vector_size(16)));
+typedef uint32_t lanes8_t __attribute__((vector_size(32)));
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// The helpers below are always inlined into the kernels, so that they
+// are compiled for the instruction set the respective kernel targets.
+
+template<typename V>
+static inline __attribute__((always_inline))
+void splat(V* out, uint32_t value)
+{
+    V zero = {};
+    *out = zero + value;
+}
+
+template<typename V>
+static inline __attribute__((always_inline))
+void transform(V* s, V* w)
+{
+    // message schedule
+    for (int i = 16; i < 64; i++)
+    {
+        V s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        V s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    V a = s[0], b = s[1], c = s[2], d = s[3];
+    V e = s[4], f = s[5], g = s[6], h = s[7];
+
+    // compression
+    for (int i = 0; i < 64; i++)
+    {
+        V t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        V t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+    s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+}
+
+template<typename V, int N>
+static inline __attribute__((always_inline))
+void scanLanes(const HeaderMidstate& midstate, unsigned int first, uint256* hashesOut)
+{
+    V state[8];
+    V w[64];
+
+    // --- first hash: second block of the header, starting at midstate ---
+
+    for (int i = 0; i < 8; i++)
+        splat(&state[i], midstate.state[i]);
+
+    const int words = NONCE_SCANNER_TAIL_SIZE / 4;
+    for (int i = 0; i < words; i++)
+        splat(&w[i], midstate.tail[i]);
+
+    // the nonce is the only word differing between lanes
+    uint32_t nonces[N];
+    for (int l = 0; l < N; l++)
+        nonces[l] = __builtin_bswap32(first + l);
+    memcpy(&w[words], nonces, sizeof(nonces));
+
+    // padding for the whole header
+    splat(&w[words + 1], 0x80000000);
+    for (int i = words + 2; i < 15; i++)
+        splat(&w[i], 0);
+    splat(&w[15], NONCE_SCANNER_HEADER_SIZE * 8);
+
+    transform(state, w);
+
+    // --- second hash: over the 32 bytes of the first hash ---
+
+    for (int i = 0; i < 8; i++)
+        w[i] = state[i];
+
+    splat(&w[8], 0x80000000);
+    for (int i = 9; i < 15; i++)
+        splat(&w[i], 0);
+    splat(&w[15], 32 * 8);
+
+    for (int i = 0; i < 8; i++)
+        splat(&state[i], IV[i]);
+
+    transform(state, w);
+
+    // --- extract lanes (digest is big endian) ---
+
+    for (int l = 0; l < N; l++)
+    {
+        unsigned char* out = hashesOut[l].begin();
+        for (int i = 0; i < 8; i++)
+        {
+            uint32_t word = __builtin_bswap32(state[i][l]);
+            memcpy(out + 4 * i, &word, 4);
+        }
+    }
+}
+
+#endif // NONCE_SCANNER_SIMD
+
+// ================================================================
+// Kernels
+
+static void scanScalar(const HeaderMidstate& midstate, unsigned int first, uint256* hashesOut)
+{
+    // nonce is stored little endian at the end of the header
+    unsigned char tail[NONCE_SCANNER_TAIL_SIZE + 4];
+    memcpy(tail, midstate.tailBytes, NONCE_SCANNER_TAIL_SIZE);
+    for (int i = 0; i < 4; i++)
+        tail[NONCE_SCANNER_TAIL_SIZE + i] = (unsigned char) (first >> (8 * i));
+
+    // continue from midstate
+    SHA256_CTX ctx = midstate.context;
+    uint256 hash1;
+    SHA256_Update(&ctx, tail, sizeof(tail));
+    SHA256_Final(hash1.begin(), &ctx);
+
+    SHA256(hash1.begin(), sizeof(hash1), hashesOut[0].begin());
+}
+
+#ifdef NONCE_SCANNER_SIMD
+
+__attribute__((target("sse4.1")))
+static void scanSSE4(const HeaderMidstate& midstate, unsigned int first, uint256* hashesOut)
+{
+    scanLanes<lanes4_t, 4>(midstate, first, hashesOut);
+}
+
+__attribute__((target("avx2")))
+static void scanAVX2(const HeaderMidstate& midstate, unsigned int first, uint256* hashesOut)
+{
+    scanLanes<lanes8_t, 8>(midstate, first, hashesOut);
+}
+
+#endif // NONCE_SCANNER_SIMD
+
+// ================================================================
+// Runtime dispatch
+
+typedef void (*scan_t)(const HeaderMidstate&, unsigned int, uint256*);
+
+struct KernelInfo
+{
+    scan_t scan;
+    unsigned int lanes;
+    const char* name;
+};
+
+static const KernelInfo* getKernelInfo(NonceScanner::Kernel kernel)
+{
+    static const KernelInfo scalar = { &scanScalar, 1, "OpenSSL (scalar)" };
+
+#ifdef NONCE_SCANNER_SIMD
+    static const KernelInfo avx2 = { &scanAVX2, 8, "AVX2 (8 lanes)" };
+    static const KernelInfo sse4 = { &scanSSE4, 4, "SSE4.1 (4 lanes)" };
+
+    switch (kernel)
+    {
+    case NonceScanner::KERNEL_AVX2:
+        return &avx2;
+    case NonceScanner::KERNEL_SSE4:
+        return &sse4;
+    default:
+        break;
+    }
+#else
+    (void) kernel;
+#endif
+
+    return &scalar;
+}
+
+static std::atomic<const KernelInfo*>& currentKernel()
+{
+    // select best supported kernel on first use. The kernel infos are
+    // constant, so mining threads may read them while setKernel swaps them.
+    static std::atomic<const KernelInfo*> kernel(getKernelInfo(
+                NonceScanner::isSupported(NonceScanner::KERNEL_AVX2) ? NonceScanner::KERNEL_AVX2 :
+                NonceScanner::isSupported(NonceScanner::KERNEL_SSE4) ? NonceScanner::KERNEL_SSE4 :
+                                                                       NonceScanner::KERNEL_SCALAR));
+    return kernel;
+}
+
+// ----------------------------------------------------------------
+
+bool
+NonceScanner::isSupported(Kernel kernel)
+{
+#ifdef NONCE_SCANNER_SIMD
+    __builtin_cpu_init();
+
+    switch (kernel)
+    {
+    case KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case KERNEL_SSE4:
+        return __builtin_cpu_supports("sse4.1");
+    default:
+        break;
+    }
+
+    return true;
+#else
+    return kernel == KERNEL_AUTO || kernel == KERNEL_SCALAR;
+#endif
+}
+
+// ----------------------------------------------------------------
+
+bool
+NonceScanner::setKernel(Kernel kernel)
+{
+    if (kernel == KERNEL_AUTO)
+    {
+        if (NonceScanner::isSupported(KERNEL_AVX2))
+            kernel = KERNEL_AVX2;
+        else if (NonceScanner::isSupported(KERNEL_SSE4))
+            kernel = KERNEL_SSE4;
+        else
+            kernel = KERNEL_SCALAR;
+    }
+
+    if (!NonceScanner::isSupported(kernel))
+        return false;
+
+    currentKernel().store(getKernelInfo(kernel));
+    return true;
+}
+
+// ----------------------------------------------------------------
+
+unsigned int
+NonceScanner::lanes()
+{
+    return currentKernel().load()->lanes;
+}
+
+// ----------------------------------------------------------------
+
+const char*
+NonceScanner::kernelName()
+{
+    return currentKernel().load()->name;
+}
+
+// ----------------------------------------------------------------
+
+void
+NonceScanner::prepare(const unsigned char* header, HeaderMidstate& out)
+{
+    // hash the first (constant) block
+    SHA256_Init(&out.context);
+    SHA256_Update(&out.context, header, 64);
+
+    for (int i = 0; i < 8; i++)
+        out.state[i] = out.context.h[i];
+
+    // remaining constant bytes before the nonce
+    memcpy(out.tailBytes, header + 64, NONCE_SCANNER_TAIL_SIZE);
+    for (int i = 0; i < NONCE_SCANNER_TAIL_SIZE / 4; i++)
+    {
+        const unsigned char* p = header + 64 + 4 * i;
+        out.tail[i] = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+                      ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+    }
+}
+
+// ----------------------------------------------------------------
+
+unsigned int
+NonceScanner::scan(const HeaderMidstate& midstate, unsigned int first, uint256* hashesOut)
+{
+    // read the kernel once, so that its lanes match the computed hashes
+    const KernelInfo* kernel = currentKernel().load(std::memory_order_relaxed);
+    kernel->scan(midstate, first, hashesOut);
+    return kernel->lanes;
+}
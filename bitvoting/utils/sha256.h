@@ -0,0 +1,85 @@
+/*=============================================================================
+
+Nonce search kernel for the proof of work. All block headers of one mining
+run only differ in their nonce (the last 4 bytes of the binary header), so
+the SHA-256 state after the first 64 header bytes (midstate) is computed once
+and only the remaining block plus the second SHA-256 pass is done per nonce.
+
+Depending on the CPU (detected at runtime), 8 (AVX2) or 4 (SSE4.1) nonces
+are hashed at once in parallel lanes. Otherwise (and on other architectures
+than x86) the scalar OpenSSL implementation is used.
+
+Author   : Benedikt Hiemenz, Max Kolhagen, Markus Schmidt
+=============================================================================*/
+#ifndef BITVOTING_SHA256_H
+#define BITVOTING_SHA256_H
+
+#include "bitcoin/uint256.h"
+
+#include <stdint.h>
+
+#include <openssl/sha.h>
+
+// Maximum number of nonces hashed per call of NonceScanner::scan
+#define NONCE_SCANNER_MAX_LANES 8
+
+// Size of the supported binary header (see BLOCK_HEADER_SIZE),
+// the nonce being its last 4 bytes
+#define NONCE_SCANNER_HEADER_SIZE 104
+
+// Number of constant header bytes after the midstate (before the nonce)
+#define NONCE_SCANNER_TAIL_SIZE (NONCE_SCANNER_HEADER_SIZE - 64 - 4)
+
+// ----------------------------------------------------------------
+// Precomputed state of a binary block header (see BLOCK_HEADER_SIZE)
+struct HeaderMidstate
+{
+    // OpenSSL context after the first 64 bytes (scalar kernel)
+    SHA256_CTX context;
+
+    // Same state as plain words (SIMD kernels)
+    uint32_t state[8];
+
+    // Message words of the header bytes after the first 64 (big endian)
+    uint32_t tail[NONCE_SCANNER_TAIL_SIZE / 4];
+
+    // Header bytes after the first 64 (scalar kernel)
+    unsigned char tailBytes[NONCE_SCANNER_TAIL_SIZE];
+};
+
+// ----------------------------------------------------------------
+class NonceScanner
+{
+public:
+
+    enum Kernel
+    {
+        KERNEL_AUTO,    // best kernel supported by this CPU
+        KERNEL_SCALAR,  // OpenSSL, 1 nonce per call
+        KERNEL_SSE4,    // 4 nonces per call
+        KERNEL_AVX2     // 8 nonces per call
+    };
+
+    // Compute the midstate of the given binary header (nonce is ignored)
+    static void prepare(const unsigned char* header, HeaderMidstate& out);
+
+    // Hash the header for the nonces [first, first + lanes()[.
+    // hashesOut must provide space for NONCE_SCANNER_MAX_LANES hashes.
+    // Returns the number of hashes computed (lanes of the kernel used).
+    static unsigned int scan(const HeaderMidstate& midstate, unsigned int first, uint256* hashesOut);
+
+    // Number of nonces hashed per call of scan
+    static unsigned int lanes();
+
+    // Name of the currently used kernel
+    static const char* kernelName();
+
+    // Select a kernel (returns false if not supported by this CPU).
+    // May be called while mining, scan picks up the new kernel atomically.
+    static bool setKernel(Kernel kernel);
+
+    // Check if the given kernel is supported by this CPU
+    static bool isSupported(Kernel kernel);
+};
+
+#endif // BITVOTING_SHA256_H